@@ -0,0 +1,200 @@
+#include <chrono>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "../icmp_packet.h"
+#include "../internet_checksum.h"
+#include "../ipv4_packet.h"
+#include "../utils.h"
+
+namespace utils {
+namespace ping {
+
+//It reaches into the per packet steps of the executor, with no socket or execution around them
+//The socket transport is never opened, so replies are decoded the raw socket way, IPV4 header included
+class icmp_v4_ping_executor_benchmark {
+ public:
+  static constexpr unsigned short PACKET_IDENTIFIER = 0xbeef;
+
+  //a single execution with a single IPV4 target host, every probe belongs to it
+  static void prepare(icmp_v4_ping_executor& pinger, const size_t payload_size) {
+    icmp_v4_ping_executor::ping_execution_ptr execution(new icmp_v4_ping_executor::ping_execution());
+    execution->options.payload_size = payload_size;
+    execution->response_data = &execution->owned_response_data;
+    icmp_v4_ping_executor::prepare_request_payload(payload_size, execution->request_payload);
+
+    pinger.m_executions.clear();
+    pinger.m_executions.push_back(std::move(execution));
+    pinger.m_targets.resize(1);
+    pinger.m_targets[0].execution_index = 0;
+    pinger.m_packet_identifier = PACKET_IDENTIFIER;
+  }
+
+  static bool build_request(icmp_v4_ping_executor& pinger,
+                            const unsigned short sequence_number,
+                            unsigned char* packet_bytes,
+                            const size_t packet_size) {
+    return pinger.get_icmp_echo_request_packet_bytes(sequence_number, false, pinger.m_executions[0]->request_payload,
+                                                     packet_bytes, packet_size);
+  }
+
+  //in-flight probes get registered the same way sent ICMP echo requests do
+  static void add_in_flight_probes(icmp_v4_ping_executor& pinger, const size_t nr_of_probes) {
+    auto now = chrono::steady_clock::now();
+
+    for (size_t sequence_number = 0; sequence_number < nr_of_probes; ++sequence_number) {
+      unsigned int probe_key = icmp_v4_ping_executor::get_probe_key(PACKET_IDENTIFIER, static_cast<unsigned short>(sequence_number));
+
+      icmp_v4_ping_executor::in_flight_probe new_probe;
+      new_probe.target_index = 0;
+      new_probe.result_index = sequence_number;
+      new_probe.request_sent_time = now;
+      new_probe.request_sent_wall_time = std::chrono::nanoseconds::zero();
+      new_probe.deadline_it = pinger.m_probe_deadlines.emplace(now + chrono::seconds(1), probe_key);
+      pinger.m_in_flight_probes[probe_key] = new_probe;
+    }
+  }
+
+  static bool match_reply(icmp_v4_ping_executor& pinger, unsigned char* reply_bytes, const size_t reply_size) {
+    ipv4_header ipv4_hdr;
+    icmp_header icmp_hdr;
+
+    return (pinger.match_reply(reply_bytes, reply_size, false, ipv4_hdr, icmp_hdr) != pinger.m_in_flight_probes.end());
+  }
+};
+
+} // namespace ping
+} // namespace utils
+
+namespace osquery {
+
+using utils::ping::icmp_v4_ping_executor;
+using utils::ping::icmp_v4_ping_executor_benchmark;
+
+//It builds the IPV4 packet a raw socket would hand over for the ICMP echo reply to the given sequence number
+std::vector<unsigned char> getEchoReplyPacketBytes(icmp_v4_ping_executor& pinger,
+                                                   const unsigned short sequence_number,
+                                                   const size_t payload_size) {
+  const size_t icmp_size = icmp_header::ICMP_PACKET_SIZE_IN_BYTES + payload_size;
+  const size_t packet_size = ipv4_header::IPV4_HEADER_SIZE_IN_BYTES + icmp_size;
+  std::vector<unsigned char> packet_bytes = {
+      0x45, 0x00, static_cast<unsigned char>(packet_size >> 8), static_cast<unsigned char>(packet_size & 0xFF),
+      0x12, 0x34, 0x40, 0x00, 0x40, 0x01, 0x00, 0x00,
+      0x7f, 0x00, 0x00, 0x01, 0x7f, 0x00, 0x00, 0x01};
+  packet_bytes.resize(packet_size);
+
+  uint16_t header_checksum = internet_checksum(packet_bytes.data(), ipv4_header::IPV4_HEADER_SIZE_IN_BYTES);
+  packet_bytes[ipv4_header::OFFSET_FIELD_HEADER_CHECKSUM_START] = static_cast<unsigned char>(header_checksum >> 8);
+  packet_bytes[ipv4_header::OFFSET_FIELD_HEADER_CHECKSUM_END] = static_cast<unsigned char>(header_checksum & 0xFF);
+
+  //the reply echoes the request back, just with its own type
+  unsigned char* icmp_bytes = packet_bytes.data() + ipv4_header::IPV4_HEADER_SIZE_IN_BYTES;
+  icmp_v4_ping_executor_benchmark::build_request(pinger, sequence_number, icmp_bytes, icmp_size);
+  icmp_header icmp_hdr(icmp_bytes, icmp_size);
+  icmp_hdr.type(icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY);
+  icmp_hdr.update_checksum();
+
+  return packet_bytes;
+}
+
+//Payload sizes: none, the default one, the usual ping -s one and a full ethernet frame
+void PayloadSizes(benchmark::internal::Benchmark* bench) {
+  for (const auto payload_size : {0, 18, 56, 1472}) {
+    bench->Arg(payload_size);
+  }
+}
+
+static void BM_build_echo_request(benchmark::State& state) {
+  const size_t payload_size = static_cast<size_t>(state.range(0));
+  icmp_v4_ping_executor pinger;
+  icmp_v4_ping_executor_benchmark::prepare(pinger, payload_size);
+  std::vector<unsigned char> packet_bytes(icmp_header::ICMP_PACKET_SIZE_IN_BYTES + payload_size);
+
+  unsigned short sequence_number = 0;
+  for (auto _ : state) {
+    bool ret = icmp_v4_ping_executor_benchmark::build_request(pinger, sequence_number++, packet_bytes.data(), packet_bytes.size());
+    benchmark::DoNotOptimize(ret);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * packet_bytes.size());
+}
+BENCHMARK(BM_build_echo_request)->Apply(PayloadSizes);
+
+static void BM_update_checksum(benchmark::State& state) {
+  std::vector<unsigned char> packet_bytes(icmp_header::ICMP_PACKET_SIZE_IN_BYTES + static_cast<size_t>(state.range(0)), 0x5a);
+  icmp_header icmp_hdr(packet_bytes.data(), packet_bytes.size());
+
+  for (auto _ : state) {
+    bool ret = icmp_hdr.update_checksum();
+    benchmark::DoNotOptimize(ret);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * packet_bytes.size());
+}
+BENCHMARK(BM_update_checksum)->Apply(PayloadSizes);
+
+//Everything a raw socket reply goes through before its lookup: both views and both checksums
+static void BM_parse_echo_reply(benchmark::State& state) {
+  const size_t payload_size = static_cast<size_t>(state.range(0));
+  icmp_v4_ping_executor pinger;
+  icmp_v4_ping_executor_benchmark::prepare(pinger, payload_size);
+  std::vector<unsigned char> packet_bytes = getEchoReplyPacketBytes(pinger, 7, payload_size);
+
+  for (auto _ : state) {
+    ipv4_header ipv4_hdr(packet_bytes.data(), packet_bytes.size());
+    icmp_header icmp_hdr(packet_bytes.data() + ipv4_hdr.payload_offset(), ipv4_hdr.payload_size());
+    bool ret = ((ipv4_hdr.is_checksum_valid()) &&
+                (icmp_hdr.is_ready()) &&
+                (icmp_hdr.is_checksum_valid()) &&
+                (icmp_hdr.type() == icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY));
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(icmp_hdr.identifier());
+    benchmark::DoNotOptimize(icmp_hdr.sequence_number());
+  }
+
+  if (!ipv4_header(packet_bytes.data(), packet_bytes.size()).is_checksum_valid()) {
+    state.SkipWithError("Invalid echo reply packet");
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * packet_bytes.size());
+}
+BENCHMARK(BM_parse_echo_reply)->Apply(PayloadSizes);
+
+//Replies to every in-flight probe come back in a different order than the requests went out
+static void BM_reply_demux(benchmark::State& state) {
+  const size_t nr_of_probes = static_cast<size_t>(state.range(0));
+  icmp_v4_ping_executor pinger;
+  icmp_v4_ping_executor_benchmark::prepare(pinger, 18);
+  icmp_v4_ping_executor_benchmark::add_in_flight_probes(pinger, nr_of_probes);
+
+  std::vector<std::vector<unsigned char>> replies;
+  for (size_t it = 0; it < nr_of_probes; ++it) {
+    unsigned short sequence_number = static_cast<unsigned short>((it * 7919) % nr_of_probes);
+    replies.push_back(getEchoReplyPacketBytes(pinger, sequence_number, 18));
+  }
+
+  size_t nr_of_matches = 0;
+  size_t reply_index = 0;
+  for (auto _ : state) {
+    std::vector<unsigned char>& reply = replies[reply_index];
+    if (icmp_v4_ping_executor_benchmark::match_reply(pinger, reply.data(), reply.size())) {
+      ++nr_of_matches;
+    }
+    reply_index = (reply_index + 1 == replies.size()) ? 0 : reply_index + 1;
+  }
+
+  if (nr_of_matches != static_cast<size_t>(state.iterations())) {
+    state.SkipWithError("Echo reply did not match its in-flight probe");
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_reply_demux)->Arg(1)->Arg(64)->Arg(1024)->Arg(32768);
+
+} // namespace osquery
+
+BENCHMARK_MAIN();
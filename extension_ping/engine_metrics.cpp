@@ -0,0 +1,141 @@
+#include "engine_metrics.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It forgets every sample, counter and error
+		void engine_metrics::metrics_data_unit::clear()
+		{
+			counters.fill(0);
+			for (auto& stage_histogram : stage_histograms)
+			{
+				stage_histogram.clear();
+			}
+			stage_total_times.fill(chrono::microseconds::zero());
+			errors.clear();
+		}
+
+		//It adds the given metrics up into these ones
+		void engine_metrics::metrics_data_unit::merge(const metrics_data_unit& other)
+		{
+			for (size_t it = 0; it < NR_OF_COUNTERS; ++it)
+			{
+				counters[it] += other.counters[it];
+			}
+
+			for (size_t it = 0; it < NR_OF_STAGES; ++it)
+			{
+				if (other.stage_histograms[it].get_nr_of_samples() > 0)
+				{
+					stage_histograms[it].merge(other.stage_histograms[it]);
+					stage_total_times[it] += other.stage_total_times[it];
+				}
+			}
+
+			for (const auto& other_error : other.errors)
+			{
+				bool found = false;
+				for (auto& error : errors)
+				{
+					if ((error.source == other_error.source) &&
+						(error.value == other_error.value) &&
+						(error.category == other_error.category))
+					{
+						error.count += other_error.count;
+						found = true;
+						break;
+					}
+				}
+
+				if (!found)
+				{
+					errors.push_back(other_error);
+				}
+			}
+		}
+
+		//It counts the time the given stage took once
+		void engine_metrics::metrics_data_unit::add_stage_time(const STAGE_TYPE stage, const chrono::steady_clock::duration& stage_time)
+		{
+			chrono::microseconds stage_time_us = chrono::duration_cast<chrono::microseconds>(stage_time);
+
+			stage_histograms[stage].add(stage_time_us);
+			stage_total_times[stage] += stage_time_us;
+		}
+
+		//It counts an error of the given source, errors are rare so a plain list is enough
+		void engine_metrics::metrics_data_unit::add_error(const ERROR_SOURCE source, const boost::system::error_code& error_code)
+		{
+			for (auto& error : errors)
+			{
+				if ((error.source == source) &&
+					(error.value == error_code.value()) &&
+					(error.category == error_code.category().name()))
+				{
+					++error.count;
+					return;
+				}
+			}
+
+			error_data new_error;
+			new_error.source = source;
+			new_error.category = error_code.category().name();
+			new_error.value = error_code.value();
+			new_error.message = error_code.message();
+			new_error.count = 1;
+			errors.push_back(std::move(new_error));
+		}
+
+		//It adds the metrics of a completed execution up
+		void engine_metrics::store_execution(const metrics_data& execution_data)
+		{
+			std::lock_guard<std::mutex> guard(m_metrics_mutex);
+
+			m_metrics.merge(execution_data);
+		}
+
+		//It copies every metric gathered so far out
+		void engine_metrics::get_metrics(metrics_data& metrics)
+		{
+			std::lock_guard<std::mutex> guard(m_metrics_mutex);
+
+			metrics = m_metrics;
+		}
+
+		//It forgets every metric gathered so far
+		void engine_metrics::clear()
+		{
+			std::lock_guard<std::mutex> guard(m_metrics_mutex);
+
+			m_metrics.clear();
+		}
+
+		//It returns the name the given stage goes by on the ping_engine_metrics table
+		const char* engine_metrics::get_stage_name(const STAGE_TYPE stage)
+		{
+			static const char* stage_names[NR_OF_STAGES] = { "resolve", "queue_wait", "setup", "send", "wait", "decode" };
+
+			return (stage < NR_OF_STAGES) ? stage_names[stage] : "";
+		}
+
+		//It returns the name the given counter goes by on the ping_engine_metrics table
+		const char* engine_metrics::get_counter_name(const COUNTER_TYPE counter)
+		{
+			static const char* counter_names[NR_OF_COUNTERS] = {
+				"executions", "engine_rebuilds", "resolutions", "resolution_failures",
+				"requests_sent", "paced_requests", "lost_requests",
+				"replies_matched", "unmatched_replies", "dropped_packets", "timeouts" };
+
+			return (counter < NR_OF_COUNTERS) ? counter_names[counter] : "";
+		}
+
+		//It returns the name the given error source goes by on the ping_engine_metrics table
+		const char* engine_metrics::get_error_source_name(const ERROR_SOURCE source)
+		{
+			static const char* source_names[NR_OF_ERROR_SOURCES] = { "exception", "resolve", "send", "receive" };
+
+			return (source < NR_OF_ERROR_SOURCES) ? source_names[source] : "";
+		}
+	}
+}
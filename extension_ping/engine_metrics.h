@@ -0,0 +1,108 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "latency_histogram.h"
+
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Hot path instrumentation of an ICMP ping engine, kept across executions
+        //Engines fill an execution snapshot with no locking while they run, and hand it over once the execution
+        //is done, so the mutex is taken once per execution and never per packet
+        //Stage times go to log-bucketed histograms, so percentiles come back with the same relative error as
+        //the ping_quantiles ones, and errors are counted by where they happened and by error code
+        class engine_metrics
+        {
+        public:
+            //execution stages, each sample is the time one of them took
+            enum STAGE_TYPE
+            {
+                RESOLVE_STAGE = 0,
+                QUEUE_WAIT_STAGE,
+                SETUP_STAGE,
+                SEND_STAGE,
+                WAIT_STAGE,
+                DECODE_STAGE,
+                NR_OF_STAGES
+            };
+
+            //execution events
+            enum COUNTER_TYPE
+            {
+                EXECUTIONS = 0,
+                ENGINE_REBUILDS,
+                RESOLUTIONS,
+                RESOLUTION_FAILURES,
+                REQUESTS_SENT,
+                PACED_REQUESTS,
+                LOST_REQUESTS,
+                REPLIES_MATCHED,
+                UNMATCHED_REPLIES,
+                DROPPED_PACKETS,
+                TIMEOUTS,
+                NR_OF_COUNTERS
+            };
+
+            //places errors come from
+            enum ERROR_SOURCE
+            {
+                EXCEPTION_ERROR = 0,
+                RESOLVE_ERROR,
+                SEND_ERROR,
+                RECEIVE_ERROR,
+                NR_OF_ERROR_SOURCES
+            };
+
+            //errors of the same source and error code are counted together
+            typedef struct error_data_unit
+            {
+                ERROR_SOURCE source;
+                std::string category;
+                int value;
+                std::string message;
+                uint64_t count;
+            } error_data;
+
+            //metrics data object, engines fill one per execution and the merged one is read back for the table
+            typedef struct metrics_data_unit
+            {
+                metrics_data_unit()
+                {
+                    clear();
+                }
+
+                void clear();
+                void merge(const metrics_data_unit& other);
+                void count(const COUNTER_TYPE counter, const uint64_t nr_of_events = 1) { counters[counter] += nr_of_events; }
+                void add_stage_time(const STAGE_TYPE stage, const chrono::steady_clock::duration& stage_time);
+                void add_error(const ERROR_SOURCE source, const boost::system::error_code& error_code);
+
+                std::array<uint64_t, NR_OF_COUNTERS> counters;
+                std::array<latency_histogram, NR_OF_STAGES> stage_histograms;
+                std::array<chrono::microseconds, NR_OF_STAGES> stage_total_times;
+                std::vector<error_data> errors;
+
+            } metrics_data;
+
+            void store_execution(const metrics_data& execution_data);
+            void get_metrics(metrics_data& metrics);
+            void clear();
+            static const char* get_stage_name(const STAGE_TYPE stage);
+            static const char* get_counter_name(const COUNTER_TYPE counter);
+            static const char* get_error_source_name(const ERROR_SOURCE source);
+
+        private:
+            //member vars
+            std::mutex m_metrics_mutex;
+            metrics_data m_metrics;
+        };
+    }
+}
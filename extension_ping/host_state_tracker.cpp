@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cmath>
+#include "host_state_tracker.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It folds a ping response into the state of its target host
+		//It returns true, along with the change details, when the state of the target host changed
+		//The first response of a target host always counts as a change from the unknown state
+		bool host_state_tracker::update(const ping_response_data& data, state_change& change)
+		{
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			return update_entry(data, change);
+		}
+
+		//It folds every ping response, in order, and collects the ones that changed a target host state
+		void host_state_tracker::update(const ping_response_data_collection& response_data, state_change_collection& changes)
+		{
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			state_change change;
+			for (const auto& data : response_data)
+			{
+				if (update_entry(data, change))
+				{
+					changes.push_back(change);
+				}
+			}
+		}
+
+		//It returns the current state of the given target host on the given address family, if there is any
+		bool host_state_tracker::lookup(const std::string& target_host, host_state_entry& entry, const unsigned int address_family)
+		{
+			bool ret = false;
+
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			auto entry_it = m_entries.find(entry_key(target_host, address_family));
+			if (entry_it != m_entries.end())
+			{
+				entry = entry_it->second;
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It changes how RTT bands are laid out, the ratio is the width of each band and the margin is
+		//the fraction of it a round trip time can go over before leaving its band, so it does not flap
+		//between two bands when it sits right on their border
+		bool host_state_tracker::set_rtt_band(const double rtt_band_ratio, const double rtt_band_margin)
+		{
+			bool ret = false;
+
+			if ((rtt_band_ratio > 1.0) &&
+				(rtt_band_margin >= 0.0) &&
+				(rtt_band_margin < 1.0))
+			{
+				std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+				m_rtt_band_ratio = rtt_band_ratio;
+				m_rtt_band_margin = rtt_band_margin;
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It forgets about every target host
+		void host_state_tracker::clear()
+		{
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			m_entries.clear();
+		}
+
+		size_t host_state_tracker::size()
+		{
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			return m_entries.size();
+		}
+
+		//It returns the name of the given state
+		const char* host_state_tracker::get_state_name(const HOST_STATE state)
+		{
+			const char* ret = "unknown";
+
+			if (state == REACHABLE)
+			{
+				ret = "up";
+			}
+			else if (state == UNREACHABLE)
+			{
+				ret = "down";
+			}
+			else if (state == NOT_FOUND)
+			{
+				ret = "not_found";
+			}
+
+			return ret;
+		}
+
+		//It returns a comma separated description of the given changes
+		std::string host_state_tracker::get_changes_description(const unsigned int changes)
+		{
+			std::string ret;
+
+			if (changes & REACHABILITY_CHANGE)
+			{
+				ret.append("reachability");
+			}
+
+			if (changes & ADDRESS_CHANGE)
+			{
+				ret.append((ret.empty()) ? "" : ",").append("address");
+			}
+
+			if (changes & RTT_BAND_CHANGE)
+			{
+				ret.append((ret.empty()) ? "" : ",").append("rtt_band");
+			}
+
+			return ret;
+		}
+
+		//It returns the RTT band of the given round trip time
+		int host_state_tracker::get_rtt_band(const size_t round_trip_time_us) const
+		{
+			int ret = 0;
+
+			if (round_trip_time_us > 1)
+			{
+				ret = static_cast<int>(std::floor(std::log(static_cast<double>(round_trip_time_us)) / std::log(m_rtt_band_ratio)));
+			}
+
+			return ret;
+		}
+
+		//It checks if the given round trip time is still within the given RTT band, margin included
+		bool host_state_tracker::is_within_rtt_band(const size_t round_trip_time_us, const int rtt_band) const
+		{
+			double band_low = std::pow(m_rtt_band_ratio, rtt_band);
+			double band_high = std::pow(m_rtt_band_ratio, rtt_band + 1);
+			double band_margin = (band_high - band_low) * m_rtt_band_margin;
+
+			//there is nothing below the first band
+			if (rtt_band == 0)
+			{
+				band_low = 0;
+			}
+
+			return ((round_trip_time_us >= (band_low - band_margin)) &&
+				(round_trip_time_us < (band_high + band_margin)));
+		}
+
+		//It returns the lower limit in microseconds of the given RTT band
+		size_t host_state_tracker::get_rtt_band_limit(const int rtt_band) const
+		{
+			return (rtt_band > 0) ? static_cast<size_t>(std::ceil(std::pow(m_rtt_band_ratio, rtt_band))) : 0;
+		}
+
+		//It folds a ping response into the state of its target host, tracker lock should be already held
+		bool host_state_tracker::update_entry(const ping_response_data& data, state_change& change)
+		{
+			bool ret = false;
+
+			entry_key key(data.target_hostname, data.address_family);
+			if ((m_entries.size() >= m_max_nr_of_entries) &&
+				(m_entries.find(key) == m_entries.end()))
+			{
+				make_room();
+			}
+
+			host_state_entry& entry = m_entries[key];
+
+			change = state_change();
+			change.previous_state = entry;
+
+			HOST_STATE new_state = UNKNOWN;
+			if (data.type == ping_response_data::RESPONSE_TYPE::REPLY_DATA)
+			{
+				new_state = REACHABLE;
+			}
+			else if (data.type == ping_response_data::RESPONSE_TYPE::TIMEOUT)
+			{
+				new_state = UNREACHABLE;
+			}
+			else if (data.type == ping_response_data::RESPONSE_TYPE::TARGET_HOST_NOT_FOUND)
+			{
+				new_state = NOT_FOUND;
+			}
+
+			if (new_state != entry.state)
+			{
+				change.changes |= REACHABILITY_CHANGE;
+			}
+
+			//address and RTT band only mean something while the target host answers
+			if (new_state == REACHABLE)
+			{
+				if ((entry.state == REACHABLE) &&
+					(entry.response_address != data.response_address))
+				{
+					change.changes |= ADDRESS_CHANGE;
+				}
+
+				if (entry.state != REACHABLE)
+				{
+					entry.rtt_band = get_rtt_band(data.round_trip_time_us);
+				}
+				else if (!is_within_rtt_band(data.round_trip_time_us, entry.rtt_band))
+				{
+					entry.rtt_band = get_rtt_band(data.round_trip_time_us);
+					change.changes |= RTT_BAND_CHANGE;
+				}
+
+				entry.response_address = data.response_address;
+			}
+
+			entry.state = new_state;
+			entry.last_update_time = chrono::steady_clock::now();
+
+			if (change.changes != NO_CHANGE)
+			{
+				change.current_state = entry;
+				change.rtt_band_low_us = get_rtt_band_limit(entry.rtt_band);
+				change.rtt_band_high_us = get_rtt_band_limit(entry.rtt_band + 1);
+				change.data = data;
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It keeps the tracker bounded, the least recently updated target host goes first
+		void host_state_tracker::make_room()
+		{
+			if (!m_entries.empty())
+			{
+				auto oldest_entry_it = std::min_element(m_entries.begin(), m_entries.end(),
+					[](const std::pair<const entry_key, host_state_entry>& first, const std::pair<const entry_key, host_state_entry>& second)
+					{
+						return (first.second.last_update_time < second.second.last_update_time);
+					});
+
+				m_entries.erase(oldest_entry_it);
+			}
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "icmp_ping_executor.h"
+
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Per target host state tracker shared across executions
+        //Each ping response is folded into the state of its target host (reachability, responding address
+        //and round trip time band), and only responses that change that state are reported back, so
+        //what gets logged grows with the number of events rather than with hosts times query frequency
+        //Dual-stack target hosts have a state per address family, so their IPV4 and IPV6 answers do not flap
+        class host_state_tracker
+        {
+        public:
+            //Some magic data
+            static constexpr double DEFAULT_RTT_BAND_RATIO = 2.0;
+            static constexpr double DEFAULT_RTT_BAND_MARGIN = 0.25;
+            static constexpr size_t DEFAULT_MAX_NR_OF_ENTRIES = 4096;
+
+            typedef enum HOST_STATE_TYPE
+            {
+                UNKNOWN = 0,
+                REACHABLE,
+                UNREACHABLE,
+                NOT_FOUND
+            } HOST_STATE;
+
+            //bitmask of what changed
+            typedef enum STATE_CHANGE_TYPE
+            {
+                NO_CHANGE = 0,
+                REACHABILITY_CHANGE = 1,
+                ADDRESS_CHANGE = 2,
+                RTT_BAND_CHANGE = 4
+            } STATE_CHANGE;
+
+            //per target host state data object
+            //RTT bands are log-scaled, band N covers [ratio^N, ratio^(N+1)) microseconds
+            typedef struct host_state_entry_unit
+            {
+                host_state_entry_unit() :
+                    state(UNKNOWN),
+                    rtt_band(0) {}
+
+                HOST_STATE state;
+                std::string response_address;
+                int rtt_band;
+                chrono::steady_clock::time_point last_update_time;
+            } host_state_entry;
+
+            //state change data object, the response that caused it along with the previous state
+            typedef struct state_change_unit
+            {
+                state_change_unit() :
+                    changes(NO_CHANGE),
+                    rtt_band_low_us(0),
+                    rtt_band_high_us(0) {}
+
+                unsigned int changes;
+                host_state_entry previous_state;
+                host_state_entry current_state;
+                size_t rtt_band_low_us;
+                size_t rtt_band_high_us;
+                ping_response_data data;
+            } state_change;
+
+            typedef std::vector<state_change> state_change_collection;
+
+            host_state_tracker() :
+                m_rtt_band_ratio(DEFAULT_RTT_BAND_RATIO),
+                m_rtt_band_margin(DEFAULT_RTT_BAND_MARGIN),
+                m_max_nr_of_entries(DEFAULT_MAX_NR_OF_ENTRIES) {}
+
+            bool update(const ping_response_data& data, state_change& change);
+            void update(const ping_response_data_collection& response_data, state_change_collection& changes);
+            bool lookup(const std::string& target_host, host_state_entry& entry, const unsigned int address_family = 4);
+            bool set_rtt_band(const double rtt_band_ratio, const double rtt_band_margin);
+            void clear();
+            size_t size();
+
+            static const char* get_state_name(const HOST_STATE state);
+            static std::string get_changes_description(const unsigned int changes);
+
+        private:
+            //(target host, address family) pairs
+            typedef std::pair<std::string, unsigned int> entry_key;
+
+            struct entry_key_hash
+            {
+                size_t operator()(const entry_key& key) const
+                {
+                    return (std::hash<std::string>()(key.first) ^ static_cast<size_t>(key.second));
+                }
+            };
+
+            //private helper methods
+            int get_rtt_band(const size_t round_trip_time_us) const;
+            bool is_within_rtt_band(const size_t round_trip_time_us, const int rtt_band) const;
+            size_t get_rtt_band_limit(const int rtt_band) const;
+            bool update_entry(const ping_response_data& data, state_change& change);
+            void make_room();
+
+            //member vars
+            std::mutex m_tracker_mutex;
+            double m_rtt_band_ratio;
+            double m_rtt_band_margin;
+            size_t m_max_nr_of_entries;
+            std::unordered_map<entry_key, host_state_entry, entry_key_hash> m_entries;
+        };
+    }
+}
@@ -1,71 +1,82 @@
 #include "icmp_packet.h"
+#include "internet_checksum.h"
 
 //Internet Checksum implementation as detailed in https://datatracker.ietf.org/doc/html/rfc1071#section-4
-bool icmp_header::update_checksum(std::string payload)
+//It is computed over the whole viewed ICMP packet, header and payload
+//ICMPv6 packets have to pass the running sum of their IPV6 pseudo header along
+bool icmp_header::update_checksum(const uint64_t pseudo_header_sum)
 {
     bool ret = false;
 
-    if (!payload.empty())
+    if (packet_size >= ICMP_PACKET_SIZE_IN_BYTES)
     {
-        unsigned int work_checksum_data =
-            (type() << 8) +
-            code() +
-            identifier() +
-            sequence_number();
-
-        //Traverse payload bytes
-        std::string::iterator it = payload.begin();
-        while (it != payload.end())
-        {
-            work_checksum_data += (static_cast<unsigned char>(*it++) << 8);
-            if (it != payload.end())
-            {
-                work_checksum_data += static_cast<unsigned char>(*it++);
-            }                
-        }
-
-        work_checksum_data = (work_checksum_data >> 16) + (work_checksum_data & 0xFFFF);
-        work_checksum_data += (work_checksum_data >> 16);
+        //Checksum field is not part of the sum
+        checksum(0);
 
         //Update Checksum
-        checksum(static_cast<unsigned short>(~work_checksum_data));
+        checksum(internet_checksum_finish(internet_checksum_add(packet_buffer, packet_size, pseudo_header_sum)));
 
         ret = true;
     }
 
-    return true;
+    return ret;
 }
 
-//Clean internal packet buffer
-void icmp_header::clear()
+//It verifies the checksum of the whole viewed ICMP packet, header and payload
+bool icmp_header::is_checksum_valid(const uint64_t pseudo_header_sum) const
 {
-    std::fill(packet_buffer, packet_buffer + sizeof(packet_buffer), 0);
+    bool ret = false;
+
+    //summing a packet along with its own checksum has to give all ones
+    if ((packet_size >= ICMP_PACKET_SIZE_IN_BYTES) &&
+        (internet_checksum_finish(internet_checksum_add(packet_buffer, packet_size, pseudo_header_sum)) == 0))
+    {
+        ret = true;
+    }
+
+    return ret;
 }
 
-bool icmp_header::is_ready() const
+//It copies the given payload right after the ICMP header
+bool icmp_header::payload(const unsigned char* payload_bytes, const size_t payload_bytes_size)
 {
     bool ret = false;
 
-    //just doing a naive check to look for ICMP Echo Request/Reply packets
-    if ((code() == icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REQUEST) ||
-        (code() == icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY))
+    if ((packet_size >= ICMP_PACKET_SIZE_IN_BYTES) &&
+        (payload_bytes_size == payload_size()))
     {
+        //empty payloads might come with no bytes at all
+        if (payload_bytes_size > 0)
+        {
+            std::memcpy(packet_buffer + ICMP_PACKET_SIZE_IN_BYTES, payload_bytes, payload_bytes_size);
+        }
         ret = true;
     }
 
     return ret;
 }
 
-//short-to-network helper
-unsigned short icmp_header::get_short_from_offsets(const unsigned short offset_1, const unsigned short offset_2) const
+//Clean viewed ICMP header bytes
+void icmp_header::clear()
 {
-    return (packet_buffer[offset_1] << 8) + packet_buffer[offset_2];
+    std::fill(packet_buffer, packet_buffer + std::min<size_t>(packet_size, ICMP_PACKET_SIZE_IN_BYTES), 0);
 }
 
-//network-to-short helper
-void icmp_header::save_short_into_offsets(const unsigned short offset_1, const unsigned short offset_2, const unsigned short value) 
+bool icmp_header::is_ready() const
 {
-    packet_buffer[offset_1] = static_cast<unsigned char>(value >> 8);
-    packet_buffer[offset_2] = static_cast<unsigned char>(value & 0xFF);
+    bool ret = false;
+
+    //just doing a naive check to look for ICMP or ICMPv6 Echo Request/Reply packets
+    if ((packet_buffer) &&
+        (packet_size >= ICMP_PACKET_SIZE_IN_BYTES) &&
+        ((type() == icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REQUEST) ||
+         (type() == icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY) ||
+         (type() == icmp_header::ICMPV6_HEADER_CODE_TYPE::ICMPV6_ECHO_REQUEST) ||
+         (type() == icmp_header::ICMPV6_HEADER_CODE_TYPE::ICMPV6_ECHO_REPLY)))
+    {
+        ret = true;
+    }
+
+    return ret;
 }
 
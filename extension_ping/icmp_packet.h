@@ -1,9 +1,14 @@
 #pragma once
 
-#include <istream>
-#include <ostream>
 #include <algorithm>
-
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//Non-owning ICMP header view
+//It parses and builds the header fields straight over the caller-provided bytes, no copies are involved
+//The viewed bytes are the ICMP header followed by the ICMP payload
+//ICMPv6 echo packets share the same layout, their checksum also covers the IPV6 pseudo header
 class icmp_header
 {
 public:
@@ -28,6 +33,17 @@ public:
         NA
     } ICMP_HEADER_CODE_TYPE;
 
+    //ICMPv6 types, as detailed in https://datatracker.ietf.org/doc/html/rfc4443#section-2.1
+    typedef enum
+    {
+        ICMPV6_DEST_UNREACHABLE = 1,
+        ICMPV6_PACKET_TOO_BIG = 2,
+        ICMPV6_TIME_EXCEEDED = 3,
+        ICMPV6_PARAMETER_PROBLEM = 4,
+        ICMPV6_ECHO_REQUEST = 128,
+        ICMPV6_ECHO_REPLY = 129
+    } ICMPV6_HEADER_CODE_TYPE;
+
     //Start offset for different fields
     static const unsigned short OFFSET_FIELD_TYPE = 0;
     static const unsigned short OFFSET_FIELD_CODE = 1;
@@ -42,7 +58,8 @@ public:
     static const unsigned short ICMP_PACKET_SIZE_IN_BYTES = 8;
 
     //Lifecycle management
-    icmp_header() { clear(); }
+    icmp_header() : packet_buffer(nullptr), packet_size(0) {}
+    icmp_header(unsigned char* packet_bytes, const size_t packet_bytes_size) : packet_buffer(packet_bytes), packet_size(packet_bytes_size) {}
 
     //Getters
     unsigned char type() const { return packet_buffer[OFFSET_FIELD_TYPE]; }
@@ -50,6 +67,8 @@ public:
     unsigned short checksum() const { return get_short_from_offsets(OFFSET_FIELD_CHECKSUM_START, OFFSET_FIELD_CHECKSUM_END); }
     unsigned short identifier() const { return get_short_from_offsets(OFFSET_FIELD_IDENTIFIER_START, OFFSET_FIELD_IDENTIFIER_END); }
     unsigned short sequence_number() const { return get_short_from_offsets(OFFSET_FIELD_SEQUENCE_NUMBER_START, OFFSET_FIELD_SEQUENCE_NUMBER_END); }
+    const unsigned char* payload_data() const { return packet_buffer + ICMP_PACKET_SIZE_IN_BYTES; }
+    size_t payload_size() const { return (packet_size > ICMP_PACKET_SIZE_IN_BYTES) ? (packet_size - ICMP_PACKET_SIZE_IN_BYTES) : 0; }
 
     //setters
     void type(unsigned char value) { packet_buffer[OFFSET_FIELD_TYPE] = value; }
@@ -57,29 +76,30 @@ public:
     void checksum(unsigned short value) { save_short_into_offsets(OFFSET_FIELD_CHECKSUM_START, OFFSET_FIELD_CHECKSUM_END, value); }
     void identifier(unsigned short value) { save_short_into_offsets(OFFSET_FIELD_IDENTIFIER_START, OFFSET_FIELD_IDENTIFIER_END, value); }
     void sequence_number(unsigned short value) { save_short_into_offsets(OFFSET_FIELD_SEQUENCE_NUMBER_START, OFFSET_FIELD_SEQUENCE_NUMBER_END, value); }
+    bool payload(const unsigned char* payload_bytes, const size_t payload_bytes_size);
 
     //Helpers
     void clear();
     bool is_ready() const;
-    bool update_checksum(std::string payload);
-
+    bool update_checksum(const uint64_t pseudo_header_sum = 0);
+    bool is_checksum_valid(const uint64_t pseudo_header_sum = 0) const;
+    size_t size() const { return packet_size; }
 
-    friend std::istream& operator>>(std::istream& is, icmp_header& header)
+private:
+    //Network-to-short and short-to-network helpers
+    unsigned short get_short_from_offsets(const unsigned short offset_1, const unsigned short offset_2) const
     {
-        return is.read(reinterpret_cast<char*>(header.packet_buffer), ICMP_PACKET_SIZE_IN_BYTES);
+        return (packet_buffer[offset_1] << 8) + packet_buffer[offset_2];
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const icmp_header& header)
+    void save_short_into_offsets(const unsigned short offset_1, const unsigned short offset_2, const unsigned short value)
     {
-        return os.write(reinterpret_cast<const char*>(header.packet_buffer), ICMP_PACKET_SIZE_IN_BYTES);
+        packet_buffer[offset_1] = static_cast<unsigned char>(value >> 8);
+        packet_buffer[offset_2] = static_cast<unsigned char>(value & 0xFF);
     }
 
-private:
-    //Network-to-short and short-to-network helpers
-    unsigned short get_short_from_offsets(const unsigned short offset_1, const unsigned short offset_2) const;
-    void save_short_into_offsets(const unsigned short offset_1, const unsigned short offset_2, const unsigned short value);
-
-    unsigned char packet_buffer[ICMP_PACKET_SIZE_IN_BYTES];
+    unsigned char* packet_buffer;
+    size_t packet_size;
 };
 
 
@@ -1,14 +1,21 @@
-#include <random>
-#include <sstream>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
 #include <thread>
 #include <chrono>
 #include <string>
 #include <boost/asio.hpp>
 #include <boost/bind/bind.hpp>
-#include <boost/exception/diagnostic_information.hpp>
 #include "icmp_ping_executor.h"
 #include "ipv4_packet.h"
 #include "icmp_packet.h"
+#include "internet_checksum.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 using boost::asio::ip::icmp;
 using boost::asio::steady_timer;
@@ -18,376 +25,2142 @@ namespace utils
 {
 	namespace ping
 	{
-		//It executes the requested nr of ping requests
+		//It executes the requested nr of ping requests against a single target host
 		bool icmp_v4_ping_executor::execute(const std::string& target_host, const size_t nr_of_ping_requests, ping_response_data_collection& response_data)
 		{
-			bool ret = false;
+			return execute(std::vector<std::string>{ target_host }, nr_of_ping_requests, response_data);
+		}
 
-			std::lock_guard<std::mutex> guard(m_serialize_execute_mutex);
+		//It executes the requested nr of ping requests against all the given target hosts at once
+		//Each target host gets its ICMP echo requests sent one after the other, but all target hosts
+		//are probed concurrently, so total execution time is bounded by the slowest target host
+		bool icmp_v4_ping_executor::execute(const std::vector<std::string>& target_hosts, const size_t nr_of_ping_requests, ping_response_data_collection& response_data)
+		{
+			ping_request_options options;
+			options.nr_of_ping_requests = nr_of_ping_requests;
 
-			//defense programming sanity check
-			if ((!target_host.empty()) &&
-				(nr_of_ping_requests > 0))
-			{
-				try
-				{
-					//now executing the given ICMP echo requests
-					for (size_t it = 0; it < nr_of_ping_requests; ++it)
-					{
-						ping_response_data new_data;
-						if ((send_one_ping_request(target_host, new_data)) &&
-							(new_data.is_ready()))
-						{
-							response_data.push_back(new_data);
-						}
-					}
+			return execute(target_hosts, options, response_data);
+		}
 
-					//checking if execution conditions where the expected ones
-					if (!response_data.empty())
-					{
-						ret = true;
-					}
-					else
-					{
-						response_data.clear();
-					}
-				}
-				catch (boost::system::system_error const& ex)
+		//It executes the ICMP echo requests described by the given options against all the given target hosts at once
+		//On pipelined mode the echoes of a target host go out on the requested interval without waiting for
+		//the previous replies, so total execution time is roughly nr of requests x interval plus one timeout
+		bool icmp_v4_ping_executor::execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_response_data_collection& response_data)
+		{
+			return submit(target_hosts, options, response_data).get();
+		}
+
+		//It executes the ICMP echo requests described by the given options against all the given target hosts at once,
+		//but each target host gets a single statistics summary instead of one result per echo
+		//Results are folded into the statistics as they complete, so memory use does not depend on the nr of requests
+		bool icmp_v4_ping_executor::execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_statistics_data_collection& statistics_data)
+		{
+			return submit(target_hosts, options, statistics_data).get();
+		}
+
+		//It executes the ICMP echo requests described by the given options against all the given target hosts at once,
+		//and results are appended to the given pool as compact records, with no text formatting nor per result allocation
+		bool icmp_v4_ping_executor::execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_result_pool& result_pool)
+		{
+			return submit(target_hosts, options, result_pool).get();
+		}
+
+		//It executes the ICMP echo requests described by the given options against every target host the source hands over
+		//Only up to max_targets_in_flight target hosts are probed at once, a new one is pulled from the source as soon as
+		//a previous one completes, and its results go to the given handler right away, so memory use is bounded by the
+		//window and not by the number of target hosts
+		bool icmp_v4_ping_executor::execute(const target_host_source& next_target_host, const ping_request_options& options, const response_handler& on_response, const size_t max_targets_in_flight)
+		{
+			return submit(next_target_host, options, on_response, max_targets_in_flight).get();
+		}
+
+		//Same as above, but results go to the given handler as compact records along with their target hostname
+		bool icmp_v4_ping_executor::execute(const target_host_source& next_target_host, const ping_request_options& options, const result_handler& on_result, const size_t max_targets_in_flight)
+		{
+			return submit(next_target_host, options, on_result, max_targets_in_flight).get();
+		}
+
+		//It queues the ICMP echo requests described by the given options against all the given target hosts
+		//The returned future is ready once every result is in the given collection, which has to outlive it
+		std::future<bool> icmp_v4_ping_executor::submit(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_response_data_collection& response_data)
+		{
+			ping_execution_ptr execution(new ping_execution());
+			execution->type = RESULTS_EXECUTION;
+			execution->options = options;
+			execution->target_hosts = target_hosts;
+			execution->response_data = &response_data;
+
+			return submit_execution(std::move(execution));
+		}
+
+		//It queues the ICMP echo requests described by the given options against all the given target hosts,
+		//each one of them gets a single statistics summary
+		//The returned future is ready once every summary is in the given collection, which has to outlive it
+		std::future<bool> icmp_v4_ping_executor::submit(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_statistics_data_collection& statistics_data)
+		{
+			ping_execution_ptr execution(new ping_execution());
+			execution->type = STATISTICS_EXECUTION;
+			execution->options = options;
+			execution->target_hosts = target_hosts;
+			execution->statistics_data = &statistics_data;
+
+			return submit_execution(std::move(execution));
+		}
+
+		//It queues the ICMP echo requests described by the given options against all the given target hosts
+		//The returned future is ready once every result is in the given pool, which has to outlive it and must not
+		//be touched until then
+		std::future<bool> icmp_v4_ping_executor::submit(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_result_pool& result_pool)
+		{
+			ping_execution_ptr execution(new ping_execution());
+			execution->type = RESULTS_EXECUTION;
+			execution->options = options;
+			execution->target_hosts = target_hosts;
+			execution->result_pool = &result_pool;
+
+			return submit_execution(std::move(execution));
+		}
+
+		//It queues the ICMP echo requests described by the given options against every target host the source hands over
+		//The source and the handler are called from the reactor thread until the returned future is ready
+		std::future<bool> icmp_v4_ping_executor::submit(const target_host_source& next_target_host, const ping_request_options& options, const response_handler& on_response, const size_t max_targets_in_flight)
+		{
+			result_handler on_result = nullptr;
+
+			//every result turns into response data right before the handler gets it
+			if (on_response)
+			{
+				on_result = [on_response](const ping_result_record& result, const std::string& target_hostname)
 				{
-					auto test = ex.code().value();
-					std::string exception_data = boost::diagnostic_information(ex); //mjo log this
-					ret = false;
-				}
+					ping_response_data response_data;
+					get_response_data(result, target_hostname, response_data);
+					on_response(response_data);
+				};
 			}
 
-			return ret;
+			return submit(next_target_host, options, on_result, max_targets_in_flight);
+		}
+
+		//Same as above, but results go to the given handler as compact records along with their target hostname
+		std::future<bool> icmp_v4_ping_executor::submit(const target_host_source& next_target_host, const ping_request_options& options, const result_handler& on_result, const size_t max_targets_in_flight)
+		{
+			ping_execution_ptr execution(new ping_execution());
+			execution->type = STREAMING_EXECUTION;
+			execution->options = options;
+			execution->target_source = next_target_host;
+			execution->on_result = on_result;
+			execution->max_targets_in_flight = max_targets_in_flight;
+
+			return submit_execution(std::move(execution));
 		}
 
-		//It sends one ICMP ping request at the time
-		//This function uses an async flow through Boost ASIO
-		bool icmp_v4_ping_executor::send_one_ping_request(const std::string& target_host, ping_response_data& execution_result)
+		//It queues the ICMP echo requests described by the given options against all the given target hosts,
+		//and the given handler gets the results from the reactor thread once they are all in
+		//It returns false if the execution cannot be queued, the handler is never called then
+		bool icmp_v4_ping_executor::submit(const std::vector<std::string>& target_hosts, const ping_request_options& options, const completion_handler& on_completed)
 		{
 			bool ret = false;
 
-			if (!target_host.empty())
+			//defense programming sanity check
+			if ((!target_hosts.empty()) &&
+				(options.is_valid()) &&
+				(on_completed))
 			{
-				//making sure we are always starting from a known state
-				if (reset_internal_state())
-				{
-					//starting ICMP Echo Request and ICMP Echo Reply Async flows
-					bool should_run_callbacks = false;
-					if (trigger_icmp_ping_async_flow(target_host, should_run_callbacks))
-					{
-						//Checking if callbacks should be run
-						if (should_run_callbacks)
-						{
-							//now just asking the ASIO execution engine to run until one callback handler is executed
-							//the handlers will be hit under ICMP echo request timeout and ICMP echo response scenarios
-							boost::asio::io_context::count_type exec_count = m_async_engine_ptr->run_one();
-							if (exec_count == 1)
-							{
-								//check if there is a execution result ready
-								if (m_work_execution_result.is_ready())
-								{
-									//and saving the async execution result if this is the case
-									execution_result = m_work_execution_result;
-									ret = true;
-								}
-							}
-						}
-						else
-						{
-							//it seems callbacks are not required
+				ping_execution_ptr execution(new ping_execution());
+				execution->type = RESULTS_EXECUTION;
+				execution->options = options;
+				execution->target_hosts = target_hosts;
+				execution->response_data = &execution->owned_response_data;
+				execution->on_completed = on_completed;
 
-							//check if there is a execution result ready
-							if (m_work_execution_result.is_ready())
-							{
-								//and saving the async execution result if this is the case
-								execution_result = m_work_execution_result;
-								ret = true;
-							}
-						}
-					}
-				}
+				submit_execution(std::move(execution));
+				ret = true;
 			}
 
 			return ret;
 		}
 
-		//Check if executor is ready
-		bool icmp_v4_ping_executor::is_ready()
+		//It queues the ICMP echo requests described by the given options against every target host the source hands over,
+		//and the given completion handler gets the outcome from the reactor thread once every one of them is done
+		//Results are only handed over as they come, so the completion handler gets no response data
+		//It returns false if the execution cannot be queued, none of the handlers is called then
+		bool icmp_v4_ping_executor::submit(const target_host_source& next_target_host, const ping_request_options& options, const result_handler& on_result, const completion_handler& on_completed, const size_t max_targets_in_flight)
 		{
 			bool ret = false;
 
-			if ((m_timer_ptr) &&
-				(m_socket_ptr) &&
-				(m_async_engine_ptr))
+			//defense programming sanity check
+			if ((next_target_host) &&
+				(on_result) &&
+				(on_completed) &&
+				(options.is_valid()) &&
+				(max_targets_in_flight > 0))
 			{
+				ping_execution_ptr execution(new ping_execution());
+				execution->type = STREAMING_EXECUTION;
+				execution->options = options;
+				execution->target_source = next_target_host;
+				execution->on_result = on_result;
+				execution->max_targets_in_flight = max_targets_in_flight;
+				execution->response_data = &execution->owned_response_data;
+				execution->on_completed = on_completed;
+
+				submit_execution(std::move(execution));
 				ret = true;
 			}
 
 			return ret;
 		}
 
-		//Reset internal executor state
-		bool icmp_v4_ping_executor::reset_internal_state()
+		//It hands the given execution over to the reactor thread through the submission queue
+		//Only the push that finds the queue empty wakes the reactor up, the rest of them are picked up along with it
+		//Executions that are not valid get a ready future right away, and they never reach the reactor
+		std::future<bool> icmp_v4_ping_executor::submit_execution(ping_execution_ptr execution)
 		{
-			bool ret = false;
-
-			m_reply_available = false;
+			std::future<bool> ret = execution->completion.get_future();
 
-			//We need to make sure that async engine and its users (timer and socket) gets properly initialized
-			if (!m_async_engine_ptr)
+			//defense programming sanity check
+			bool is_valid_execution = (execution->options.is_valid());
+			if (execution->type == STREAMING_EXECUTION)
 			{
-				//first run scenario, just create all the required instances
-				m_async_engine_ptr = boost::shared_ptr<boost::asio::io_context>(new boost::asio::io_context());
-				if (m_async_engine_ptr)
-				{
-					m_timer_ptr = boost::shared_ptr<steady_timer>(new steady_timer(*m_async_engine_ptr));
-					m_socket_ptr = boost::shared_ptr<icmp::socket>(new icmp::socket(*m_async_engine_ptr, icmp::v4()));
-
-					if ((m_timer_ptr) &&
-						(m_socket_ptr))
-					{
-						m_packet_identifier = get_packet_identifier();
-						m_work_execution_result.clear();
-						m_reply_buffer.consume(m_reply_buffer.size());  //clearing the buffer
+				is_valid_execution = ((is_valid_execution) &&
+					(execution->target_source) &&
+					(execution->on_result) &&
+					(execution->max_targets_in_flight > 0));
+			}
+			else
+			{
+				is_valid_execution = ((is_valid_execution) &&
+					(!execution->target_hosts.empty()));
+			}
 
-						ret = true;
-					}
-				}		
+			if (!is_valid_execution)
+			{
+				execution->completion.set_value(false);
 			}
 			else
 			{
-				//There was a previous run, so let's make sure that everything is properly stopped and re-initialized
+				start_reactor();
 
-				//stopping previous timer if needed
-				if (m_timer_ptr)
+				execution->submission_time = steady_timer::clock_type::now();
+				if (m_submissions.push(std::move(execution)))
 				{
-					m_timer_ptr->cancel();
+					boost::asio::post(m_async_engine, [this]()
+					{
+						start_submissions();
+					});
 				}
+			}
+
+			return ret;
+		}
+
+		//It starts the reactor thread, only the first submission does it
+		void icmp_v4_ping_executor::start_reactor()
+		{
+			std::call_once(m_reactor_started, [this]()
+			{
+				m_reactor_thread = std::thread(&icmp_v4_ping_executor::run_reactor, this);
+			});
+		}
+
+		//It stops the reactor thread, executions that did not complete yet are finished with what they have
+		void icmp_v4_ping_executor::stop_reactor()
+		{
+			m_reactor_stop_requested = true;
+			m_async_engine.stop();
+
+			if (m_reactor_thread.joinable())
+			{
+				m_reactor_thread.join();
+			}
+
+			//the reactor is gone, so its state can be touched from here
+			abort_executions();
+
+			std::vector<ping_execution_ptr> new_executions;
+			new_executions.swap(m_deferred_executions);
+			m_submissions.consume_all([&new_executions](ping_execution_ptr& execution)
+			{
+				new_executions.push_back(std::move(execution));
+			});
 
-				//stopping previous socket if needed
-				if (m_socket_ptr)
+			for (auto& execution : new_executions)
+			{
+				if (execution->on_completed)
 				{
-					m_async_engine_ptr->stop();
-					m_async_engine_ptr->reset();
-					m_socket_ptr->close();
+					execution->on_completed(false, *execution->response_data);
 				}
-			
-				//now reinitializing everything
-				m_async_engine_ptr.reset(new boost::asio::io_context());
-				if (m_async_engine_ptr)
+				else
 				{
-					m_timer_ptr.reset(new steady_timer(*m_async_engine_ptr));
-					m_socket_ptr.reset(new icmp::socket(*m_async_engine_ptr, icmp::v4()));
+					execution->completion.set_value(false);
+				}
+			}
+		}
 
-					if ((m_timer_ptr) &&
-						(m_socket_ptr))
-					{
-						m_packet_identifier = get_packet_identifier();
-						m_work_execution_result.clear();
-						m_reply_buffer.consume(m_reply_buffer.size()); //clearing the buffer
+		//It runs the async engine on the reactor thread until the executor goes away
+		//The work guard keeps it running while there is nothing to do, submissions wake it up through posted handlers
+		//Exceptions thrown by caller callbacks are caught where they are called, and they only fail their own execution
+		//Anything else reaching this point is an engine fault, so every running execution is finished with what it
+		//has and the engine gets rebuilt on the next submission
+		//No exception leaves the reactor thread, that would take the whole process down
+		//Executions are aborted within the same try block, so a fault on the way only makes the abort go on
+		//with the executions that are left
+		void icmp_v4_ping_executor::run_reactor()
+		{
+			auto reactor_work = boost::asio::make_work_guard(m_async_engine);
+			bool abort_required = false;
 
-						ret = true;
+			while (!m_reactor_stop_requested)
+			{
+				try
+				{
+					if (abort_required)
+					{
+						abort_required = false;
+						abort_executions();
 					}
+
+					m_async_engine.run();
+				}
+				catch (...)
+				{
+					//counted by error code, so they show up on the engine metrics
+					m_execution_metrics.add_error(engine_metrics::EXCEPTION_ERROR, get_exception_error_code(std::current_exception()));
+					abort_required = true;
 				}
 			}
+		}
 
-			return ret;
+		//It starts every execution waiting on the submission queue, they join the ones already running on the engine
+		void icmp_v4_ping_executor::start_submissions()
+		{
+			//executions are taken out of the queue first, starting them might throw
+			//Executions held back for a rebuild go first, once the ones they waited for are done
+			std::vector<ping_execution_ptr> new_executions;
+			m_deferred_start_posted = false;
+			if (!has_running_executions())
+			{
+				new_executions.swap(m_deferred_executions);
+			}
+
+			m_submissions.consume_all([&new_executions](ping_execution_ptr& execution)
+			{
+				new_executions.push_back(std::move(execution));
+			});
+
+			for (auto& execution : new_executions)
+			{
+				start_execution(std::move(execution));
+			}
+
+			refill_targets();
+			flush_ping_requests();
+			finish_completed_executions();
+			arm_timeout_timer();
+
+			//replies are only waited for while there is work, and a previous wait might have been cancelled
+			if (has_pending_work())
+			{
+				start_receive();
+			}
+			else
+			{
+				stop_if_completed();
+			}
 		}
 
-		//get bytes for an ICMP Echo Request packet
-		bool icmp_v4_ping_executor::get_icmp_echo_request_packet_bytes(boost::asio::streambuf& packet_bytes)
+		//It makes streaming executions ask their source for target hosts again, it can be called from any thread
+		//Sources that had nothing ready yet call it once they have, so their executions fill their windows up again
+		void icmp_v4_ping_executor::resume_target_sources()
 		{
-			bool ret = false;			
+			boost::asio::post(m_async_engine, [this]()
+			{
+				handle_resume();
+			});
+		}
 
-			icmp_header echo_request_packet;
+		//It fills the windows of the streaming executions up again, and waits for replies if they were idle so far
+		void icmp_v4_ping_executor::handle_resume()
+		{
+			//a wait for replies is only running while there is work
+			bool was_idle = (!has_pending_work());
 
-			std::string payload("Hello from OSQUERY");	
+			refill_targets();
+			flush_ping_requests();
+			finish_completed_executions();
+			arm_timeout_timer();
 
-			//Build the ICMP packet header
-			echo_request_packet.type(icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REQUEST);
-			echo_request_packet.code(0);
-			echo_request_packet.identifier(m_packet_identifier);
-			if (m_sequence_number == ipv4_header::MAX_IDENTIFIER_POSSIBLE)
+			if (!has_pending_work())
+			{
+				stop_if_completed();
+			}
+			else if (was_idle)
+			{
+				start_receive();
+			}
+		}
+
+		//It makes sure the engine is ready for the given execution and starts probing its target hosts
+		//Streaming executions pull their target hosts from their source once they are running
+		void icmp_v4_ping_executor::start_execution(ping_execution_ptr execution)
+		{
+			//a rebuild would cut the running executions short, so this one waits until they are done
+			if ((has_running_executions()) &&
+				(is_rebuild_pending()))
+			{
+				m_deferred_executions.push_back(std::move(execution));
+				return;
+			}
+
+			m_execution_metrics.count(engine_metrics::EXECUTIONS);
+			m_execution_metrics.add_stage_time(engine_metrics::QUEUE_WAIT_STAGE, steady_timer::clock_type::now() - execution->submission_time);
+
+			//options go first, packet sizes depend on them
+			prepare_request_payload(execution->options.payload_size, execution->request_payload);
+
+			chrono::steady_clock::time_point setup_start_time = steady_timer::clock_type::now();
+			bool engine_ready = prepare_engine(get_icmp_echo_request_packet_size(*execution));
+			m_execution_metrics.add_stage_time(engine_metrics::SETUP_STAGE, steady_timer::clock_type::now() - setup_start_time);
+
+			//executions get the first free slot, so their index stays valid while they are running
+			size_t execution_index = m_executions.size();
+			if (!m_free_execution_slots.empty())
 			{
-				m_sequence_number = 0;
-				echo_request_packet.sequence_number(++m_sequence_number);
+				execution_index = m_free_execution_slots.back();
+				m_free_execution_slots.pop_back();
+				m_executions[execution_index] = std::move(execution);
 			}
 			else
 			{
-				echo_request_packet.sequence_number(++m_sequence_number);
+				m_executions.push_back(std::move(execution));
 			}
 
-			//then update the packet checksum 
-			if (echo_request_packet.update_checksum(payload))
+			ping_execution& new_execution = *m_executions[execution_index];
+			new_execution.start_time = steady_timer::clock_type::now();
+			new_execution.busy_time_at_start = m_busy_time;
+
+			if (engine_ready)
 			{
-				//check if packet is ready
-				if (echo_request_packet.is_ready())
+				if (new_execution.type == STREAMING_EXECUTION)
+				{
+					new_execution.target_source_exhausted = false;
+				}
+				else
 				{
-					//and finally grab the packet bytes
-					boost::asio::streambuf work_bytes(ipv4_header::MAX_PACKET_SIZE);
-					std::ostream output_stream_bytes(&packet_bytes);
-					output_stream_bytes << echo_request_packet << payload;
+					for (const auto& target_host : new_execution.target_hosts)
+					{
+						if (!target_host.empty())
+						{
+							new_execution.target_indexes.push_back(allocate_target(execution_index));
+						}
+					}
 
-					if (packet_bytes.size() > 0)
+					//now sending the first round of ICMP echo requests to every target host that can be resolved right away,
+					//the rest of them get resolved asynchronously while the others are already being probed
+					size_t target_position = 0;
+					for (const auto& target_host : new_execution.target_hosts)
 					{
-						ret = true;
+						if (!target_host.empty())
+						{
+							start_target(new_execution.target_indexes[target_position++], target_host);
+						}
 					}
-				}	
+				}
 			}
+		}
 
-			return ret;
+		//It finishes every execution that has nothing left to probe
+		void icmp_v4_ping_executor::finish_completed_executions()
+		{
+			for (size_t execution_index = 0; execution_index < m_executions.size(); ++execution_index)
+			{
+				const ping_execution_ptr& execution = m_executions[execution_index];
+				if ((execution) &&
+					(execution->nr_of_active_targets == 0) &&
+					(execution->target_source_exhausted))
+				{
+					finish_execution(execution_index);
+				}
+			}
+
+			start_deferred_executions_if_idle();
 		}
 
-		//This function triggers the ICMP Echo Request and 
-		//sets the async callback handlers to grab the ICMP Echo Reply or timeout if reply packet does not arrive on time
-		bool icmp_v4_ping_executor::trigger_icmp_ping_async_flow(const std::string& target_host, bool& should_run_callbacks)
+		//It gathers the results of the given execution, gives its slots back and completes its future or callback
+		//Results keep the order the target hosts were requested in, echoes that could not be sent never got a result
+		void icmp_v4_ping_executor::finish_execution(const size_t execution_index)
 		{
+			//the execution keeps its slot while results are gathered, target hosts still point to it
+			const ping_execution_ptr& execution = m_executions[execution_index];
+
 			bool ret = false;
-			unsigned short NR_SECS_TO_WAIT_FOR_TIMEOUT = 5;
+			std::vector<size_t> target_indexes;
+			get_gathering_order(*execution, target_indexes);
 
-			if ((!target_host.empty()) &&
-				(is_ready()))
+			if ((execution->type == RESULTS_EXECUTION) &&
+				(execution->result_pool))
 			{
-				boost::asio::streambuf reply_buffer;
-
-				try
+				//records go to the pool as they are, their host IDs already come from it
+				for (size_t target_index : target_indexes)
 				{
-					//let's first try check if target hostname can be resolved 
-					icmp::resolver dns_resolver(*m_async_engine_ptr);
-					icmp::endpoint resolved_endpoint = *(dns_resolver.resolve(icmp::v4(), target_host, "").begin());
-					if (resolved_endpoint.size() > 0)
+					for (const auto& result : m_targets[target_index].results)
 					{
-						//Before sending the actual ICMP Echo request, better set first the async callback
-						//that will handle the ICMP Echo response message once the request goes live
-						m_socket_ptr->async_receive(
-
-							m_reply_buffer.prepare(ipv4_header::MAX_PACKET_SIZE),
-
-							//inline callback
-							[this, target_host](boost::system::error_code error_code, std::size_t receive_length)
-							{
-								if ((!error_code) &&
-									(receive_length > 0))
-								{
-									// making sure that bytes will be available later
-									m_reply_buffer.commit(receive_length);
-
-									// And now decoding the ICMP Echo Reply packet
-									std::istream is(&m_reply_buffer);
-									ipv4_header ipv4_hdr;
-									icmp_header icmp_hdr;
-									is >> ipv4_hdr >> icmp_hdr;
-
-									// Filter the message to make sure we found the expected one
-									if ((is) &&
-										(ipv4_hdr.is_ready()) &&
-										(icmp_hdr.is_ready()) &&
-										(icmp_hdr.type() == icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY) &&
-										(icmp_hdr.identifier() == m_packet_identifier) &&
-										(icmp_hdr.sequence_number() == m_sequence_number))
-									{
-										m_reply_available = true;
-
-										//Getting the round trip time and save data from the ICMP Reply packet
-										chrono::steady_clock::duration round_trip_time = chrono::steady_clock::now() - m_request_sent_time;
-										if (round_trip_time.count() > 0)
-										{
-											//storing execution result
-											m_work_execution_result.type = ping_response_data::RESPONSE_TYPE::REPLY_DATA;
-											m_work_execution_result.valid_checksum = true;
-											m_work_execution_result.time_to_live = ipv4_hdr.time_to_live();
-											m_work_execution_result.packet_identifier = icmp_hdr.identifier();
-											m_work_execution_result.sequence_number = icmp_hdr.sequence_number();
-											m_work_execution_result.round_trip_time = chrono::duration_cast<chrono::milliseconds>(round_trip_time).count();
-											m_work_execution_result.response_address.assign(ipv4_hdr.source_address().to_string());
-											m_work_execution_result.target_hostname.assign(target_host);
-											m_work_execution_result.ready = true;
-										}
-									}
-								}
-							});
-
-
-						//Ok now let's just generate and send the ICMP Echo Request data
-						boost::asio::streambuf echo_request_packet_bytes;
-						if ((get_icmp_echo_request_packet_bytes(echo_request_packet_bytes)) &&
-							(echo_request_packet_bytes.size() > 0))
+						if (result.is_ready())
 						{
-							std::size_t bytes_sent = m_socket_ptr->send_to(echo_request_packet_bytes.data(), resolved_endpoint);
-
-							//Our request is out, so we inmmediataely grab when it was sent
-							m_request_sent_time = steady_timer::clock_type::now();
-
-							//Let's check if the expected bytes where transmitted
-							if ((bytes_sent > 0) &&
-								(bytes_sent == echo_request_packet_bytes.size()))
-							{
-								//and then set a timeout for the ICMP Echo Reply packqets
-								m_timer_ptr->expires_at(m_request_sent_time + chrono::seconds(NR_SECS_TO_WAIT_FOR_TIMEOUT));
-
-								//And finally set the callback to handle the scenario where ICMP Echo Response packet never came 
-								//and our timeout timer fires
-								m_timer_ptr->async_wait(
-
-									//inline callback
-									[this, target_host](const boost::system::error_code& error_code)
-									{
-										if ((error_code == boost::system::errc::success) &&
-											(!m_reply_available)) //reply never came
-										{
-											//storing execution result
-											m_work_execution_result.type = ping_response_data::RESPONSE_TYPE::TIMEOUT;
-											m_work_execution_result.target_hostname.assign(target_host);
-											m_work_execution_result.ready = true;
-										}
-									});
-							}
+							execution->result_pool->add_record(result);
+							++execution->nr_of_responses;
 						}
-
-						//callbacks should be run through async engine
-						should_run_callbacks = true;
-						ret = true;
 					}
 				}
-				catch (boost::system::system_error const& ex)
+
+				ret = (execution->nr_of_responses > 0);
+			}
+			else if (execution->type == RESULTS_EXECUTION)
+			{
+				for (size_t target_index : target_indexes)
 				{
-					//catching the host not found scenario
-					if (ex.code().value() == boost::asio::error::host_not_found)
+					const probe_target& target = m_targets[target_index];
+					for (const auto& result : target.results)
 					{
-						//host cannot be resolved, storing result
-						m_work_execution_result.type = ping_response_data::RESPONSE_TYPE::TARGET_HOST_NOT_FOUND;
-						m_work_execution_result.target_hostname.assign(target_host);
-						m_work_execution_result.ready = true;
-						should_run_callbacks = false; //we are not running the callbacks when this happens
-						ret = true;
+						if (result.is_ready())
+						{
+							execution->response_data->emplace_back();
+							get_response_data(result, target.target_hostname, execution->response_data->back());
+						}
 					}
-					else
+				}
+
+				ret = (!execution->response_data->empty());
+			}
+			else if (execution->type == STATISTICS_EXECUTION)
+			{
+				for (size_t target_index : target_indexes)
+				{
+					probe_target& target = m_targets[target_index];
+					ping_statistics_data new_data;
+					new_data.target_hostname = target.target_hostname;
+					new_data.target_found = ((target.results.empty()) ||
+						(target.results.front().type != ping_response_data::RESPONSE_TYPE::TARGET_HOST_NOT_FOUND));
+					new_data.address_family = (new_data.target_found) ? get_address_family(target.resolved_endpoint) : get_not_found_address_family(target_index);
+					if (target.statistics.get_nr_of_transmitted() > 0)
 					{
-						//A different exception happened - let's just return false
-						ret = false;
+						new_data.response_address = target.resolved_endpoint.address().to_string();
 					}
+					new_data.statistics = target.statistics;
+					execution->statistics_data->push_back(std::move(new_data));
+				}
+
+				ret = (!execution->statistics_data->empty());
+			}
+			else
+			{
+				ret = (execution->nr_of_responses > 0);
+			}
+
+			if (execution->handler_failed)
+			{
+				ret = false;
+			}
+
+			//slots of streaming executions were already given back as their target hosts completed
+			for (size_t target_index : target_indexes)
+			{
+				probe_target& target = m_targets[target_index];
+				target.in_use = false;
+				target.results.clear();
+				m_free_target_slots.push_back(target_index);
+			}
+
+			//time spent sending and decoding while the execution ran is counted on their own stages,
+			//the rest of it is time spent waiting on the wire
+			chrono::steady_clock::duration wait_time = steady_timer::clock_type::now() - execution->start_time - (m_busy_time - execution->busy_time_at_start);
+			m_execution_metrics.add_stage_time(engine_metrics::WAIT_STAGE, std::max(wait_time, chrono::steady_clock::duration::zero()));
+			store_execution_metrics();
+
+			ping_execution_ptr finished_execution = std::move(m_executions[execution_index]);
+			m_free_execution_slots.push_back(execution_index);
+
+			if (finished_execution->on_completed)
+			{
+				//the execution is already gone, so a throwing completion handler is only counted
+				try
+				{
+					finished_execution->on_completed(ret, *finished_execution->response_data);
+				}
+				catch (...)
+				{
+					m_execution_metrics.add_error(engine_metrics::EXCEPTION_ERROR, get_exception_error_code(std::current_exception()));
+				}
+			}
+			else
+			{
+				finished_execution->completion.set_value(ret);
+			}
+		}
+
+		//It finishes every running execution with the results it already has and forgets about the engine state,
+		//so the engine gets rebuilt from scratch on the next submission
+		//Late replies and resolutions of the aborted executions will be ignored
+		void icmp_v4_ping_executor::abort_executions()
+		{
+			for (size_t execution_index = 0; execution_index < m_executions.size(); ++execution_index)
+			{
+				if (m_executions[execution_index])
+				{
+					finish_execution(execution_index);
+				}
+			}
+
+			m_executions.clear();
+			m_free_execution_slots.clear();
+			m_targets.clear();
+			m_free_target_slots.clear();
+			m_in_flight_probes.clear();
+			m_probe_deadlines.clear();
+			m_scheduled_requests.clear();
+			m_nr_of_pending_resolutions = 0;
+			m_waiting_for_writable_socket = false;
+			m_rebuild_required = true;
+			++m_engine_epoch;
+
+			start_deferred_executions_if_idle();
+		}
+
+		//It gives up on the callbacks of an execution after one of them threw, it can only be called from a catch block
+		//Its source is not asked for more target hosts and results are no longer handed over, the target hosts it
+		//already has complete as usual and it finishes with false once they are done
+		//Other executions, the engine and its transport are left alone
+		void icmp_v4_ping_executor::fail_execution(ping_execution& execution)
+		{
+			m_execution_metrics.add_error(engine_metrics::EXCEPTION_ERROR, get_exception_error_code(std::current_exception()));
+			execution.handler_failed = true;
+			execution.target_source_exhausted = true;
+		}
+
+		//It checks if there is any execution running on the engine
+		bool icmp_v4_ping_executor::has_running_executions() const
+		{
+			bool ret = false;
+
+			for (const auto& execution : m_executions)
+			{
+				if (execution)
+				{
+					ret = true;
+					break;
 				}
 			}
 
 			return ret;
 		}
 
-		unsigned short icmp_v4_ping_executor::get_packet_identifier()
+		//It checks if the next execution has to rebuild the engine before it can start
+		bool icmp_v4_ping_executor::is_rebuild_pending()
 		{
-			unsigned short ret = 0;
+			return ((m_rebuild_required) ||
+				(m_settings_changed) ||
+				(!is_ready()));
+		}
+
+		//It starts the executions held back for a rebuild once no execution is running on the engine anymore
+		//They are started from a posted handler, so they get a wait for replies of their own on the new transport
+		void icmp_v4_ping_executor::start_deferred_executions_if_idle()
+		{
+			if ((!m_deferred_executions.empty()) &&
+				(!m_deferred_start_posted) &&
+				(!has_running_executions()))
+			{
+				m_deferred_start_posted = true;
+				boost::asio::post(m_async_engine, [this]()
+				{
+					start_submissions();
+				});
+			}
+		}
 
-			// produces randomness out of thin air
-			std::random_device rd;
-			std::mt19937 rng(rd());
+		//It returns the execution the given target host belongs to
+		icmp_v4_ping_executor::ping_execution& icmp_v4_ping_executor::get_target_execution(const size_t target_index)
+		{
+			return *m_executions[m_targets[target_index].execution_index];
+		}
 
-			// unsigned short range
-			std::uniform_int_distribution<> ushort_dist_range(1, ipv4_header::MAX_IDENTIFIER_POSSIBLE);
+		//It returns the execution the given target host belongs to
+		const icmp_v4_ping_executor::ping_execution& icmp_v4_ping_executor::get_target_execution(const size_t target_index) const
+		{
+			return *m_executions[m_targets[target_index].execution_index];
+		}
 
-			// get random value from range
-			ret = ushort_dist_range(rng);
+		//It builds the payload of the ICMP Echo Requests of an execution
+		//The payload repeats the default one as many times as needed, like ping -s does
+		void icmp_v4_ping_executor::prepare_request_payload(const size_t payload_size, std::vector<unsigned char>& request_payload)
+		{
+			request_payload.resize(payload_size);
+			for (size_t it = 0; it < request_payload.size(); ++it)
+			{
+				request_payload[it] = ECHO_REQUEST_PAYLOAD[it % ping_request_options::DEFAULT_PAYLOAD_SIZE_IN_BYTES];
+			}
+		}
+
+		//It takes a free target host slot for the given execution, the slot collection grows when there is none
+		//References to slots do not survive this call
+		size_t icmp_v4_ping_executor::allocate_target(const size_t execution_index)
+		{
+			size_t ret = m_targets.size();
+
+			if (!m_free_target_slots.empty())
+			{
+				ret = m_free_target_slots.back();
+				m_free_target_slots.pop_back();
+			}
+			else
+			{
+				m_targets.emplace_back();
+			}
+
+			probe_target& target = m_targets[ret];
+			target.execution_index = execution_index;
+			target.in_use = true;
+			target.is_completed = false;
+			target.companion_index = NO_COMPANION;
+			target.is_companion = false;
+			++m_executions[execution_index]->nr_of_active_targets;
+
+			return ret;
+		}
+
+		//It sets the given slot up for the given target host and sends its first ICMP echo request,
+		//if the target host can be resolved right away
+		void icmp_v4_ping_executor::start_target(const size_t target_index, const std::string& target_host)
+		{
+			setup_target(target_index, target_host);
+
+			if (resolve_target(target_index))
+			{
+				send_next_ping_request(target_index);
+			}
+		}
+
+		//It gets the given slot ready to probe the given target host, with no address yet
+		void icmp_v4_ping_executor::setup_target(const size_t target_index, const std::string& target_host)
+		{
+			probe_target& target = m_targets[target_index];
+			const ping_request_options& options = get_target_execution(target_index).options;
+
+			target.target_hostname.assign(target_host);
+			target.host_id = 0;
+			if (get_target_execution(target_index).result_pool)
+			{
+				target.host_id = get_target_execution(target_index).result_pool->intern_hostname(target_host);
+			}
+			target.resolved_endpoint = icmp::endpoint();
+			target.nr_of_pending_requests = options.nr_of_ping_requests;
+			target.nr_of_unfinished_requests = options.nr_of_ping_requests;
+			target.nr_of_scheduled_requests = 0;
+			target.in_use = true;
+			target.send_slot_reserved = false;
+			target.companion_index = NO_COMPANION;
+			target.is_companion = false;
+			target.results.clear();
+			target.statistics.clear();
+		}
+
+		//It takes a companion slot for the IPV6 address of a dual-stack target host, it belongs to the same execution
+		void icmp_v4_ping_executor::allocate_companion(const size_t target_index)
+		{
+			size_t companion_index = allocate_target(m_targets[target_index].execution_index);
+
+			//the companion slot stays unfinished until the resolution tells if it has an address to probe
+			setup_target(companion_index, m_targets[target_index].target_hostname);
+			m_targets[companion_index].is_companion = true;
+			m_targets[target_index].companion_index = companion_index;
+		}
+
+		//It lets go of the companion slot of a target host that turned out not to be a dual-stack one
+		void icmp_v4_ping_executor::release_companion(const size_t target_index)
+		{
+			size_t companion_index = m_targets[target_index].companion_index;
+
+			if (companion_index != NO_COMPANION)
+			{
+				probe_target& companion = m_targets[companion_index];
+				m_targets[target_index].companion_index = NO_COMPANION;
+
+				companion.nr_of_pending_requests = 0;
+				companion.nr_of_unfinished_requests = 0;
+				release_target_if_completed(companion_index);
+
+				//results are no longer gathered from it, so its slot goes back right away
+				if (companion.in_use)
+				{
+					companion.in_use = false;
+					m_free_target_slots.push_back(companion_index);
+				}
+			}
+		}
+
+		//It returns the order the results of the given execution are gathered in, the one its target hosts were requested in
+		//Companion slots go right after the target host they belong to
+		void icmp_v4_ping_executor::get_gathering_order(const ping_execution& execution, std::vector<size_t>& target_indexes) const
+		{
+			target_indexes.reserve(execution.target_indexes.size() * 2);
+
+			for (size_t target_index : execution.target_indexes)
+			{
+				const probe_target& target = m_targets[target_index];
+				target_indexes.push_back(target_index);
+				if (target.companion_index != NO_COMPANION)
+				{
+					target_indexes.push_back(target.companion_index);
+				}
+			}
+		}
+
+		//It returns the number of ICMP echo requests the running target hosts might still have in flight at once
+		size_t icmp_v4_ping_executor::get_nr_of_reserved_echoes() const
+		{
+			size_t ret = 0;
+
+			for (const auto& execution : m_executions)
+			{
+				if (execution)
+				{
+					size_t echoes_per_target = (execution->options.is_pipelined()) ? execution->options.nr_of_ping_requests : 1;
+					ret += execution->nr_of_active_targets * echoes_per_target;
+				}
+			}
+
+			return ret;
+		}
+
+		//It keeps the window of every streaming execution full, every completed target host makes room for the next one of its source
+		//Windows are also bounded by the ICMP echo requests the whole engine can have in flight, so concurrent executions
+		//cannot run out of sequence numbers
+		//Target hosts that fail right away are completed at once, so this loops until every window is full, exhausted or
+		//waiting on a source that has nothing ready yet
+		void icmp_v4_ping_executor::refill_targets()
+		{
+			for (size_t execution_index = 0; execution_index < m_executions.size(); ++execution_index)
+			{
+				if ((!m_executions[execution_index]) ||
+					(m_executions[execution_index]->type != STREAMING_EXECUTION))
+				{
+					continue;
+				}
+
+				ping_execution& execution = *m_executions[execution_index];
+				const size_t echoes_per_target = (execution.options.is_pipelined()) ? execution.options.nr_of_ping_requests : 1;
+				const size_t window = std::min(execution.max_targets_in_flight, std::max<size_t>(1, MAX_NR_OF_ECHOES_IN_FLIGHT / echoes_per_target));
+
+				while ((!execution.target_source_exhausted) &&
+					(execution.nr_of_active_targets < window) &&
+					((execution.nr_of_active_targets == 0) ||
+					(get_nr_of_reserved_echoes() + echoes_per_target <= MAX_NR_OF_ECHOES_IN_FLIGHT)))
+				{
+					std::string target_host;
+					bool has_target_host = false;
+					try
+					{
+						has_target_host = execution.target_source(target_host);
+					}
+					catch (...)
+					{
+						fail_execution(execution);
+						break;
+					}
+
+					if (!has_target_host)
+					{
+						execution.target_source_exhausted = true;
+					}
+					else if (!target_host.empty())
+					{
+						start_target(allocate_target(execution_index), target_host);
+					}
+					else
+					{
+						//the source has nothing ready yet, it gets asked again once the execution is resumed
+						break;
+					}
+
+					//no need to wait for the whole window to be queued before sending
+					if (m_transport->nr_of_queued_requests() >= icmp_socket_batch::DEFAULT_BATCH_SIZE)
+					{
+						flush_ping_requests();
+					}
+				}
+			}
+
+			flush_ping_requests();
+		}
+
+		//A target host is completed once none of its ICMP echo requests is pending, in flight or scheduled
+		//On streaming executions a completed target host hands its results over and gives its slot back right away,
+		//otherwise its results wait in the slot until the whole execution is finished
+		void icmp_v4_ping_executor::release_target_if_completed(const size_t target_index)
+		{
+			probe_target& target = m_targets[target_index];
+
+			if ((target.in_use) &&
+				(!target.is_completed) &&
+				(target.nr_of_unfinished_requests == 0) &&
+				(target.nr_of_scheduled_requests == 0))
+			{
+				ping_execution& execution = get_target_execution(target_index);
+				target.is_completed = true;
+				--execution.nr_of_active_targets;
+
+				if (execution.type == STREAMING_EXECUTION)
+				{
+					target.in_use = false;
+
+					//echoes that could not be sent never got a result
+					try
+					{
+						for (const auto& result : target.results)
+						{
+							if ((result.is_ready()) &&
+								(!execution.handler_failed))
+							{
+								execution.on_result(result, target.target_hostname);
+								++execution.nr_of_responses;
+							}
+						}
+					}
+					catch (...)
+					{
+						fail_execution(execution);
+					}
+
+					target.results.clear();
+					m_free_target_slots.push_back(target_index);
+				}
+			}
+		}
+
+		//Check if executor is ready
+		bool icmp_v4_ping_executor::is_ready()
+		{
+			bool ret = false;
+
+			if ((m_timer_ptr) &&
+				(m_send_timer_ptr) &&
+				(m_transport->is_open()))
+			{
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It makes sure the timers and the transport are up and ready for an execution sending requests of the given size
+		//The engine is kept open across executions and it only gets rebuilt after an error or a settings change,
+		//once no execution is running on it anymore, start_execution() holds new executions back until then
+		bool icmp_v4_ping_executor::prepare_engine(const size_t max_request_size)
+		{
+			bool ret = false;
+
+			if (m_settings_changed.exchange(false))
+			{
+				m_rebuild_required = true;
+			}
+
+			if ((m_rebuild_required) ||
+				(!is_ready()))
+			{
+				abort_executions();
+
+				m_execution_metrics.count(engine_metrics::ENGINE_REBUILDS);
+				m_max_request_size = 0;
+				if (rebuild_engine())
+				{
+					m_rebuild_required = false;
+				}
+			}
+
+			if ((!m_rebuild_required) &&
+				(is_ready()))
+			{
+				//request buffers only grow, and they can only be resized while none of them is queued
+				if ((max_request_size > m_max_request_size) &&
+					(m_transport->nr_of_queued_requests() == 0))
+				{
+					m_transport->reset(max_request_size);
+					m_max_request_size = max_request_size;
+				}
+
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It tears down the previous timers and transport, and creates brand new ones on the async engine
+		//The async engine itself is never replaced, the reactor thread keeps running it
+		bool icmp_v4_ping_executor::rebuild_engine()
+		{
+			bool ret = false;
+
+			//stopping previous timers if needed
+			if (m_timer_ptr)
+			{
+				m_timer_ptr->cancel();
+			}
+
+			if (m_send_timer_ptr)
+			{
+				m_send_timer_ptr->cancel();
+			}
+
+			//stopping previous transport and resolutions if needed
+			m_transport->close();
+
+			m_timer_ptr.reset();
+			m_send_timer_ptr.reset();
+
+			//now (re)initializing everything
+			m_timer_ptr.reset(new steady_timer(m_async_engine));
+			m_send_timer_ptr.reset(new steady_timer(m_async_engine));
+
+			std::lock_guard<std::mutex> guard(m_settings_mutex);
+			if ((m_timer_ptr) &&
+				(m_send_timer_ptr) &&
+				(m_transport->open(m_async_engine)))
+			{
+				//requests have to carry the identifier the transport picked, replies to any other one are not ours
+				m_packet_identifier = m_transport->get_packet_identifier();
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It resolves the given target host into an ICMP endpoint
+		//IP addresses and cached hostnames are resolved right away, otherwise an async resolution gets started
+		//and this returns false until its completion handler runs
+		//Dual-stack hostnames are resolved into both families at once, and they get a companion slot for the IPV6 one
+		bool icmp_v4_ping_executor::resolve_target(const size_t target_index)
+		{
+			bool ret = false;
+
+			boost::system::error_code address_error_code;
+			boost::asio::ip::address target_address = boost::asio::ip::make_address(m_targets[target_index].target_hostname, address_error_code);
+
+			if (!address_error_code)
+			{
+				//no DNS involved when target host is already an IP address, it is probed on its own family
+				m_targets[target_index].resolved_endpoint = icmp::endpoint(target_address, 0);
+				ret = true;
+			}
+			else
+			{
+				icmp_transport::ADDRESS_FAMILY address_family = get_target_execution(target_index).options.address_family;
+				if (address_family == icmp_transport::DUAL_STACK_FAMILY)
+				{
+					allocate_companion(target_index);
+				}
+
+				//families that were not requested count as cached with no address
+				probe_target& target = m_targets[target_index];
+				resolver_cache::cache_entry ipv4_entry;
+				resolver_cache::cache_entry ipv6_entry;
+				bool ipv4_cached = ((address_family == icmp_transport::IPV6_FAMILY) ||
+					(m_resolver_cache.lookup(target.target_hostname, ipv4_entry, false)));
+				bool ipv6_cached = ((address_family == icmp_transport::IPV4_FAMILY) ||
+					(m_resolver_cache.lookup(target.target_hostname, ipv6_entry, true)));
+
+				if ((ipv4_cached) &&
+					(ipv6_cached))
+				{
+					ret = assign_resolution(target_index,
+						(ipv4_entry.found) ? ipv4_entry.resolved_endpoint : icmp::endpoint(),
+						(ipv6_entry.found) ? ipv6_entry.resolved_endpoint : icmp::endpoint());
+				}
+				else
+				{
+					++m_nr_of_pending_resolutions;
+					m_execution_metrics.count(engine_metrics::RESOLUTIONS);
+					chrono::steady_clock::time_point resolution_start_time = steady_timer::clock_type::now();
+					size_t engine_epoch = m_engine_epoch;
+
+					m_transport->async_resolve(
+
+						target.target_hostname,
+
+						address_family,
+
+						//inline callback
+						[this, target_index, engine_epoch, resolution_start_time](const boost::system::error_code& error_code, const icmp::resolver::results_type& results)
+						{
+							handle_resolve(target_index, engine_epoch, resolution_start_time, error_code, results);
+						});
+				}
+			}
+
+			return ret;
+		}
+
+		//It stores the outcome of an async resolution and starts probing the target host if it was resolved
+		//Each requested family is cached on its own, the ones with no address as not found
+		//Resolutions started before the executions were aborted belong to a slot that is gone, so they are ignored
+		void icmp_v4_ping_executor::handle_resolve(const size_t target_index, const size_t engine_epoch, const chrono::steady_clock::time_point& resolution_start_time, const boost::system::error_code& error_code, const icmp::resolver::results_type& results)
+		{
+			if (engine_epoch != m_engine_epoch)
+			{
+				return;
+			}
+
+			--m_nr_of_pending_resolutions;
+
+			//resolver was cancelled
+			if (error_code == boost::asio::error::operation_aborted)
+			{
+				return;
+			}
+
+			m_execution_metrics.add_stage_time(engine_metrics::RESOLVE_STAGE, steady_timer::clock_type::now() - resolution_start_time);
+
+			probe_target& target = m_targets[target_index];
+			icmp_transport::ADDRESS_FAMILY address_family = get_target_execution(target_index).options.address_family;
+
+			if (((!error_code) && (!results.empty())) ||
+				(error_code == boost::asio::error::host_not_found))
+			{
+				//first address of each family is the one to probe
+				icmp::endpoint ipv4_endpoint;
+				icmp::endpoint ipv6_endpoint;
+				for (const auto& result : results)
+				{
+					if ((result.endpoint().address().is_v6()) &&
+						(ipv6_endpoint.address().is_unspecified()))
+					{
+						ipv6_endpoint = result.endpoint();
+					}
+					else if ((result.endpoint().address().is_v4()) &&
+						(ipv4_endpoint.address().is_unspecified()))
+					{
+						ipv4_endpoint = result.endpoint();
+					}
+				}
+
+				//host cannot be resolved, negative answers are cached too
+				if (address_family != icmp_transport::IPV6_FAMILY)
+				{
+					if (!ipv4_endpoint.address().is_unspecified())
+					{
+						m_resolver_cache.store_resolved(target.target_hostname, ipv4_endpoint);
+					}
+					else
+					{
+						m_resolver_cache.store_not_found(target.target_hostname, false);
+					}
+				}
+
+				if (address_family != icmp_transport::IPV4_FAMILY)
+				{
+					if (!ipv6_endpoint.address().is_unspecified())
+					{
+						m_resolver_cache.store_resolved(target.target_hostname, ipv6_endpoint);
+					}
+					else
+					{
+						m_resolver_cache.store_not_found(target.target_hostname, true);
+					}
+				}
+
+				if (error_code)
+				{
+					m_execution_metrics.count(engine_metrics::RESOLUTION_FAILURES);
+				}
+
+				if (assign_resolution(target_index, ipv4_endpoint, ipv6_endpoint))
+				{
+					send_next_ping_request(target_index);
+				}
+			}
+			else
+			{
+				//A different error happened - target host just gets no results
+				m_execution_metrics.count(engine_metrics::RESOLUTION_FAILURES);
+				m_execution_metrics.add_error(engine_metrics::RESOLVE_ERROR, error_code);
+				release_companion(target_index);
+				target.nr_of_pending_requests = 0;
+				target.nr_of_unfinished_requests = 0;
+				release_target_if_completed(target_index);
+			}
+
+			refill_targets();
+			flush_ping_requests();
+			finish_completed_executions();
+			arm_timeout_timer();
+			stop_if_completed();
+		}
+
+		//It hands the resolved addresses of a target host over to its slot, unspecified ones mean no address
+		//The target host probes its IPV4 address, or its IPV6 one when that is all it has, and dual-stack
+		//ones start probing their IPV6 address on their companion slot right away
+		//It returns true when the target host has an address to probe, otherwise it is stored as not found
+		bool icmp_v4_ping_executor::assign_resolution(const size_t target_index, const icmp::endpoint& ipv4_endpoint, const icmp::endpoint& ipv6_endpoint)
+		{
+			bool ret = false;
+
+			bool has_ipv4_address = (!ipv4_endpoint.address().is_unspecified());
+			bool has_ipv6_address = (!ipv6_endpoint.address().is_unspecified());
+			size_t companion_index = m_targets[target_index].companion_index;
+
+			if ((companion_index != NO_COMPANION) &&
+				(has_ipv4_address) &&
+				(has_ipv6_address))
+			{
+				m_targets[companion_index].resolved_endpoint = ipv6_endpoint;
+				send_next_ping_request(companion_index);
+			}
+			else
+			{
+				release_companion(target_index);
+			}
+
+			if ((has_ipv4_address) ||
+				(has_ipv6_address))
+			{
+				m_targets[target_index].resolved_endpoint = (has_ipv4_address) ? ipv4_endpoint : ipv6_endpoint;
+				ret = true;
+			}
+			else
+			{
+				store_target_not_found(target_index);
+			}
+
+			return ret;
+		}
+
+		//Host not found scenarios are stored as the only result of the target host
+		void icmp_v4_ping_executor::store_target_not_found(const size_t target_index)
+		{
+			probe_target& target = m_targets[target_index];
+
+			ping_result_record new_data;
+			new_data.type = ping_response_data::RESPONSE_TYPE::TARGET_HOST_NOT_FOUND;
+			new_data.address_family = static_cast<uint8_t>(get_not_found_address_family(target_index));
+			new_data.host_id = target.host_id;
+			new_data.ready = true;
+
+			target.nr_of_pending_requests = 0;
+			target.nr_of_unfinished_requests = 0;
+			target.results.push_back(new_data);
+			release_target_if_completed(target_index);
+		}
+
+		//It sends the next pending ICMP echo request of the given target host, if any
+		//The request is only queued, it goes out on the next flush_ping_requests()
+		bool icmp_v4_ping_executor::send_next_ping_request(const size_t target_index)
+		{
+			bool ret = false;
+
+			probe_target& target = m_targets[target_index];
+
+			//keep trying while there are pending requests, so one failing send does not stall the target host
+			while ((!ret) &&
+				(target.nr_of_pending_requests > 0))
+			{
+				//paced requests wait for their send slot on the send timer, the slot is already theirs once it fires
+				if ((m_send_pacer) &&
+					(!target.send_slot_reserved))
+				{
+					chrono::steady_clock::time_point now = steady_timer::clock_type::now();
+					chrono::steady_clock::time_point send_time = m_send_pacer->reserve(target.resolved_endpoint.address(), now);
+					if (send_time > now)
+					{
+						m_execution_metrics.count(engine_metrics::PACED_REQUESTS);
+						target.send_slot_reserved = true;
+						schedule_next_ping_request(target_index, send_time);
+						break;
+					}
+				}
+
+				target.send_slot_reserved = false;
+				--target.nr_of_pending_requests;
+
+				const ping_execution& execution = get_target_execution(target_index);
+				unsigned short sequence_number = get_next_sequence_number();
+				size_t packet_size = get_icmp_echo_request_packet_size(execution);
+
+				unsigned char* packet_bytes = m_transport->queue_request(target.resolved_endpoint, packet_size, get_request_tag(target_index, sequence_number));
+				if ((packet_bytes) &&
+					(get_icmp_echo_request_packet_bytes(sequence_number, target.resolved_endpoint.address().is_v6(), execution.request_payload, packet_bytes, packet_size)))
+				{
+					ret = true;
+				}
+
+				//this echo is lost
+				if (!ret)
+				{
+					m_execution_metrics.count(engine_metrics::LOST_REQUESTS);
+					--target.nr_of_unfinished_requests;
+				}
+			}
+
+			release_target_if_completed(target_index);
+
+			return ret;
+		}
+
+		//It sends every queued ICMP echo request, through as few syscalls as the transport allows
+		void icmp_v4_ping_executor::flush_ping_requests()
+		{
+			if (m_transport->nr_of_queued_requests() > 0)
+			{
+				chrono::steady_clock::time_point send_start_time = steady_timer::clock_type::now();
+				int flush_error = m_transport->flush_requests(
+
+					//inline callback
+					[this](const uint64_t request_tag, const int error)
+					{
+						size_t target_index = static_cast<size_t>(request_tag >> 16);
+						unsigned short sequence_number = static_cast<unsigned short>(request_tag & 0xFFFF);
+
+						if (error == 0)
+						{
+							//Our request is out, so we inmmediataely grab when it was sent
+							m_execution_metrics.count(engine_metrics::REQUESTS_SENT);
+							register_sent_request(target_index, sequence_number, steady_timer::clock_type::now());
+						}
+						else
+						{
+							boost::system::error_code error_code(error, boost::system::system_category());
+							if (is_socket_failure(error_code))
+							{
+								m_rebuild_required = true;
+							}
+
+							//this echo is lost, so moving on with the next one of the same target host
+							m_execution_metrics.count(engine_metrics::LOST_REQUESTS);
+							m_execution_metrics.add_error(engine_metrics::SEND_ERROR, error_code);
+							--m_targets[target_index].nr_of_unfinished_requests;
+							send_next_ping_request(target_index);
+						}
+					});
+
+				chrono::steady_clock::duration send_time = steady_timer::clock_type::now() - send_start_time;
+				m_execution_metrics.add_stage_time(engine_metrics::SEND_STAGE, send_time);
+				m_busy_time += chrono::duration_cast<chrono::microseconds>(send_time);
+
+				//socket send buffer is full, so the rest goes out once it becomes writable again
+				if ((flush_error != 0) &&
+					(!m_waiting_for_writable_socket))
+				{
+					m_waiting_for_writable_socket = true;
+					m_transport->async_wait_writable(
+
+						//inline callback
+						[this](const boost::system::error_code& error_code)
+						{
+							m_waiting_for_writable_socket = false;
+							if (error_code != boost::asio::error::operation_aborted)
+							{
+								refill_targets();
+								flush_ping_requests();
+								finish_completed_executions();
+								arm_timeout_timer();
+								stop_if_completed();
+							}
+						});
+				}
+			}
+		}
+
+		//It keeps track of an ICMP echo request that is out, until its reply or its timeout shows up
+		void icmp_v4_ping_executor::register_sent_request(const size_t target_index, const unsigned short sequence_number, const chrono::steady_clock::time_point& request_sent_time)
+		{
+			probe_target& target = m_targets[target_index];
+			const ping_execution& execution = get_target_execution(target_index);
+			const ping_request_options& options = execution.options;
+			unsigned int probe_key = get_probe_key(m_packet_identifier, sequence_number);
+
+			in_flight_probe new_probe;
+			new_probe.target_index = target_index;
+			new_probe.result_index = target.results.size();
+			new_probe.request_sent_time = request_sent_time;
+			new_probe.request_sent_wall_time = get_wall_clock_time();
+			chrono::steady_clock::duration timeout = options.timeout;
+			if (!options.has_fixed_timeout())
+			{
+				timeout = m_rtt_estimator.get_timeout(get_target_address(target));
+			}
+
+			new_probe.deadline_it = m_probe_deadlines.emplace(request_sent_time + timeout, probe_key);
+			m_in_flight_probes[probe_key] = new_probe;
+
+			//results keep the order echoes were sent, no matter the order they complete
+			//statistics executions keep no results at all
+			if (execution.type != STATISTICS_EXECUTION)
+			{
+				target.results.emplace_back();
+			}
+
+			//on pipelined mode the next echo goes out on its interval, not when this one completes
+			if ((options.is_pipelined()) &&
+				(target.nr_of_pending_requests > 0))
+			{
+				schedule_next_ping_request(target_index, request_sent_time + options.request_interval);
+			}
+		}
+
+		//It returns the size of the ICMP Echo Request packets of the given execution
+		size_t icmp_v4_ping_executor::get_icmp_echo_request_packet_size(const ping_execution& execution)
+		{
+			return icmp_header::ICMP_PACKET_SIZE_IN_BYTES + execution.options.payload_size;
+		}
+
+		//It builds an ICMP or ICMPv6 Echo Request packet straight into the given bytes
+		//ICMPv6 checksums cover the IPV6 pseudo header, whose source address only the kernel knows for sure,
+		//so they are left to the kernel, it fills them in on both raw and datagram ICMPv6 sockets
+		bool icmp_v4_ping_executor::get_icmp_echo_request_packet_bytes(const unsigned short sequence_number, const bool is_ipv6, const std::vector<unsigned char>& request_payload, unsigned char* packet_bytes, const size_t packet_size)
+		{
+			bool ret = false;			
+
+			icmp_header echo_request_packet(packet_bytes, packet_size);
+
+			//Build the ICMP packet header and payload
+			echo_request_packet.clear();
+			if (is_ipv6)
+			{
+				echo_request_packet.type(icmp_header::ICMPV6_HEADER_CODE_TYPE::ICMPV6_ECHO_REQUEST);
+			}
+			else
+			{
+				echo_request_packet.type(icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REQUEST);
+			}
+			echo_request_packet.code(0);
+			echo_request_packet.identifier(m_packet_identifier);
+			echo_request_packet.sequence_number(sequence_number);
+
+			//then update the packet checksum 
+			if ((echo_request_packet.payload(request_payload.data(), echo_request_packet.payload_size())) &&
+				((is_ipv6) || (echo_request_packet.update_checksum())))
+			{
+				//check if packet is ready
+				if (echo_request_packet.is_ready())
+				{
+					ret = true;
+				}	
+			}
+
+			return ret;
+		}
+
+		//It sets the async callback that will handle the next ICMP Echo Reply packets
+		//It just waits for the transport to be readable and then drains every pending reply at once
+		void icmp_v4_ping_executor::start_receive()
+		{
+			m_transport->async_wait_readable(
+
+				//inline callback
+				[this](const boost::system::error_code& error_code)
+				{
+					handle_receive(error_code);
+				});
+		}
+
+		//It processes every incoming ICMP packet pending on the transport
+		void icmp_v4_ping_executor::handle_receive(const boost::system::error_code& error_code)
+		{
+			//transport was cancelled because there is nothing else to wait for
+			if (error_code == boost::asio::error::operation_aborted)
+			{
+				return;
+			}
+
+			boost::system::error_code drain_error_code = error_code;
+			if (!error_code)
+			{
+				drain_error_code = boost::system::error_code(drain_transport(), boost::system::system_category());
+			}
+			else
+			{
+				m_execution_metrics.add_error(engine_metrics::RECEIVE_ERROR, error_code);
+			}
+
+			continue_receiving(drain_error_code);
+		}
+
+		//It reads everything already received by the transport, transmit timestamps go first
+		int icmp_v4_ping_executor::drain_transport()
+		{
+			chrono::steady_clock::time_point decode_start_time = steady_timer::clock_type::now();
+
+			int ret = m_transport->drain_replies(
+
+				//inline callback
+				[this](unsigned char* reply_bytes, const size_t reply_size, const icmp_socket_batch::reply_metadata& metadata)
+				{
+					process_reply(reply_bytes, reply_size, metadata);
+				},
+
+				//inline callback
+				[this](unsigned char* packet_bytes, const size_t packet_size, const icmp_socket_batch::reply_metadata& metadata)
+				{
+					process_transmit_timestamp(packet_bytes, packet_size, metadata);
+				});
+
+			chrono::steady_clock::duration decode_time = steady_timer::clock_type::now() - decode_start_time;
+			m_execution_metrics.add_stage_time(engine_metrics::DECODE_STAGE, decode_time);
+			m_busy_time += chrono::duration_cast<chrono::microseconds>(decode_time);
+			if (ret != 0)
+			{
+				m_execution_metrics.add_error(engine_metrics::RECEIVE_ERROR, boost::system::error_code(ret, boost::system::system_category()));
+			}
+
+			return ret;
+		}
+
+		//It keeps listening while there is work left, or stops everything when the socket is broken
+		void icmp_v4_ping_executor::continue_receiving(const boost::system::error_code& error_code)
+		{
+			//completions of this round might have queued new requests or released target hosts
+			refill_targets();
+			flush_ping_requests();
+			finish_completed_executions();
+			arm_timeout_timer();
+
+			//the socket itself is broken, so running executions are finished with what they have
+			//and the engine gets rebuilt on next submission
+			if (is_socket_failure(error_code))
+			{
+				abort_executions();
+				return;
+			}
+
+			//keep listening while there are ICMP echo requests waiting for replies or still to be sent
+			if (has_pending_work())
+			{
+				start_receive();
+			}
+			else
+			{
+				stop_if_completed();
+			}
+		}
+
+		//It decodes an incoming ICMP Echo Reply packet in place and looks up the in-flight ICMP Echo Request it answers
+		//Raw sockets hand the whole IPV4 packet over, datagram sockets just its ICMP payload, and ICMPv6 replies
+		//never carry their IPV6 header
+		//The end of the in-flight collection is returned when it is not one of our ICMP Echo Replies, our late
+		//or duplicated replies are counted apart from any other packet
+		icmp_v4_ping_executor::in_flight_probe_collection::iterator icmp_v4_ping_executor::match_reply(unsigned char* reply_bytes, const size_t reply_size, const bool is_ipv6_reply, ipv4_header& ipv4_hdr, icmp_header& icmp_hdr)
+		{
+			auto ret = m_in_flight_probes.end();
+
+			// Decoding the ICMP Echo Reply packet in place
+			bool is_datagram_reply = ((is_ipv6_reply) || (!m_transport->has_ipv4_header()));
+			unsigned char echo_reply_type = icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY;
+			if (is_ipv6_reply)
+			{
+				echo_reply_type = icmp_header::ICMPV6_HEADER_CODE_TYPE::ICMPV6_ECHO_REPLY;
+			}
+			if (is_datagram_reply)
+			{
+				icmp_hdr = icmp_header(reply_bytes, reply_size);
+			}
+			else
+			{
+				ipv4_hdr = ipv4_header(reply_bytes, reply_size);
+				if (ipv4_hdr.is_ready())
+				{
+					icmp_hdr = icmp_header(reply_bytes + ipv4_hdr.payload_offset(), ipv4_hdr.payload_size());
+				}
+			}
+
+			// Filter the message to make sure we found an expected one
+			if (((is_datagram_reply) || (ipv4_hdr.is_ready())) &&
+				(icmp_hdr.is_ready()) &&
+				(icmp_hdr.type() == echo_reply_type) &&
+				(icmp_hdr.identifier() == m_packet_identifier))
+			{
+				//both families share the same identifier, so the reply has to come from the family it was sent to
+				ret = m_in_flight_probes.find(get_probe_key(icmp_hdr.identifier(), icmp_hdr.sequence_number()));
+				if ((ret != m_in_flight_probes.end()) &&
+					(m_targets[ret->second.target_index].resolved_endpoint.address().is_v6() != is_ipv6_reply))
+				{
+					ret = m_in_flight_probes.end();
+				}
+
+				if (ret == m_in_flight_probes.end())
+				{
+					m_execution_metrics.count(engine_metrics::UNMATCHED_REPLIES);
+				}
+			}
+			else
+			{
+				m_execution_metrics.count(engine_metrics::DROPPED_PACKETS);
+			}
+
+			return ret;
+		}
+
+		//It completes the in-flight ICMP Echo Request an incoming ICMP Echo Reply packet answers
+		//Round trip time comes from kernel timestamps when they are available, so reactor scheduling
+		//delays are not counted as network time
+		void icmp_v4_ping_executor::process_reply(unsigned char* reply_bytes, const size_t reply_size, const icmp_socket_batch::reply_metadata& metadata)
+		{
+			bool is_ipv6_reply = metadata.source_endpoint.address().is_v6();
+			bool is_datagram_reply = ((is_ipv6_reply) || (!m_transport->has_ipv4_header()));
+			ipv4_header ipv4_hdr;
+			icmp_header icmp_hdr;
+
+			auto probe_it = match_reply(reply_bytes, reply_size, is_ipv6_reply, ipv4_hdr, icmp_hdr);
+			if (probe_it != m_in_flight_probes.end())
+			{
+				//Getting the round trip time and save data from the ICMP Reply packet
+				chrono::steady_clock::duration round_trip_time = chrono::steady_clock::now() - probe_it->second.request_sent_time;
+				if ((metadata.kernel_timestamp > std::chrono::nanoseconds::zero()) &&
+					(metadata.kernel_timestamp >= probe_it->second.request_sent_wall_time))
+				{
+					round_trip_time = chrono::duration_cast<chrono::steady_clock::duration>(metadata.kernel_timestamp - probe_it->second.request_sent_wall_time);
+				}
+
+				size_t target_index = probe_it->second.target_index;
+				size_t result_index = probe_it->second.result_index;
+				probe_target& target = m_targets[target_index];
+
+				//storing execution result, the response address stays in binary form
+				ping_result_record new_data;
+				new_data.type = ping_response_data::RESPONSE_TYPE::REPLY_DATA;
+				if (is_ipv6_reply)
+				{
+					new_data.valid_checksum = is_icmpv6_reply_checksum_valid(icmp_hdr, metadata);
+				}
+				else
+				{
+					new_data.valid_checksum = (is_datagram_reply) ? icmp_hdr.is_checksum_valid() : is_reply_checksum_valid(ipv4_hdr, icmp_hdr);
+				}
+				new_data.time_to_live = static_cast<uint8_t>((is_datagram_reply) ? metadata.time_to_live : ipv4_hdr.time_to_live());
+				new_data.address_family = static_cast<uint8_t>(get_address_family(target.resolved_endpoint));
+				new_data.packet_identifier = icmp_hdr.identifier();
+				new_data.sequence_number = icmp_hdr.sequence_number();
+				new_data.round_trip_time_us = chrono::duration_cast<chrono::microseconds>(round_trip_time).count();
+				ping_result_pool::set_response_address((is_datagram_reply) ? metadata.source_endpoint.address() : boost::asio::ip::address(ipv4_hdr.source_address()), new_data);
+				new_data.host_id = target.host_id;
+				new_data.ready = true;
+
+				//it feeds the timeout of the next ICMP echo requests sent to this target host
+				m_rtt_estimator.store_sample(get_target_address(target), chrono::duration_cast<chrono::microseconds>(round_trip_time));
+
+				//sweeps touch too many target hosts once to be worth tracking
+				if ((m_latency_tracker) &&
+					(get_target_execution(target_index).type != STREAMING_EXECUTION))
+				{
+					m_latency_tracker->store_sample(target.target_hostname, chrono::duration_cast<chrono::microseconds>(round_trip_time));
+				}
+
+				//this request is done
+				m_execution_metrics.count(engine_metrics::REPLIES_MATCHED);
+				m_probe_deadlines.erase(probe_it->second.deadline_it);
+				m_in_flight_probes.erase(probe_it);
+				complete_probe(target_index, result_index, new_data);
+				arm_timeout_timer();
+			}
+		}
+
+		//It takes the kernel transmit timestamp of one of our ICMP Echo Requests as its real sent time
+		//The looped packet comes with its link and network headers, so the ICMP request is just its tail
+		//Concurrent executions might send requests of different sizes, so the tail is tried with each one of them
+		//and it only counts when the request it points to belongs to an execution of that size
+		void icmp_v4_ping_executor::process_transmit_timestamp(const unsigned char* packet_bytes, const size_t packet_size, const icmp_socket_batch::reply_metadata& metadata)
+		{
+			if (metadata.kernel_timestamp <= std::chrono::nanoseconds::zero())
+			{
+				return;
+			}
+
+			for (const auto& execution : m_executions)
+			{
+				const size_t request_size = (execution) ? get_icmp_echo_request_packet_size(*execution) : 0;
+
+				if ((request_size > 0) &&
+					(packet_size >= request_size))
+				{
+					icmp_header icmp_hdr(const_cast<unsigned char*>(packet_bytes) + (packet_size - request_size), request_size);
+
+					if ((icmp_hdr.is_ready()) &&
+						((icmp_hdr.type() == icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REQUEST) ||
+						 (icmp_hdr.type() == icmp_header::ICMPV6_HEADER_CODE_TYPE::ICMPV6_ECHO_REQUEST)) &&
+						(icmp_hdr.identifier() == m_packet_identifier))
+					{
+						auto probe_it = m_in_flight_probes.find(get_probe_key(icmp_hdr.identifier(), icmp_hdr.sequence_number()));
+						if ((probe_it != m_in_flight_probes.end()) &&
+							(get_icmp_echo_request_packet_size(get_target_execution(probe_it->second.target_index)) == request_size))
+						{
+							probe_it->second.request_sent_wall_time = metadata.kernel_timestamp;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		//It makes the timer fire when the earliest in-flight ICMP Echo Request times out
+		void icmp_v4_ping_executor::arm_timeout_timer()
+		{
+			if ((!m_probe_deadlines.empty()) &&
+				(m_timer_ptr->expiry() != m_probe_deadlines.begin()->first))
+			{
+				m_timer_ptr->expires_at(m_probe_deadlines.begin()->first);
+
+				//set the callback to handle the scenario where ICMP Echo Response packets never came
+				//and our timeout timer fires
+				m_timer_ptr->async_wait(
+
+					//inline callback
+					[this](const boost::system::error_code& error_code)
+					{
+						handle_timeout(error_code);
+					});
+			}
+		}
+
+		//It completes every in-flight ICMP Echo Request whose deadline already passed
+		void icmp_v4_ping_executor::handle_timeout(const boost::system::error_code& error_code)
+		{
+			//timer was re-armed or cancelled
+			if (error_code != boost::system::errc::success)
+			{
+				return;
+			}
+
+			//replies that are already waiting on the transport are not timeouts, even if the timer fired first
+			drain_transport();
+
+			chrono::steady_clock::time_point now = steady_timer::clock_type::now();
+			while ((!m_probe_deadlines.empty()) &&
+				(m_probe_deadlines.begin()->first <= now))
+			{
+				auto probe_it = m_in_flight_probes.find(m_probe_deadlines.begin()->second);
+				m_probe_deadlines.erase(m_probe_deadlines.begin());
+
+				if (probe_it != m_in_flight_probes.end())
+				{
+					size_t target_index = probe_it->second.target_index;
+					size_t result_index = probe_it->second.result_index;
+					m_in_flight_probes.erase(probe_it);
+
+					//a timeout picked by the caller says nothing about how slow the target host is
+					if (!get_target_execution(target_index).options.has_fixed_timeout())
+					{
+						m_rtt_estimator.store_timeout(get_target_address(m_targets[target_index]));
+					}
+
+					//reply never came, storing execution result
+					m_execution_metrics.count(engine_metrics::TIMEOUTS);
+					ping_result_record new_data;
+					new_data.type = ping_response_data::RESPONSE_TYPE::TIMEOUT;
+					new_data.address_family = static_cast<uint8_t>(get_address_family(m_targets[target_index].resolved_endpoint));
+					new_data.host_id = m_targets[target_index].host_id;
+					new_data.ready = true;
+					complete_probe(target_index, result_index, new_data);
+				}
+			}
+
+			refill_targets();
+			flush_ping_requests();
+			finish_completed_executions();
+			arm_timeout_timer();
+			stop_if_completed();
+		}
+
+		//It stores the result of an ICMP echo request in the slot it got when it was sent
+		//In the classic mode this is also when the next echo of the same target host goes out
+		void icmp_v4_ping_executor::complete_probe(const size_t target_index, const size_t result_index, const ping_result_record& result)
+		{
+			probe_target& target = m_targets[target_index];
+			const ping_execution& execution = get_target_execution(target_index);
+
+			if (execution.type == STATISTICS_EXECUTION)
+			{
+				if (result.type == ping_response_data::RESPONSE_TYPE::REPLY_DATA)
+				{
+					target.statistics.add_reply(chrono::microseconds(result.round_trip_time_us));
+				}
+				else
+				{
+					target.statistics.add_loss();
+				}
+			}
+			else if (result_index < target.results.size())
+			{
+				target.results[result_index] = result;
+			}
+			--target.nr_of_unfinished_requests;
+
+			if (!execution.options.is_pipelined())
+			{
+				send_next_ping_request(target_index);
+			}
+
+			release_target_if_completed(target_index);
+		}
+
+		//It queues the next ICMP echo request of the given target host for the given point in time
+		void icmp_v4_ping_executor::schedule_next_ping_request(const size_t target_index, const chrono::steady_clock::time_point& send_time)
+		{
+			++m_targets[target_index].nr_of_scheduled_requests;
+			m_scheduled_requests.emplace(send_time, target_index);
+			arm_send_timer();
+		}
+
+		//It makes the send timer fire when the earliest queued ICMP Echo Request has to go out
+		void icmp_v4_ping_executor::arm_send_timer()
+		{
+			if ((!m_scheduled_requests.empty()) &&
+				(m_send_timer_ptr->expiry() != m_scheduled_requests.begin()->first))
+			{
+				m_send_timer_ptr->expires_at(m_scheduled_requests.begin()->first);
+
+				//set the callback that will send the queued ICMP Echo Requests once their time comes
+				m_send_timer_ptr->async_wait(
+
+					//inline callback
+					[this](const boost::system::error_code& error_code)
+					{
+						handle_send_timer(error_code);
+					});
+			}
+		}
+
+		//It sends every queued ICMP Echo Request whose time already came
+		void icmp_v4_ping_executor::handle_send_timer(const boost::system::error_code& error_code)
+		{
+			//timer was re-armed or cancelled
+			if (error_code != boost::system::errc::success)
+			{
+				return;
+			}
+
+			chrono::steady_clock::time_point now = steady_timer::clock_type::now();
+			while ((!m_scheduled_requests.empty()) &&
+				(m_scheduled_requests.begin()->first <= now))
+			{
+				size_t target_index = m_scheduled_requests.begin()->second;
+				m_scheduled_requests.erase(m_scheduled_requests.begin());
+
+				--m_targets[target_index].nr_of_scheduled_requests;
+				send_next_ping_request(target_index);
+			}
+
+			arm_send_timer();
+			refill_targets();
+			flush_ping_requests();
+			finish_completed_executions();
+			arm_timeout_timer();
+			stop_if_completed();
+		}
+
+		//It checks if there are target hosts being resolved or ICMP echo requests still to be sent or to be answered
+		bool icmp_v4_ping_executor::has_pending_work() const
+		{
+			bool ret = false;
+
+			if ((!m_in_flight_probes.empty()) ||
+				(!m_scheduled_requests.empty()) ||
+				(m_transport->nr_of_queued_requests() > 0) ||
+				(m_nr_of_pending_resolutions > 0))
+			{
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It stops waiting on the timers and the transport once there is nothing left to resolve, to send or to wait for
+		//The reactor thread keeps running the async engine, idle until the next submission
+		void icmp_v4_ping_executor::stop_if_completed()
+		{
+			if (!has_pending_work())
+			{
+				m_timer_ptr->cancel();
+				m_send_timer_ptr->cancel();
+				m_transport->cancel();
+			}
+		}
+
+		//It returns a sequence number that does not collide with any in-flight ICMP echo request
+		unsigned short icmp_v4_ping_executor::get_next_sequence_number()
+		{
+			do
+			{
+				if (m_sequence_number == ipv4_header::MAX_IDENTIFIER_POSSIBLE)
+				{
+					m_sequence_number = 0;
+				}
+				++m_sequence_number;
+			} while (m_in_flight_probes.count(get_probe_key(m_packet_identifier, m_sequence_number)) > 0);
+
+			return m_sequence_number;
+		}
+
+		//It adds the metrics gathered since the last finished execution, the only time the metrics mutex is taken
+		//Concurrent executions share the engine, so whatever they did meanwhile goes in along with them
+		void icmp_v4_ping_executor::store_execution_metrics()
+		{
+			m_engine_metrics.store_execution(m_execution_metrics);
+			m_execution_metrics.clear();
+		}
+
+		//It enables or disables batched I/O mode, it can only be enabled where it is supported
+		//Executions running on the previous socket keep it until they are done, the next ones wait for them
+		void icmp_v4_ping_executor::set_batched_io(const bool enabled)
+		{
+			std::lock_guard<std::mutex> guard(m_settings_mutex);
+
+			//kernel timestamps are set up along with the socket, so it has to be rebuilt
+			if (m_socket_transport.set_batched_io(enabled))
+			{
+				m_settings_changed = true;
+			}
+		}
+
+		//It picks the kind of ICMP socket to use, the engine gets rebuilt with it on next submission
+		void icmp_v4_ping_executor::set_socket_type(const SOCKET_TYPE socket_type)
+		{
+			std::lock_guard<std::mutex> guard(m_settings_mutex);
+
+			if (m_socket_transport.set_socket_type(socket_type))
+			{
+				m_settings_changed = true;
+			}
+		}
+
+		//It narrows the ICMP identifiers raw sockets can pick from, so engines running side by side never share one
+		//The engine gets rebuilt with it on next submission
+		void icmp_v4_ping_executor::set_identifier_range(const unsigned short first_identifier, const unsigned short last_identifier)
+		{
+			std::lock_guard<std::mutex> guard(m_settings_mutex);
+
+			if (m_socket_transport.set_identifier_range(first_identifier, last_identifier))
+			{
+				m_settings_changed = true;
+			}
+		}
+
+		//It pins the reactor thread to the given CPU, it only works on Linux
+		//Pinning is done by the reactor thread itself, right away if it is running or as soon as it starts
+		void icmp_v4_ping_executor::set_reactor_cpu(const unsigned int cpu)
+		{
+			boost::asio::post(m_async_engine, [cpu]()
+			{
+				pin_current_thread(cpu);
+			});
+		}
+
+		//It returns the kind of ICMP socket the engine is running on
+		icmp_v4_ping_executor::SOCKET_TYPE icmp_v4_ping_executor::get_socket_type()
+		{
+			std::lock_guard<std::mutex> guard(m_settings_mutex);
+
+			return m_socket_transport.get_socket_type();
+		}
+
+		//It returns the resolver cache shared across executions
+		resolver_cache& icmp_v4_ping_executor::get_resolver_cache()
+		{
+			return m_resolver_cache;
+		}
+
+		//It returns the per target host round trip time estimator shared across executions
+		rtt_estimator& icmp_v4_ping_executor::get_rtt_estimator()
+		{
+			return m_rtt_estimator;
+		}
+
+		//It returns the send pacer shared with other engines, if requests are being paced at all
+		send_pacer* icmp_v4_ping_executor::get_send_pacer()
+		{
+			return m_send_pacer;
+		}
+
+		//It returns the latency histograms shared with other engines, if round trip times are being tracked at all
+		latency_tracker* icmp_v4_ping_executor::get_latency_tracker()
+		{
+			return m_latency_tracker;
+		}
+
+		//It returns the hot path metrics of every execution so far
+		engine_metrics& icmp_v4_ping_executor::get_engine_metrics()
+		{
+			return m_engine_metrics;
+		}
+
+		//It turns the given compact result into response data, this is where its response address becomes text
+		void icmp_v4_ping_executor::get_response_data(const ping_result_record& result, const std::string& target_hostname, ping_response_data& response_data)
+		{
+			response_data.ready = result.ready;
+			response_data.type = static_cast<ping_response_data::RESPONSE_TYPE>(result.type);
+			response_data.valid_checksum = result.valid_checksum;
+			response_data.time_to_live = result.time_to_live;
+			response_data.address_family = result.address_family;
+			response_data.packet_identifier = result.packet_identifier;
+			response_data.sequence_number = result.sequence_number;
+			response_data.round_trip_time = static_cast<size_t>(result.round_trip_time_us / 1000);
+			response_data.round_trip_time_us = static_cast<size_t>(result.round_trip_time_us);
+			response_data.target_hostname.assign(target_hostname);
+			response_data.response_address = ping_result_pool::get_response_address_text(result);
+		}
+
+		//It verifies both the IPV4 header and the ICMP packet checksums of a received reply
+		bool icmp_v4_ping_executor::is_reply_checksum_valid(const ipv4_header& ipv4_hdr, const icmp_header& icmp_hdr)
+		{
+			bool ret = false;
+
+			if (icmp_hdr.is_checksum_valid())
+			{
+#if defined(__APPLE__) || defined(__FreeBSD__)
+				//BSD raw sockets hand the IPV4 header over with some fields already taken to host order,
+				//so its original checksum cannot be verified anymore
+				ret = true;
+#else
+				ret = ipv4_hdr.is_checksum_valid();
+#endif
+			}
+
+			return ret;
+		}
+
+		//It verifies the checksum of a received ICMPv6 reply, it covers the IPV6 pseudo header too
+		//Replies whose destination address is unknown were already verified by the kernel before queueing them
+		bool icmp_v4_ping_executor::is_icmpv6_reply_checksum_valid(const icmp_header& icmp_hdr, const icmp_socket_batch::reply_metadata& metadata)
+		{
+			bool ret = true;
+
+			if ((metadata.destination_address.is_v6()) &&
+				(!metadata.destination_address.is_unspecified()))
+			{
+				uint64_t pseudo_header_sum = internet_checksum_add_ipv6_pseudo_header(metadata.source_endpoint.address().to_v6().to_bytes().data(),
+					metadata.destination_address.to_v6().to_bytes().data(),
+					static_cast<uint32_t>(icmp_hdr.size()),
+					IPPROTO_ICMPV6,
+					0);
+
+				ret = icmp_hdr.is_checksum_valid(pseudo_header_sum);
+			}
+
+			return ret;
+		}
+
+		//It checks if the given error means that the socket cannot be used anymore
+		//Running out of buffer space or memory is only transient, the send queue of the socket is full for a while,
+		//so those echoes are just lost and the socket keeps being used
+		bool icmp_v4_ping_executor::is_socket_failure(const boost::system::error_code& error_code)
+		{
+			bool ret = false;
+
+			if ((error_code == boost::asio::error::bad_descriptor) ||
+				(error_code == boost::asio::error::not_socket) ||
+				(error_code == boost::asio::error::shut_down))
+			{
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It returns the error code the given exception is counted with on the engine metrics
+		//System errors keep their own one, anything else is counted as a state that could not be recovered
+		boost::system::error_code icmp_v4_ping_executor::get_exception_error_code(const std::exception_ptr& exception)
+		{
+			boost::system::error_code ret = boost::system::errc::make_error_code(boost::system::errc::state_not_recoverable);
+
+			try
+			{
+				if (exception)
+				{
+					std::rethrow_exception(exception);
+				}
+			}
+			catch (boost::system::system_error const& ex)
+			{
+				ret = ex.code();
+			}
+			catch (std::bad_alloc const&)
+			{
+				ret = boost::system::errc::make_error_code(boost::system::errc::not_enough_memory);
+			}
+			catch (...)
+			{
+				//anything else keeps the default error code
+			}
+
+			return ret;
+		}
+
+		//It packs the (identifier, sequence number) pair used to match replies against requests
+		unsigned int icmp_v4_ping_executor::get_probe_key(const unsigned short identifier, const unsigned short sequence_number)
+		{
+			return (static_cast<unsigned int>(identifier) << 16) | sequence_number;
+		}
+
+		//It returns the key the round trip time estimator uses for the given target host
+		//IPV6 addresses are hashed (FNV-1a) with the highest bit set, so they do not collide with IPV4 ones
+		unsigned long icmp_v4_ping_executor::get_target_address(const probe_target& target)
+		{
+			unsigned long ret = 0;
+
+			if (target.resolved_endpoint.address().is_v6())
+			{
+				uint64_t address_hash = 14695981039346656037ULL;
+				for (unsigned char address_byte : target.resolved_endpoint.address().to_v6().to_bytes())
+				{
+					address_hash = (address_hash ^ address_byte) * 1099511628211ULL;
+				}
+
+				ret = static_cast<unsigned long>(address_hash) | (~(~0UL >> 1));
+			}
+			else
+			{
+				ret = target.resolved_endpoint.address().to_v4().to_ulong();
+			}
+
+			return ret;
+		}
+
+		//It returns the address family (4 or 6) of the given endpoint
+		unsigned int icmp_v4_ping_executor::get_address_family(const icmp::endpoint& endpoint)
+		{
+			return (endpoint.address().is_v6()) ? icmp_transport::IPV6_FAMILY : icmp_transport::IPV4_FAMILY;
+		}
+
+		//It returns the address family target hosts that could not be resolved are reported on, the first requested one
+		unsigned int icmp_v4_ping_executor::get_not_found_address_family(const size_t target_index) const
+		{
+			return (get_target_execution(target_index).options.address_family == icmp_transport::IPV6_FAMILY) ? icmp_transport::IPV6_FAMILY : icmp_transport::IPV4_FAMILY;
+		}
+
+		//It returns the current CLOCK_REALTIME time, the clock kernel timestamps are taken from
+		std::chrono::nanoseconds icmp_v4_ping_executor::get_wall_clock_time()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+		}
+
+		//It packs the (target host, sequence number) pair carried by batched I/O requests
+		uint64_t icmp_v4_ping_executor::get_request_tag(const size_t target_index, const unsigned short sequence_number)
+		{
+			return (static_cast<uint64_t>(target_index) << 16) | sequence_number;
+		}
+
+		//It pins the calling thread to the given CPU, CPUs out of the range of the host are taken modulo its CPU count
+		bool icmp_v4_ping_executor::pin_current_thread(const unsigned int cpu)
+		{
+			bool ret = false;
+
+#if defined(__linux__)
+			unsigned int nr_of_cpus = std::max(1U, std::thread::hardware_concurrency());
+
+			cpu_set_t cpu_set;
+			CPU_ZERO(&cpu_set);
+			CPU_SET(cpu % nr_of_cpus, &cpu_set);
+			if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0)
+			{
+				ret = true;
+			}
+#endif
 
 			return ret;
 		}
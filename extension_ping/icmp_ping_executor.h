@@ -2,7 +2,31 @@
 
 #include <boost/asio.hpp>
 #include <boost/bind/bind.hpp>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "engine_metrics.h"
+#include "icmp_packet.h"
+#include "icmp_socket_batch.h"
+#include "icmp_socket_transport.h"
+#include "icmp_transport.h"
+#include "ipv4_packet.h"
+#include "latency_tracker.h"
+#include "mpsc_queue.h"
+#include "ping_result_pool.h"
+#include "resolver_cache.h"
+#include "rtt_estimator.h"
+#include "rtt_statistics.h"
+#include "send_pacer.h"
 
 using boost::asio::ip::icmp;
 using boost::asio::steady_timer;
@@ -34,9 +58,11 @@ namespace utils
                 type = RESPONSE_TYPE::EMPTY;
                 valid_checksum = false;
                 time_to_live = 0;
+                address_family = icmp_transport::IPV4_FAMILY;
                 packet_identifier = 0;
                 sequence_number = 0;
                 round_trip_time = 0;
+                round_trip_time_us = 0;
                 target_hostname.clear();
                 response_address.clear();
             }
@@ -47,9 +73,11 @@ namespace utils
             RESPONSE_TYPE type;
             bool valid_checksum;
             unsigned int time_to_live;
+            unsigned int address_family;
             unsigned int packet_identifier;
             unsigned int sequence_number;
             size_t round_trip_time;
+            size_t round_trip_time_us;
             std::string target_hostname;
             std::string response_address;
 
@@ -57,44 +85,371 @@ namespace utils
 
         typedef std::vector<ping_response_data> ping_response_data_collection;
 
-        //ICMP V4 Echo Request/Reply helper class
+        //icmp echo request execution options
+        //A zero request interval keeps the classic mode where each echo waits for its reply or timeout,
+        //a non-zero one pipelines the echoes of each target host on that interval, like ping -i does
+        //A zero timeout lets each target host get its timeout from its round trip time history
+        //Dual-stack mode probes both the IPV4 and the IPV6 address of each hostname at the same time, IP addresses
+        //are always probed on their own family
+        typedef struct ping_request_options_unit
+        {
+            //Some magic data
+            static constexpr size_t MAX_NR_OF_PING_REQUESTS = 100;
+            static constexpr unsigned int MAX_REQUEST_INTERVAL_IN_MS = 60000;
+            static constexpr unsigned int MAX_TIMEOUT_IN_MS = 60000;
+            static constexpr size_t DEFAULT_PAYLOAD_SIZE_IN_BYTES = 18;
+            static constexpr size_t MAX_PAYLOAD_SIZE_IN_BYTES = 65507;
+
+            ping_request_options_unit() :
+                nr_of_ping_requests(1),
+                request_interval(chrono::milliseconds::zero()),
+                timeout(chrono::milliseconds::zero()),
+                payload_size(DEFAULT_PAYLOAD_SIZE_IN_BYTES),
+                address_family(icmp_transport::IPV4_FAMILY) {}
+
+            bool is_pipelined() const { return (request_interval > chrono::milliseconds::zero()); }
+            bool has_fixed_timeout() const { return (timeout > chrono::milliseconds::zero()); }
+            bool is_valid() const
+            {
+                return ((nr_of_ping_requests > 0) &&
+                    (nr_of_ping_requests <= MAX_NR_OF_PING_REQUESTS) &&
+                    (request_interval >= chrono::milliseconds::zero()) &&
+                    (request_interval <= chrono::milliseconds(MAX_REQUEST_INTERVAL_IN_MS)) &&
+                    (timeout >= chrono::milliseconds::zero()) &&
+                    (timeout <= chrono::milliseconds(MAX_TIMEOUT_IN_MS)) &&
+                    (payload_size <= MAX_PAYLOAD_SIZE_IN_BYTES) &&
+                    ((address_family == icmp_transport::IPV4_FAMILY) ||
+                     (address_family == icmp_transport::IPV6_FAMILY) ||
+                     (address_family == icmp_transport::DUAL_STACK_FAMILY)));
+            }
+
+            size_t nr_of_ping_requests;
+            chrono::milliseconds request_interval;
+            chrono::milliseconds timeout;
+            size_t payload_size;
+            icmp_transport::ADDRESS_FAMILY address_family;
+
+        } ping_request_options;
+
+        //per target host statistics data object, aggregated executions return one per target host
+        //and address family
+        typedef struct ping_statistics_data_unit
+        {
+            ping_statistics_data_unit() :
+                target_found(false),
+                address_family(icmp_transport::IPV4_FAMILY) {}
+
+            bool target_found;
+            unsigned int address_family;
+            std::string target_hostname;
+            std::string response_address;
+            rtt_statistics statistics;
+
+        } ping_statistics_data;
+
+        typedef std::vector<ping_statistics_data> ping_statistics_data_collection;
+
+        //ICMP V4 Echo Request/Reply helper class, it speaks ICMPv6 too despite its name
+        //All the requested target hosts are probed at once through a single io_context and transport,
+        //ICMP Echo Replies are matched back to their requests by (identifier, sequence number)
+        //Dual-stack target hosts take a companion slot for their IPV6 address, so both families are probed
+        //at the same time on the same engine and the execution does not take any longer
+        //Executions can be submitted from any number of threads, they go through a lock-free queue to a single
+        //reactor thread that owns the engine and runs every submitted execution at the same time, so concurrent
+        //queries overlap on the wire instead of waiting for each other
+        //Submissions complete through a future or a callback, execute() just submits and waits for the future
+        //Callbacks (target host sources, response and completion handlers) are called from the reactor thread,
+        //so they must not submit and wait on the same executor
+        //The io_context, timer and transport are long-lived, they are kept open across executions
+        //and they only get rebuilt after a socket error
+        //The transport is an ICMP socket unless another one is given, like a simulated network on tests
+        //Every ICMP echo request can be paced through a send pacer shared with other engines, requests without
+        //a send slot yet wait for it on the send timer
+        //Round trip times can also feed latency histograms shared with other engines, sweeps are left out of them
+        //Streaming executions pull their target hosts from a source and keep only a bounded window of them
+        //in flight, results are handed over as each target host completes instead of being gathered
+        //Results are kept as compact records while the execution runs, they only turn into response data when
+        //they are handed over, result pools and result handlers take them as they are
+        //Every execution is timed stage by stage and its events and errors are counted, the engine metrics
+        //keep adding them up across executions
         class icmp_v4_ping_executor
         {
         public:
+            //Some magic data
+            static constexpr size_t DEFAULT_MAX_TARGETS_IN_FLIGHT = 1024;
+
+            //streaming execution callbacks, the source returns false once it has no more target hosts
+            //It can also return true with an empty target host while it has none ready yet, executions then ask
+            //it again once they get resumed
+            typedef std::function<bool(std::string& target_host)> target_host_source;
+            typedef std::function<void(ping_response_data& response_data)> response_handler;
 
-            icmp_v4_ping_executor() :
-                m_reply_available(false),
-                m_async_engine_ptr(nullptr),
-                m_socket_ptr(nullptr),
+            //compact streaming callback, the target hostname is only valid during the call
+            typedef std::function<void(const ping_result_record& result, const std::string& target_hostname)> result_handler;
+
+            //submission completion callback, the response data is only valid during the call
+            typedef std::function<void(const bool succeeded, ping_response_data_collection& response_data)> completion_handler;
+
+
+            //ICMP socket kinds of the default transport
+            typedef icmp_socket_transport::SOCKET_TYPE SOCKET_TYPE;
+            static constexpr SOCKET_TYPE AUTOMATIC_SOCKET = icmp_socket_transport::AUTOMATIC_SOCKET;
+            static constexpr SOCKET_TYPE DATAGRAM_SOCKET = icmp_socket_transport::DATAGRAM_SOCKET;
+            static constexpr SOCKET_TYPE RAW_SOCKET = icmp_socket_transport::RAW_SOCKET;
+
+            explicit icmp_v4_ping_executor(send_pacer* pacer = nullptr, latency_tracker* tracker = nullptr, icmp_transport* transport = nullptr) :
+                m_reactor_stop_requested(false),
+                m_settings_changed(false),
                 m_timer_ptr(nullptr),
+                m_send_timer_ptr(nullptr),
                 m_sequence_number(0),
-                m_packet_identifier(0) {}
+                m_packet_identifier(0),
+                m_rebuild_required(false),
+                m_max_request_size(0),
+                m_nr_of_pending_resolutions(0),
+                m_engine_epoch(0),
+                m_waiting_for_writable_socket(false),
+                m_transport((transport) ? transport : &m_socket_transport),
+                m_send_pacer(pacer),
+                m_latency_tracker(tracker),
+                m_busy_time(chrono::microseconds::zero()),
+                m_deferred_start_posted(false) {}
+
+            //given transports might outlive the executor, so they have to let go of its async engine
+            ~icmp_v4_ping_executor()
+            {
+                stop_reactor();
+                m_transport->close();
+            }
 
             bool execute(const std::string& target_host, const size_t nr_of_ping_requests, ping_response_data_collection& response_data);
+            bool execute(const std::vector<std::string>& target_hosts, const size_t nr_of_ping_requests, ping_response_data_collection& response_data);
+            bool execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_response_data_collection& response_data);
+            bool execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_statistics_data_collection& statistics_data);
+            bool execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_result_pool& result_pool);
+            bool execute(const target_host_source& next_target_host, const ping_request_options& options, const response_handler& on_response, const size_t max_targets_in_flight = DEFAULT_MAX_TARGETS_IN_FLIGHT);
+            bool execute(const target_host_source& next_target_host, const ping_request_options& options, const result_handler& on_result, const size_t max_targets_in_flight = DEFAULT_MAX_TARGETS_IN_FLIGHT);
+            std::future<bool> submit(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_response_data_collection& response_data);
+            std::future<bool> submit(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_statistics_data_collection& statistics_data);
+            std::future<bool> submit(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_result_pool& result_pool);
+            std::future<bool> submit(const target_host_source& next_target_host, const ping_request_options& options, const response_handler& on_response, const size_t max_targets_in_flight = DEFAULT_MAX_TARGETS_IN_FLIGHT);
+            std::future<bool> submit(const target_host_source& next_target_host, const ping_request_options& options, const result_handler& on_result, const size_t max_targets_in_flight = DEFAULT_MAX_TARGETS_IN_FLIGHT);
+            bool submit(const std::vector<std::string>& target_hosts, const ping_request_options& options, const completion_handler& on_completed);
+            bool submit(const target_host_source& next_target_host, const ping_request_options& options, const result_handler& on_result, const completion_handler& on_completed, const size_t max_targets_in_flight = DEFAULT_MAX_TARGETS_IN_FLIGHT);
+            void resume_target_sources();
+            void set_batched_io(const bool enabled);
+            void set_socket_type(const SOCKET_TYPE socket_type);
+            void set_identifier_range(const unsigned short first_identifier, const unsigned short last_identifier);
+            void set_reactor_cpu(const unsigned int cpu);
+            SOCKET_TYPE get_socket_type();
+            resolver_cache& get_resolver_cache();
+            rtt_estimator& get_rtt_estimator();
+            send_pacer* get_send_pacer();
+            latency_tracker* get_latency_tracker();
+            engine_metrics& get_engine_metrics();
+            static void get_response_data(const ping_result_record& result, const std::string& target_hostname, ping_response_data& response_data);
 
         private:
+            //benchmarks drive the per packet steps directly, with no socket around them
+            friend class icmp_v4_ping_executor_benchmark;
+
+            //Some magic data
+            static constexpr const char* ECHO_REQUEST_PAYLOAD = "Hello from OSQUERY";
+            static_assert(std::char_traits<char>::length(ECHO_REQUEST_PAYLOAD) == ping_request_options::DEFAULT_PAYLOAD_SIZE_IN_BYTES, "Default payload size does not match the default payload");
+            static constexpr size_t MAX_NR_OF_ECHOES_IN_FLIGHT = 32768;
+            static constexpr size_t NO_COMPANION = static_cast<size_t>(-1);
+
+            typedef enum
+            {
+                RESULTS_EXECUTION = 0,
+                STATISTICS_EXECUTION,
+                STREAMING_EXECUTION
+            } EXECUTION_TYPE;
+
+            //submitted execution, it is built by the submitting thread and owned by the reactor once queued
+            //Results go to the caller collections or result pool, or to the owned collection when a completion handler
+            //takes them
+            typedef struct ping_execution_unit
+            {
+                ping_execution_unit() :
+                    type(RESULTS_EXECUTION),
+                    max_targets_in_flight(0),
+                    response_data(nullptr),
+                    statistics_data(nullptr),
+                    result_pool(nullptr),
+                    nr_of_active_targets(0),
+                    nr_of_responses(0),
+                    target_source_exhausted(true),
+                    handler_failed(false),
+                    busy_time_at_start(chrono::microseconds::zero()) {}
+
+                EXECUTION_TYPE type;
+                ping_request_options options;
+                std::vector<std::string> target_hosts;
+                target_host_source target_source;
+                result_handler on_result;
+                size_t max_targets_in_flight;
+                completion_handler on_completed;
+                ping_response_data_collection* response_data;
+                ping_statistics_data_collection* statistics_data;
+                ping_result_pool* result_pool;
+                ping_response_data_collection owned_response_data;
+                std::promise<bool> completion;
+                chrono::steady_clock::time_point submission_time;
+
+                //reactor side state
+                std::vector<unsigned char> request_payload;
+                std::vector<size_t> target_indexes;
+                size_t nr_of_active_targets;
+                size_t nr_of_responses;
+                bool target_source_exhausted;
+                bool handler_failed;  //a caller callback threw, so the execution gets no more calls and finishes with false
+                chrono::steady_clock::time_point start_time;
+                chrono::microseconds busy_time_at_start;
+            } ping_execution;
+
+            typedef std::unique_ptr<ping_execution> ping_execution_ptr;
+
+            typedef std::multimap<chrono::steady_clock::time_point, unsigned int> probe_deadline_collection;
+            typedef std::multimap<chrono::steady_clock::time_point, size_t> scheduled_request_collection;
+
+            //per target host execution state
+            //Results are compact records until the execution hands them over, the target hostname is kept once
+            //per slot and it is only interned when results go to a result pool
+            typedef struct probe_target_unit
+            {
+                std::string target_hostname;
+                uint32_t host_id;
+                icmp::endpoint resolved_endpoint;
+                size_t nr_of_pending_requests;
+                size_t nr_of_unfinished_requests;
+                size_t nr_of_scheduled_requests;
+                size_t execution_index;
+                bool in_use;
+                bool is_completed;
+                bool send_slot_reserved;
+                size_t companion_index;
+                bool is_companion;
+                std::vector<ping_result_record> results;
+                rtt_statistics statistics;
+            } probe_target;
+
+            //ICMP Echo Request waiting for its ICMP Echo Reply
+            typedef struct in_flight_probe_unit
+            {
+                size_t target_index;
+                size_t result_index;
+                chrono::steady_clock::time_point request_sent_time;
+                std::chrono::nanoseconds request_sent_wall_time;
+                probe_deadline_collection::iterator deadline_it;
+            } in_flight_probe;
+
+            typedef std::unordered_map<unsigned int, in_flight_probe> in_flight_probe_collection;
+
             //private helper methods
-            bool send_one_ping_request(const std::string& target_host, ping_response_data_unit& execution_result);
-            bool reset_internal_state();
-            bool trigger_icmp_ping_async_flow(const std::string& target_host, bool& should_run_callbacks);
-            bool get_icmp_echo_request_packet_bytes(boost::asio::streambuf& packet_bytes);
+            std::future<bool> submit_execution(ping_execution_ptr execution);
+            void start_reactor();
+            void stop_reactor();
+            void run_reactor();
+            void start_submissions();
+            void handle_resume();
+            void start_execution(ping_execution_ptr execution);
+            void finish_completed_executions();
+            void finish_execution(const size_t execution_index);
+            void abort_executions();
+            void fail_execution(ping_execution& execution);
+            bool has_running_executions() const;
+            bool is_rebuild_pending();
+            void start_deferred_executions_if_idle();
+            ping_execution& get_target_execution(const size_t target_index);
+            const ping_execution& get_target_execution(const size_t target_index) const;
+            static void prepare_request_payload(const size_t payload_size, std::vector<unsigned char>& request_payload);
+            bool prepare_engine(const size_t max_request_size);
+            bool rebuild_engine();
             bool is_ready();
-            unsigned short get_packet_identifier();
+            size_t allocate_target(const size_t execution_index);
+            void start_target(const size_t target_index, const std::string& target_host);
+            void setup_target(const size_t target_index, const std::string& target_host);
+            void allocate_companion(const size_t target_index);
+            void release_companion(const size_t target_index);
+            void get_gathering_order(const ping_execution& execution, std::vector<size_t>& target_indexes) const;
+            void refill_targets();
+            size_t get_nr_of_reserved_echoes() const;
+            void release_target_if_completed(const size_t target_index);
+            bool resolve_target(const size_t target_index);
+            void handle_resolve(const size_t target_index, const size_t engine_epoch, const chrono::steady_clock::time_point& resolution_start_time, const boost::system::error_code& error_code, const icmp::resolver::results_type& results);
+            bool assign_resolution(const size_t target_index, const icmp::endpoint& ipv4_endpoint, const icmp::endpoint& ipv6_endpoint);
+            void store_target_not_found(const size_t target_index);
+            bool send_next_ping_request(const size_t target_index);
+            void flush_ping_requests();
+            void register_sent_request(const size_t target_index, const unsigned short sequence_number, const chrono::steady_clock::time_point& request_sent_time);
+            static size_t get_icmp_echo_request_packet_size(const ping_execution& execution);
+            bool get_icmp_echo_request_packet_bytes(const unsigned short sequence_number, const bool is_ipv6, const std::vector<unsigned char>& request_payload, unsigned char* packet_bytes, const size_t packet_size);
+            void start_receive();
+            void handle_receive(const boost::system::error_code& error_code);
+            int drain_transport();
+            void continue_receiving(const boost::system::error_code& error_code);
+            in_flight_probe_collection::iterator match_reply(unsigned char* reply_bytes, const size_t reply_size, const bool is_ipv6_reply, ipv4_header& ipv4_hdr, icmp_header& icmp_hdr);
+            void process_reply(unsigned char* reply_bytes, const size_t reply_size, const icmp_socket_batch::reply_metadata& metadata);
+            void process_transmit_timestamp(const unsigned char* packet_bytes, const size_t packet_size, const icmp_socket_batch::reply_metadata& metadata);
+            void arm_timeout_timer();
+            void handle_timeout(const boost::system::error_code& error_code);
+            void schedule_next_ping_request(const size_t target_index, const chrono::steady_clock::time_point& send_time);
+            void arm_send_timer();
+            void handle_send_timer(const boost::system::error_code& error_code);
+            void complete_probe(const size_t target_index, const size_t result_index, const ping_result_record& result);
+            bool has_pending_work() const;
+            void stop_if_completed();
+            unsigned short get_next_sequence_number();
+            void store_execution_metrics();
+            unsigned int get_not_found_address_family(const size_t target_index) const;
+            static bool is_reply_checksum_valid(const ipv4_header& ipv4_hdr, const icmp_header& icmp_hdr);
+            static bool is_icmpv6_reply_checksum_valid(const icmp_header& icmp_hdr, const icmp_socket_batch::reply_metadata& metadata);
+            static unsigned int get_address_family(const icmp::endpoint& endpoint);
+            static bool is_socket_failure(const boost::system::error_code& error_code);
+            static boost::system::error_code get_exception_error_code(const std::exception_ptr& exception);
+            static unsigned int get_probe_key(const unsigned short identifier, const unsigned short sequence_number);
+            static std::chrono::nanoseconds get_wall_clock_time();
+            static unsigned long get_target_address(const probe_target& target);
+            static uint64_t get_request_tag(const size_t target_index, const unsigned short sequence_number);
+            static bool pin_current_thread(const unsigned int cpu);
 
             //member vars
-            bool m_reply_available;
-            boost::shared_ptr<boost::asio::io_context> m_async_engine_ptr;
-            boost::shared_ptr<icmp::socket> m_socket_ptr;
+            boost::asio::io_context m_async_engine;
+            mpsc_queue<ping_execution_ptr> m_submissions;
+            std::once_flag m_reactor_started;
+            std::thread m_reactor_thread;
+            std::atomic<bool> m_reactor_stop_requested;
+            std::mutex m_settings_mutex;
+            std::atomic<bool> m_settings_changed;
             boost::shared_ptr<steady_timer> m_timer_ptr;
+            boost::shared_ptr<steady_timer> m_send_timer_ptr;
             unsigned short m_sequence_number;
             unsigned short m_packet_identifier;
-            std::mutex m_serialize_execute_mutex;
-            chrono::steady_clock::time_point m_request_sent_time;
-            boost::asio::streambuf m_reply_buffer;
-            ping_response_data_unit m_work_execution_result;
+            bool m_rebuild_required;
+            size_t m_max_request_size;
+            size_t m_nr_of_pending_resolutions;
+            size_t m_engine_epoch;
+            resolver_cache m_resolver_cache;
+            rtt_estimator m_rtt_estimator;
+            bool m_waiting_for_writable_socket;
+            icmp_socket_transport m_socket_transport;
+            icmp_transport* m_transport;
+            send_pacer* m_send_pacer;
+            latency_tracker* m_latency_tracker;
+            engine_metrics m_engine_metrics;
+            engine_metrics::metrics_data m_execution_metrics;
+            chrono::microseconds m_busy_time;
+            std::vector<ping_execution_ptr> m_executions;
+            std::vector<size_t> m_free_execution_slots;
+            std::vector<ping_execution_ptr> m_deferred_executions;
+            bool m_deferred_start_posted;
+            std::vector<probe_target> m_targets;
+            std::vector<size_t> m_free_target_slots;
+            in_flight_probe_collection m_in_flight_probes;
+            probe_deadline_collection m_probe_deadlines;
+            scheduled_request_collection m_scheduled_requests;
         };
 
     }
 }
-
-
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "icmp_socket_batch.h"
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
+
+namespace utils
+{
+	namespace ping
+	{
+		//It tells if batched I/O is available on this platform
+		bool icmp_socket_batch::is_supported()
+		{
+#if defined(__linux__)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		//It asks the kernel to timestamp incoming packets and, when possible, outgoing ones too
+		//Transmit timestamps are looped back through the socket error queue along with the sent packet
+		bool icmp_socket_batch::enable_kernel_timestamps(const int native_socket, bool& transmit_timestamps_enabled)
+		{
+			bool ret = false;
+
+			transmit_timestamps_enabled = false;
+
+#if defined(__linux__)
+			int enabled = 1;
+			if (setsockopt(native_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled)) == 0)
+			{
+				ret = true;
+
+				int timestamping_flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+				if (setsockopt(native_socket, SOL_SOCKET, SO_TIMESTAMPING, &timestamping_flags, sizeof(timestamping_flags)) == 0)
+				{
+					transmit_timestamps_enabled = true;
+				}
+			}
+#endif
+
+			return ret;
+		}
+
+		//It preallocates the reply ring and the syscall headers for the given batch and reply slot sizes
+		//It is a no-op when the current ring is already big enough
+		void icmp_socket_batch::configure(const size_t batch_size, const size_t reply_slot_size)
+		{
+			if ((batch_size > 0) &&
+				((batch_size != m_batch_size) ||
+				 (reply_slot_size > m_reply_slot_size)))
+			{
+				m_batch_size = batch_size;
+				m_reply_slot_size = std::max(m_reply_slot_size, reply_slot_size);
+				m_reply_ring.assign(m_batch_size * m_reply_slot_size, 0);
+				m_control_ring.assign(m_batch_size * CONTROL_SLOT_SIZE_IN_BYTES, 0);
+
+#if defined(__linux__)
+				m_request_headers.assign(m_batch_size, mmsghdr());
+				m_request_vectors.assign(m_batch_size, iovec());
+				m_reply_headers.assign(m_batch_size, mmsghdr());
+				m_reply_vectors.assign(m_batch_size, iovec());
+				m_reply_addresses.assign(m_batch_size, sockaddr_storage());
+
+				//every reply slot is bound to its own piece of the ring once and for all
+				for (size_t it = 0; it < m_batch_size; ++it)
+				{
+					m_reply_vectors[it].iov_base = m_reply_ring.data() + (it * m_reply_slot_size);
+					m_reply_vectors[it].iov_len = m_reply_slot_size;
+					m_reply_headers[it].msg_hdr.msg_iov = &m_reply_vectors[it];
+					m_reply_headers[it].msg_hdr.msg_iovlen = 1;
+				}
+#endif
+			}
+		}
+
+		//It queues an outgoing packet and returns the bytes where it has to be built
+		//Slots are reused across flushes, so their bytes only get allocated the first time they are needed
+		unsigned char* icmp_socket_batch::queue_request(const icmp::endpoint& destination, const size_t packet_size, const uint64_t request_tag)
+		{
+			unsigned char* ret = nullptr;
+
+			size_t slot_index = m_first_queued_request + m_nr_of_queued_requests;
+			if (slot_index >= m_request_slots.size())
+			{
+				m_request_slots.resize(slot_index + 1);
+			}
+
+			queued_request& slot = m_request_slots[slot_index];
+			slot.request_tag = request_tag;
+			slot.packet_size = packet_size;
+			if (slot.packet_bytes.size() < packet_size)
+			{
+				slot.packet_bytes.resize(packet_size);
+			}
+
+#if defined(__linux__)
+			std::memcpy(&slot.destination, destination.data(), destination.size());
+			slot.destination_size = static_cast<socklen_t>(destination.size());
+#endif
+
+			++m_nr_of_queued_requests;
+			ret = slot.packet_bytes.data();
+
+			return ret;
+		}
+
+		//It sends every queued packet, batch_size packets per syscall
+		//The callback gets each request tag along with 0 on success or the errno of its failure,
+		//requests queued from within the callback are flushed too
+		//It returns 0, or EAGAIN/ENOBUFS if the socket could not take more packets and some are still queued
+		int icmp_socket_batch::flush_requests(const int native_socket, const request_done_callback& on_request_done)
+		{
+			int ret = 0;
+
+#if defined(__linux__)
+			while ((ret == 0) &&
+				(m_nr_of_queued_requests > 0))
+			{
+				size_t nr_of_messages = std::min(m_nr_of_queued_requests, m_batch_size);
+				for (size_t it = 0; it < nr_of_messages; ++it)
+				{
+					queued_request& slot = m_request_slots[m_first_queued_request + it];
+
+					m_request_vectors[it].iov_base = slot.packet_bytes.data();
+					m_request_vectors[it].iov_len = slot.packet_size;
+					m_request_headers[it].msg_hdr = msghdr();
+					m_request_headers[it].msg_hdr.msg_name = &slot.destination;
+					m_request_headers[it].msg_hdr.msg_namelen = slot.destination_size;
+					m_request_headers[it].msg_hdr.msg_iov = &m_request_vectors[it];
+					m_request_headers[it].msg_hdr.msg_iovlen = 1;
+				}
+
+				int nr_of_sent_messages = sendmmsg(native_socket, m_request_headers.data(), static_cast<unsigned int>(nr_of_messages), MSG_DONTWAIT);
+				int send_error = (nr_of_sent_messages < 0) ? errno : 0;
+
+				if ((send_error == EAGAIN) ||
+					(send_error == EWOULDBLOCK) ||
+					(send_error == ENOBUFS))
+				{
+					//socket is full, the rest of the queue waits until it becomes writable
+					ret = send_error;
+				}
+				else
+				{
+					//sendmmsg stops on the first failing message, so that one is reported and skipped
+					size_t nr_of_done_messages = (nr_of_sent_messages > 0) ? static_cast<size_t>(nr_of_sent_messages) : 1;
+					size_t first_done_request = m_first_queued_request;
+
+					m_first_queued_request += nr_of_done_messages;
+					m_nr_of_queued_requests -= nr_of_done_messages;
+
+					for (size_t it = 0; it < nr_of_done_messages; ++it)
+					{
+						on_request_done(m_request_slots[first_done_request + it].request_tag, send_error);
+					}
+				}
+			}
+#endif
+
+			//every slot is free again, so next requests start back from the first one
+			if (m_nr_of_queued_requests == 0)
+			{
+				m_first_queued_request = 0;
+			}
+
+			return ret;
+		}
+
+		//It drains every pending incoming packet, batch_size packets per syscall
+		//It returns 0 once there is nothing else to read, or the errno of the failing syscall
+		int icmp_socket_batch::drain_replies(const int native_socket, const reply_callback& on_reply)
+		{
+			return drain_queue(native_socket, 0, on_reply);
+		}
+
+		//It drains every pending transmit timestamp from the socket error queue
+		//Each one comes along with the packet it belongs to, link and network headers included
+		int icmp_socket_batch::drain_transmit_timestamps(const int native_socket, const reply_callback& on_transmitted_packet)
+		{
+#if defined(__linux__)
+			return drain_queue(native_socket, MSG_ERRQUEUE, on_transmitted_packet);
+#else
+			return 0;
+#endif
+		}
+
+		//It drains the given socket queue into the reply ring
+		int icmp_socket_batch::drain_queue(const int native_socket, const int flags, const reply_callback& on_packet)
+		{
+			int ret = 0;
+
+#if defined(__linux__)
+			bool keep_draining = true;
+			while (keep_draining)
+			{
+				for (size_t it = 0; it < m_batch_size; ++it)
+				{
+					m_reply_headers[it].msg_hdr.msg_name = &m_reply_addresses[it];
+					m_reply_headers[it].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+					m_reply_headers[it].msg_hdr.msg_control = m_control_ring.data() + (it * CONTROL_SLOT_SIZE_IN_BYTES);
+					m_reply_headers[it].msg_hdr.msg_controllen = CONTROL_SLOT_SIZE_IN_BYTES;
+					m_reply_headers[it].msg_hdr.msg_flags = 0;
+					m_reply_headers[it].msg_len = 0;
+				}
+
+				int nr_of_received_messages = recvmmsg(native_socket, m_reply_headers.data(), static_cast<unsigned int>(m_batch_size), flags | MSG_DONTWAIT, nullptr);
+				if (nr_of_received_messages > 0)
+				{
+					for (int it = 0; it < nr_of_received_messages; ++it)
+					{
+						msghdr& message = m_reply_headers[it].msg_hdr;
+
+						//software timestamps come as SCM_TIMESTAMPNS on receive and as SCM_TIMESTAMPING on transmit
+						reply_metadata metadata;
+						for (cmsghdr* control = CMSG_FIRSTHDR(&message); control != nullptr; control = CMSG_NXTHDR(&message, control))
+						{
+							if ((control->cmsg_level == SOL_SOCKET) &&
+								(control->cmsg_type == SCM_TIMESTAMPNS) &&
+								((flags & MSG_ERRQUEUE) == 0))
+							{
+								timespec timestamp;
+								std::memcpy(&timestamp, CMSG_DATA(control), sizeof(timestamp));
+								metadata.kernel_timestamp = std::chrono::seconds(timestamp.tv_sec) + std::chrono::nanoseconds(timestamp.tv_nsec);
+							}
+							else if ((control->cmsg_level == SOL_SOCKET) &&
+								(control->cmsg_type == SCM_TIMESTAMPING) &&
+								((flags & MSG_ERRQUEUE) != 0))
+							{
+								scm_timestamping timestamps;
+								std::memcpy(&timestamps, CMSG_DATA(control), sizeof(timestamps));
+								metadata.kernel_timestamp = std::chrono::seconds(timestamps.ts[0].tv_sec) + std::chrono::nanoseconds(timestamps.ts[0].tv_nsec);
+							}
+							else if ((control->cmsg_level == IPPROTO_IP) &&
+								(control->cmsg_type == IP_TTL))
+							{
+								std::memcpy(&metadata.time_to_live, CMSG_DATA(control), sizeof(metadata.time_to_live));
+							}
+							else if ((control->cmsg_level == IPPROTO_IPV6) &&
+								(control->cmsg_type == IPV6_HOPLIMIT))
+							{
+								std::memcpy(&metadata.time_to_live, CMSG_DATA(control), sizeof(metadata.time_to_live));
+							}
+							else if ((control->cmsg_level == IPPROTO_IPV6) &&
+								(control->cmsg_type == IPV6_PKTINFO))
+							{
+								in6_pktinfo packet_info;
+								std::memcpy(&packet_info, CMSG_DATA(control), sizeof(packet_info));
+
+								boost::asio::ip::address_v6::bytes_type address_bytes;
+								std::memcpy(address_bytes.data(), &packet_info.ipi6_addr, address_bytes.size());
+								metadata.destination_address = boost::asio::ip::address_v6(address_bytes);
+							}
+						}
+
+						if ((message.msg_namelen > 0) &&
+							(message.msg_namelen <= metadata.source_endpoint.capacity()))
+						{
+							std::memcpy(metadata.source_endpoint.data(), message.msg_name, message.msg_namelen);
+							metadata.source_endpoint.resize(message.msg_namelen);
+						}
+
+						//truncated packets are not ours, our replies always fit in a slot
+						if ((message.msg_flags & MSG_TRUNC) == 0)
+						{
+							on_packet(static_cast<unsigned char*>(m_reply_vectors[it].iov_base), m_reply_headers[it].msg_len, metadata);
+						}
+					}
+
+					//a partial batch means the socket queue is already empty
+					keep_draining = (static_cast<size_t>(nr_of_received_messages) == m_batch_size);
+				}
+				else
+				{
+					if ((nr_of_received_messages < 0) &&
+						(errno != EAGAIN) &&
+						(errno != EWOULDBLOCK))
+					{
+						ret = errno;
+					}
+
+					keep_draining = false;
+				}
+			}
+#endif
+
+			return ret;
+		}
+
+		//It drops every queued packet
+		void icmp_socket_batch::clear()
+		{
+			m_first_queued_request = 0;
+			m_nr_of_queued_requests = 0;
+		}
+	}
+}
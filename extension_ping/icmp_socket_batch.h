@@ -0,0 +1,104 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#endif
+
+using boost::asio::ip::icmp;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Batched I/O helper for ICMP sockets
+        //Outgoing packets are queued and flushed with sendmmsg, pending incoming packets are drained
+        //with recvmmsg into a preallocated buffer ring, so there are two syscalls per batch instead of per packet
+        //Kernel software timestamps, TTL (or hop limit), source address and, on IPV6 sockets, destination address
+        //are handed over along with each incoming packet
+        //This is only available on Linux, is_supported() tells if it can be used
+        class icmp_socket_batch
+        {
+        public:
+            //Some magic data
+            static constexpr size_t DEFAULT_BATCH_SIZE = 64;
+            static constexpr size_t DEFAULT_REPLY_SLOT_SIZE_IN_BYTES = 2048;
+            static constexpr size_t CONTROL_SLOT_SIZE_IN_BYTES = 256;
+
+            //incoming packet data object, filled from the recvmmsg address and control data
+            typedef struct reply_metadata_unit
+            {
+                reply_metadata_unit() :
+                    kernel_timestamp(std::chrono::nanoseconds::zero()),
+                    time_to_live(0) {}
+
+                //kernel timestamps are CLOCK_REALTIME nanoseconds, or zero when the kernel did not provide any
+                std::chrono::nanoseconds kernel_timestamp;
+                //only provided on sockets with IP_RECVTTL or IPV6_RECVHOPLIMIT enabled, zero otherwise
+                int time_to_live;
+                icmp::endpoint source_endpoint;
+                //only provided on IPV6 sockets with IPV6_RECVPKTINFO enabled, unspecified otherwise
+                //it is needed to verify ICMPv6 checksums, they cover the IPV6 pseudo header
+                boost::asio::ip::address destination_address;
+            } reply_metadata;
+
+            //callback types
+            typedef std::function<void(const uint64_t request_tag, const int error)> request_done_callback;
+            typedef std::function<void(unsigned char* reply_bytes, const size_t reply_size, const reply_metadata& metadata)> reply_callback;
+
+            icmp_socket_batch() :
+                m_batch_size(0),
+                m_reply_slot_size(0),
+                m_first_queued_request(0),
+                m_nr_of_queued_requests(0) {}
+
+            static bool is_supported();
+            static bool enable_kernel_timestamps(const int native_socket, bool& transmit_timestamps_enabled);
+
+            void configure(const size_t batch_size, const size_t reply_slot_size);
+            unsigned char* queue_request(const icmp::endpoint& destination, const size_t packet_size, const uint64_t request_tag);
+            size_t nr_of_queued_requests() const { return m_nr_of_queued_requests; }
+            int flush_requests(const int native_socket, const request_done_callback& on_request_done);
+            int drain_replies(const int native_socket, const reply_callback& on_reply);
+            int drain_transmit_timestamps(const int native_socket, const reply_callback& on_transmitted_packet);
+            void clear();
+
+        private:
+            //private helper methods
+            int drain_queue(const int native_socket, const int flags, const reply_callback& on_packet);
+
+            //queued ICMP packet waiting to be flushed
+            typedef struct queued_request_unit
+            {
+                uint64_t request_tag;
+                size_t packet_size;
+                std::vector<unsigned char> packet_bytes;
+#if defined(__linux__)
+                sockaddr_storage destination;
+                socklen_t destination_size;
+#endif
+            } queued_request;
+
+            //member vars
+            size_t m_batch_size;
+            size_t m_reply_slot_size;
+            size_t m_first_queued_request;
+            size_t m_nr_of_queued_requests;
+            std::vector<queued_request> m_request_slots;
+            std::vector<unsigned char> m_reply_ring;
+            std::vector<unsigned char> m_control_ring;
+#if defined(__linux__)
+            std::vector<mmsghdr> m_request_headers;
+            std::vector<iovec> m_request_vectors;
+            std::vector<mmsghdr> m_reply_headers;
+            std::vector<iovec> m_reply_vectors;
+            std::vector<sockaddr_storage> m_reply_addresses;
+#endif
+        };
+    }
+}
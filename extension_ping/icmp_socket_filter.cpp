@@ -0,0 +1,127 @@
+#include "icmp_socket_filter.h"
+#include "icmp_packet.h"
+
+#if defined(__linux__)
+#include <netinet/icmp6.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace utils
+{
+	namespace ping
+	{
+		//It tells if socket filters are available on this platform
+		bool icmp_socket_filter::is_supported()
+		{
+#if defined(__linux__)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		//It makes the kernel only queue ICMP Echo Replies on the given raw socket
+		bool icmp_socket_filter::attach_echo_reply_filter(const int native_socket)
+		{
+			return attach_filter(native_socket, false, 0, 0);
+		}
+
+		//It makes the kernel only queue ICMP Echo Replies whose identifier is within the given range
+		//Attaching a new filter atomically replaces the previous one, so this is also how it gets regenerated
+		bool icmp_socket_filter::attach_echo_reply_filter(const int native_socket, const uint16_t first_identifier, const uint16_t last_identifier)
+		{
+			bool ret = false;
+
+			if (first_identifier <= last_identifier)
+			{
+				ret = attach_filter(native_socket, true, first_identifier, last_identifier);
+			}
+
+			return ret;
+		}
+
+		//It makes the kernel only queue ICMPv6 Echo Replies on the given raw ICMPv6 socket
+		//Raw ICMPv6 sockets see no IPV6 header, and the kernel already filters them by type with no program at all
+		bool icmp_socket_filter::attach_icmpv6_echo_reply_filter(const int native_socket)
+		{
+			bool ret = false;
+
+#if defined(__linux__)
+			icmp6_filter filter;
+			ICMP6_FILTER_SETBLOCKALL(&filter);
+			ICMP6_FILTER_SETPASS(icmp_header::ICMPV6_HEADER_CODE_TYPE::ICMPV6_ECHO_REPLY, &filter);
+
+			ret = (setsockopt(native_socket, IPPROTO_ICMPV6, ICMP6_FILTER, &filter, sizeof(filter)) == 0);
+#endif
+
+			return ret;
+		}
+
+		//It removes the filter of the given socket, so it gets every packet again
+		bool icmp_socket_filter::detach_filter(const int native_socket)
+		{
+			bool ret = false;
+
+#if defined(__linux__)
+			int ignored_value = 0;
+			ret = (setsockopt(native_socket, SOL_SOCKET, SO_DETACH_FILTER, &ignored_value, sizeof(ignored_value)) == 0);
+#endif
+
+			return ret;
+		}
+
+#if defined(__linux__)
+		//It builds the filter program, raw IPV4 sockets see each packet from its IPV4 header onwards
+		//  ldxb 4*([0]&0xf)            X = IPV4 header length
+		//  ldb [x + 0]                 A = ICMP type
+		//  jeq #ECHO_REPLY, next, drop
+		//  ldh [x + 4]                 A = ICMP identifier          (identifier range only)
+		//  jge #first, next, drop                                    (identifier range only)
+		//  jgt #last, drop, next                                     (identifier range only)
+		//  ret #ACCEPT_PACKET
+		//  ret #DROP_PACKET
+		std::vector<sock_filter> icmp_socket_filter::get_echo_reply_program(const bool match_identifier, const uint16_t first_identifier, const uint16_t last_identifier)
+		{
+			std::vector<sock_filter> ret;
+
+			//jump offsets are relative to the next instruction, the drop one is always the last one
+			unsigned char type_check_drop_offset = (match_identifier) ? 4 : 1;
+
+			ret.push_back(BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0));
+			ret.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_IND, icmp_header::OFFSET_FIELD_TYPE));
+			ret.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY, 0, type_check_drop_offset));
+
+			if (match_identifier)
+			{
+				ret.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_IND, icmp_header::OFFSET_FIELD_IDENTIFIER_START));
+				ret.push_back(BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, first_identifier, 0, 2));
+				ret.push_back(BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, last_identifier, 1, 0));
+			}
+
+			ret.push_back(BPF_STMT(BPF_RET | BPF_K, ACCEPT_PACKET));
+			ret.push_back(BPF_STMT(BPF_RET | BPF_K, DROP_PACKET));
+
+			return ret;
+		}
+#endif
+
+		//It attaches the filter program to the given socket
+		bool icmp_socket_filter::attach_filter(const int native_socket, const bool match_identifier, const uint16_t first_identifier, const uint16_t last_identifier)
+		{
+			bool ret = false;
+
+#if defined(__linux__)
+			std::vector<sock_filter> program = get_echo_reply_program(match_identifier, first_identifier, last_identifier);
+
+			sock_fprog filter;
+			filter.len = static_cast<unsigned short>(program.size());
+			filter.filter = program.data();
+
+			ret = (setsockopt(native_socket, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter)) == 0);
+#endif
+
+			return ret;
+		}
+	}
+}
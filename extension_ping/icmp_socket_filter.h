@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/filter.h>
+#endif
+
+namespace utils
+{
+    namespace ping
+    {
+        //Classic BPF socket filter for raw ICMP sockets
+        //Raw sockets get a copy of every incoming ICMP packet on the host, the filter makes the kernel drop
+        //everything but ICMP Echo Replies (optionally only the ones within an identifier range) before
+        //they are queued, so the rest never wakes us up nor gets copied to user space
+        //Raw ICMPv6 sockets get the ICMP6_FILTER type filter instead, identifiers are matched on user space
+        //This is only available on Linux, is_supported() tells if it can be used
+        class icmp_socket_filter
+        {
+        public:
+            //Some magic data
+            static constexpr uint32_t ACCEPT_PACKET = 0xFFFFFFFF;
+            static constexpr uint32_t DROP_PACKET = 0;
+
+            static bool is_supported();
+            static bool attach_echo_reply_filter(const int native_socket);
+            static bool attach_echo_reply_filter(const int native_socket, const uint16_t first_identifier, const uint16_t last_identifier);
+            static bool attach_icmpv6_echo_reply_filter(const int native_socket);
+            static bool detach_filter(const int native_socket);
+
+#if defined(__linux__)
+            static std::vector<sock_filter> get_echo_reply_program(const bool match_identifier, const uint16_t first_identifier, const uint16_t last_identifier);
+#endif
+
+        private:
+            //private helper methods
+            static bool attach_filter(const int native_socket, const bool match_identifier, const uint16_t first_identifier, const uint16_t last_identifier);
+        };
+    }
+}
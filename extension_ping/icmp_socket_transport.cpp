@@ -0,0 +1,632 @@
+#include <random>
+#include <cstring>
+#include "icmp_socket_filter.h"
+#include "icmp_socket_transport.h"
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace utils
+{
+	namespace ping
+	{
+		//It opens the ICMP sockets and the resolver on the given async engine
+		//The IPV4 socket is a must, the ICMPv6 one is only opened when the host supports it
+		bool icmp_socket_transport::open(boost::asio::io_context& async_engine)
+		{
+			bool ret = false;
+
+			close();
+
+			m_resolver_ptr.reset(new icmp::resolver(async_engine));
+			for (auto& socket : m_sockets)
+			{
+				socket.socket_ptr.reset(new icmp::socket(async_engine));
+			}
+
+			if ((m_resolver_ptr) &&
+				(m_sockets[IPV4_SOCKET].socket_ptr) &&
+				(m_sockets[IPV6_SOCKET].socket_ptr) &&
+				(open_socket()))
+			{
+				setup_socket(m_sockets[IPV4_SOCKET]);
+
+				//IPV6 target hosts just cannot be probed when there is no ICMPv6 socket
+				if (open_ipv6_socket())
+				{
+					setup_socket(m_sockets[IPV6_SOCKET]);
+				}
+				else
+				{
+					close_socket(m_sockets[IPV6_SOCKET]);
+				}
+
+				ret = true;
+			}
+			else
+			{
+				close();
+			}
+
+			return ret;
+		}
+
+		//It stops the resolver and closes the sockets
+		void icmp_socket_transport::close()
+		{
+			if (m_resolver_ptr)
+			{
+				m_resolver_ptr->cancel();
+			}
+
+			for (auto& socket : m_sockets)
+			{
+				close_socket(socket);
+			}
+
+			m_resolver_ptr.reset();
+			m_on_readable = nullptr;
+		}
+
+		//Check if the sockets are up, the IPV4 one is enough
+		bool icmp_socket_transport::is_open() const
+		{
+			return ((m_resolver_ptr) &&
+				(m_sockets[IPV4_SOCKET].is_open()));
+		}
+
+		//It drops every queued request and sizes the batch slots for the given requests
+		void icmp_socket_transport::reset(const size_t max_request_size)
+		{
+			for (auto& socket : m_sockets)
+			{
+				socket.nr_of_queued_requests = 0;
+				socket.socket_batch.clear();
+				socket.socket_batch.configure(icmp_socket_batch::DEFAULT_BATCH_SIZE, ipv4_header::IPV4_PACKET_SIZE_IN_BYTES + max_request_size);
+			}
+		}
+
+		//It cancels pending waits and resolutions
+		void icmp_socket_transport::cancel()
+		{
+			for (auto& socket : m_sockets)
+			{
+				if (socket.socket_ptr)
+				{
+					boost::system::error_code ignored_error;
+					socket.socket_ptr->cancel(ignored_error);
+				}
+			}
+		}
+
+		//It returns the ICMP identifier picked when the sockets were opened
+		unsigned short icmp_socket_transport::get_packet_identifier() const
+		{
+			return m_packet_identifier;
+		}
+
+		//Raw sockets hand the whole IPV4 packet over, datagram sockets just its ICMP payload
+		bool icmp_socket_transport::has_ipv4_header() const
+		{
+			return (m_socket_type == RAW_SOCKET);
+		}
+
+		//It resolves the given target host through the system resolver
+		//Dual-stack resolutions ask for any family, the system resolver only returns the ones the host is configured for
+		void icmp_socket_transport::async_resolve(const std::string& target_host, const ADDRESS_FAMILY address_family, const resolve_callback& on_resolved)
+		{
+			auto handler = [on_resolved](const boost::system::error_code& error_code, icmp::resolver::results_type results)
+			{
+				on_resolved(error_code, results);
+			};
+
+			if (address_family == IPV4_FAMILY)
+			{
+				m_resolver_ptr->async_resolve(icmp::v4(), target_host, "", handler);
+			}
+			else if (address_family == IPV6_FAMILY)
+			{
+				m_resolver_ptr->async_resolve(icmp::v6(), target_host, "", handler);
+			}
+			else
+			{
+				m_resolver_ptr->async_resolve(target_host, "", handler);
+			}
+		}
+
+		//It queues a request on the socket of its destination family
+		unsigned char* icmp_socket_transport::queue_request(const icmp::endpoint& destination, const size_t packet_size, const uint64_t request_tag)
+		{
+			unsigned char* ret = nullptr;
+
+			family_socket& socket = m_sockets[(destination.address().is_v6()) ? IPV6_SOCKET : IPV4_SOCKET];
+			if (socket.is_open())
+			{
+				ret = queue_socket_request(socket, destination, packet_size, request_tag);
+			}
+
+			return ret;
+		}
+
+		//It returns the number of requests waiting to be flushed
+		size_t icmp_socket_transport::nr_of_queued_requests() const
+		{
+			size_t ret = 0;
+
+			for (const auto& socket : m_sockets)
+			{
+				ret += (m_batched_io) ? socket.socket_batch.nr_of_queued_requests() : socket.nr_of_queued_requests;
+			}
+
+			return ret;
+		}
+
+		//It sends every queued request of both sockets, a full socket does not hold the other one back
+		int icmp_socket_transport::flush_requests(const request_done_callback& on_request_done)
+		{
+			int ret = 0;
+
+			for (auto& socket : m_sockets)
+			{
+				int flush_error = flush_socket_requests(socket, on_request_done);
+				if (ret == 0)
+				{
+					ret = flush_error;
+				}
+			}
+
+			return ret;
+		}
+
+		//It calls back once a socket that still has queued requests can take more of them
+		void icmp_socket_transport::async_wait_writable(const wait_callback& on_writable)
+		{
+			family_socket* socket = &m_sockets[IPV4_SOCKET];
+			if ((m_sockets[IPV6_SOCKET].is_open()) &&
+				(((m_batched_io) ? m_sockets[IPV6_SOCKET].socket_batch.nr_of_queued_requests() : m_sockets[IPV6_SOCKET].nr_of_queued_requests) > 0))
+			{
+				socket = &m_sockets[IPV6_SOCKET];
+			}
+
+			socket->socket_ptr->async_wait(icmp::socket::wait_write, on_writable);
+		}
+
+		//It calls back once there are replies to drain on any socket
+		//Each socket keeps its own wait, the first one to complete hands it over and the rest stay armed
+		void icmp_socket_transport::async_wait_readable(const wait_callback& on_readable)
+		{
+			m_on_readable = on_readable;
+
+			for (size_t socket_index = 0; socket_index < NR_OF_SOCKETS; ++socket_index)
+			{
+				wait_socket_readable(socket_index);
+			}
+		}
+
+		//It reads everything already queued on both sockets
+		int icmp_socket_transport::drain_replies(const reply_callback& on_reply, const reply_callback& on_transmitted_request)
+		{
+			int ret = 0;
+
+			for (auto& socket : m_sockets)
+			{
+				int drain_error = drain_socket_replies(socket, on_reply, on_transmitted_request);
+				if (ret == 0)
+				{
+					ret = drain_error;
+				}
+			}
+
+			return ret;
+		}
+
+		//It enables or disables batched I/O mode, it can only be enabled where it is supported
+		//It returns true when the setting changed, so the socket has to be opened again
+		bool icmp_socket_transport::set_batched_io(const bool enabled)
+		{
+			bool ret = false;
+
+			bool batched_io = ((enabled) && (icmp_socket_batch::is_supported()));
+			if (batched_io != m_batched_io)
+			{
+				m_batched_io = batched_io;
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It picks the kind of ICMP socket to use
+		//It returns true when the setting changed, so the socket has to be opened again
+		bool icmp_socket_transport::set_socket_type(const SOCKET_TYPE socket_type)
+		{
+			bool ret = false;
+
+			if (socket_type != m_requested_socket_type)
+			{
+				m_requested_socket_type = socket_type;
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It narrows the ICMP identifiers raw sockets can pick from, datagram sockets get theirs from the kernel
+		//It returns true when the setting changed, so the socket has to be opened again
+		bool icmp_socket_transport::set_identifier_range(const unsigned short first_identifier, const unsigned short last_identifier)
+		{
+			bool ret = false;
+
+			//identifier zero is never picked
+			if ((first_identifier > 0) &&
+				(first_identifier <= last_identifier) &&
+				((first_identifier != m_first_identifier) ||
+				(last_identifier != m_last_identifier)))
+			{
+				m_first_identifier = first_identifier;
+				m_last_identifier = last_identifier;
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It returns the kind of ICMP socket in use
+		icmp_socket_transport::SOCKET_TYPE icmp_socket_transport::get_socket_type() const
+		{
+			return m_socket_type;
+		}
+
+		//Check if the ICMPv6 socket is up
+		bool icmp_socket_transport::has_ipv6_support() const
+		{
+			return m_sockets[IPV6_SOCKET].is_open();
+		}
+
+		//It opens the IPV4 ICMP socket of the requested kind and picks the ICMP identifier to use on it
+		//Raw sockets get a kernel filter, so only replies to that identifier reach us
+		//Datagram sockets need no filter, the kernel already demultiplexes them by identifier
+		bool icmp_socket_transport::open_socket()
+		{
+			bool ret = false;
+
+			m_socket_type = RAW_SOCKET;
+
+			unsigned short packet_identifier = 0;
+			if ((m_requested_socket_type != RAW_SOCKET) &&
+				(open_datagram_socket(m_sockets[IPV4_SOCKET], packet_identifier)))
+			{
+				m_socket_type = DATAGRAM_SOCKET;
+				m_packet_identifier = packet_identifier;
+				ret = true;
+			}
+			else if (m_requested_socket_type != DATAGRAM_SOCKET)
+			{
+				//raw sockets need root or CAP_NET_RAW
+				boost::system::error_code error_code;
+				m_sockets[IPV4_SOCKET].socket_ptr->open(icmp::v4(), error_code);
+				if (!error_code)
+				{
+					m_packet_identifier = get_random_packet_identifier(m_first_identifier, m_last_identifier);
+
+					//there is still user space filtering if the filter cannot be attached
+					icmp_socket_filter::attach_echo_reply_filter(m_sockets[IPV4_SOCKET].socket_ptr->native_handle(), m_packet_identifier, m_packet_identifier);
+					ret = true;
+				}
+			}
+
+			return ret;
+		}
+
+		//It opens the ICMPv6 socket, of the same kind as the IPV4 one and on the same ICMP identifier,
+		//so replies of both families are matched the same way
+		//Hop limits and destination addresses come as control data, the latter is needed to verify reply checksums
+		bool icmp_socket_transport::open_ipv6_socket()
+		{
+			bool ret = false;
+
+			family_socket& socket = m_sockets[IPV6_SOCKET];
+
+			if (m_socket_type == DATAGRAM_SOCKET)
+			{
+				//the identifier is asked for, so this fails if another ping socket already took it
+				unsigned short packet_identifier = m_packet_identifier;
+				ret = open_datagram_socket(socket, packet_identifier);
+			}
+			else
+			{
+				boost::system::error_code error_code;
+				socket.socket_ptr->open(icmp::v6(), error_code);
+				if (!error_code)
+				{
+					//there is still user space filtering if the filter cannot be attached
+					icmp_socket_filter::attach_icmpv6_echo_reply_filter(socket.socket_ptr->native_handle());
+					ret = true;
+				}
+			}
+
+#if defined(__linux__)
+			int enabled = 1;
+			if (ret)
+			{
+				setsockopt(socket.socket_ptr->native_handle(), IPPROTO_IPV6, IPV6_RECVHOPLIMIT, &enabled, sizeof(enabled));
+				setsockopt(socket.socket_ptr->native_handle(), IPPROTO_IPV6, IPV6_RECVPKTINFO, &enabled, sizeof(enabled));
+			}
+#endif
+
+			return ret;
+		}
+
+		//It opens a Linux ping socket, it needs the process group to be on net.ipv4.ping_group_range
+		//The kernel owns the ICMP identifier of these sockets: it overwrites it on every sent request
+		//and it only hands over the replies carrying it, so no user space filtering is needed
+		//Replies come with no IPV4 header, their TTL is delivered as IP_TTL control data instead
+		//The IPV4 socket lets the kernel pick a free identifier, the ICMPv6 one asks for the given identifier
+		bool icmp_socket_transport::open_datagram_socket(family_socket& socket, unsigned short& packet_identifier)
+		{
+			bool ret = false;
+
+#if defined(__linux__)
+			bool is_ipv6 = (&socket == &m_sockets[IPV6_SOCKET]);
+			int native_socket = (is_ipv6) ?
+				::socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_ICMPV6) :
+				::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_ICMP);
+			if (native_socket >= 0)
+			{
+				//binding to port 0 makes the kernel pick a free identifier right away
+				sockaddr_storage local_address;
+				socklen_t local_address_size = (is_ipv6) ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+				std::memset(&local_address, 0, sizeof(local_address));
+				if (is_ipv6)
+				{
+					reinterpret_cast<sockaddr_in6*>(&local_address)->sin6_family = AF_INET6;
+					reinterpret_cast<sockaddr_in6*>(&local_address)->sin6_port = htons(packet_identifier);
+				}
+				else
+				{
+					reinterpret_cast<sockaddr_in*>(&local_address)->sin_family = AF_INET;
+				}
+
+				int enabled = 1;
+				if ((bind(native_socket, reinterpret_cast<sockaddr*>(&local_address), local_address_size) == 0) &&
+					(getsockname(native_socket, reinterpret_cast<sockaddr*>(&local_address), &local_address_size) == 0) &&
+					((is_ipv6) || (setsockopt(native_socket, IPPROTO_IP, IP_RECVTTL, &enabled, sizeof(enabled)) == 0)))
+				{
+					boost::system::error_code error_code;
+					socket.socket_ptr->assign((is_ipv6) ? icmp::v6() : icmp::v4(), native_socket, error_code);
+					if (!error_code)
+					{
+						packet_identifier = (is_ipv6) ?
+							ntohs(reinterpret_cast<sockaddr_in6*>(&local_address)->sin6_port) :
+							ntohs(reinterpret_cast<sockaddr_in*>(&local_address)->sin_port);
+						ret = true;
+					}
+				}
+
+				if (!ret)
+				{
+					::close(native_socket);
+				}
+			}
+#endif
+
+			return ret;
+		}
+
+		//It sizes the socket buffers and turns kernel timestamps on
+		void icmp_socket_transport::setup_socket(family_socket& socket)
+		{
+			//large fan-outs get lots of replies at once, so giving them room on the kernel side
+			//the kernel caps this to its own maximum, so a failure here is not a problem
+			boost::system::error_code ignored_error;
+			socket.socket_ptr->set_option(boost::asio::socket_base::receive_buffer_size(SOCKET_BUFFER_SIZE_IN_BYTES), ignored_error);
+			socket.socket_ptr->set_option(boost::asio::socket_base::send_buffer_size(SOCKET_BUFFER_SIZE_IN_BYTES), ignored_error);
+
+			//kernel timestamps are only read back through batched I/O mode
+			socket.kernel_timestamps = false;
+			socket.kernel_transmit_timestamps = false;
+			if (m_batched_io)
+			{
+				socket.kernel_timestamps = icmp_socket_batch::enable_kernel_timestamps(socket.socket_ptr->native_handle(), socket.kernel_transmit_timestamps);
+			}
+		}
+
+		//It closes the given socket and drops its queued requests
+		void icmp_socket_transport::close_socket(family_socket& socket)
+		{
+			if (socket.socket_ptr)
+			{
+				boost::system::error_code ignored_error;
+				socket.socket_ptr->close(ignored_error);
+			}
+
+			socket.socket_ptr.reset();
+			socket.socket_batch.clear();
+			socket.nr_of_queued_requests = 0;
+			socket.waiting_for_readable = false;
+		}
+
+		//It queues a request on the given socket, on batched I/O mode it goes straight into the sendmmsg batch
+		unsigned char* icmp_socket_transport::queue_socket_request(family_socket& socket, const icmp::endpoint& destination, const size_t packet_size, const uint64_t request_tag)
+		{
+			unsigned char* ret = nullptr;
+
+			if (m_batched_io)
+			{
+				ret = socket.socket_batch.queue_request(destination, packet_size, request_tag);
+			}
+			else
+			{
+				//queued request buffers only grow, so this is a no-op once the first requests went out
+				if (socket.nr_of_queued_requests == socket.queued_requests.size())
+				{
+					socket.queued_requests.emplace_back();
+				}
+
+				queued_request& request = socket.queued_requests[socket.nr_of_queued_requests];
+				if (request.packet_bytes.size() < packet_size)
+				{
+					request.packet_bytes.resize(packet_size);
+				}
+
+				request.destination = destination;
+				request.request_tag = request_tag;
+				request.packet_size = packet_size;
+				++socket.nr_of_queued_requests;
+				ret = request.packet_bytes.data();
+			}
+
+			return ret;
+		}
+
+		//It sends every request queued on the given socket, through as few syscalls as possible on batched I/O mode
+		int icmp_socket_transport::flush_socket_requests(family_socket& socket, const request_done_callback& on_request_done)
+		{
+			int ret = 0;
+
+			if (!socket.is_open())
+			{
+				return ret;
+			}
+
+			if (m_batched_io)
+			{
+				ret = socket.socket_batch.flush_requests(socket.socket_ptr->native_handle(), on_request_done);
+			}
+			else
+			{
+				//the callback might queue new ones, like the next echo after a failed send, and they go out
+				//on this same flush, nothing else would send them when no reply nor timeout is left to wait for
+				while ((socket.is_open()) &&
+					(socket.nr_of_queued_requests > 0))
+				{
+					//requests are taken out of the queue first, the ones queued meanwhile go on the next pass
+					size_t nr_of_requests = socket.nr_of_queued_requests;
+					socket.queued_requests.swap(socket.sending_requests);
+					socket.nr_of_queued_requests = 0;
+
+					for (size_t it = 0; it < nr_of_requests; ++it)
+					{
+						const queued_request& request = socket.sending_requests[it];
+						boost::system::error_code error_code;
+						std::size_t bytes_sent = socket.socket_ptr->send_to(boost::asio::buffer(request.packet_bytes.data(), request.packet_size), request.destination, 0, error_code);
+
+						//Let's check if the expected bytes where transmitted
+						int error = error_code.value();
+						if ((!error_code) &&
+							(bytes_sent != request.packet_size))
+						{
+							error = boost::asio::error::message_size;
+						}
+
+						on_request_done(request.request_tag, error);
+					}
+				}
+			}
+
+			return ret;
+		}
+
+		//It reads everything already queued on the given socket
+		int icmp_socket_transport::drain_socket_replies(family_socket& socket, const reply_callback& on_reply, const reply_callback& on_transmitted_request)
+		{
+			int ret = 0;
+
+			if (!socket.is_open())
+			{
+				return ret;
+			}
+
+			if (m_batched_io)
+			{
+				//transmit timestamps go first, so they are already there when their replies get matched
+				if (socket.kernel_transmit_timestamps)
+				{
+					socket.socket_batch.drain_transmit_timestamps(socket.socket_ptr->native_handle(), on_transmitted_request);
+				}
+
+				ret = socket.socket_batch.drain_replies(socket.socket_ptr->native_handle(), on_reply);
+			}
+			else
+			{
+				//replies land on a preallocated buffer, so no allocations are involved on the receive path
+				boost::system::error_code error_code;
+				while ((!error_code) &&
+					(socket.socket_ptr->available(error_code) > 0))
+				{
+					std::size_t receive_length = socket.socket_ptr->receive_from(boost::asio::buffer(m_reply_bytes), m_reply_endpoint, 0, error_code);
+					if ((!error_code) &&
+						(receive_length > 0))
+					{
+						icmp_socket_batch::reply_metadata metadata;
+						metadata.source_endpoint = m_reply_endpoint;
+						on_reply(m_reply_bytes.data(), receive_length, metadata);
+					}
+				}
+
+				ret = error_code.value();
+			}
+
+			return ret;
+		}
+
+		//It arms the readable wait of the given socket, unless it is closed or already waiting
+		//Waits of sockets that were closed since then are not ours anymore, so they are just dropped
+		void icmp_socket_transport::wait_socket_readable(const size_t socket_index)
+		{
+			family_socket& socket = m_sockets[socket_index];
+
+			if ((socket.is_open()) &&
+				(!socket.waiting_for_readable))
+			{
+				socket.waiting_for_readable = true;
+				boost::shared_ptr<icmp::socket> socket_ptr = socket.socket_ptr;
+
+				socket_ptr->async_wait(
+
+					icmp::socket::wait_read,
+
+					//inline callback
+					[this, socket_index, socket_ptr](const boost::system::error_code& error_code)
+					{
+						if (m_sockets[socket_index].socket_ptr == socket_ptr)
+						{
+							m_sockets[socket_index].waiting_for_readable = false;
+							notify_readable(error_code);
+						}
+					});
+			}
+		}
+
+		//It completes the pending readable wait, if any, with the outcome of the first socket wait that completed
+		void icmp_socket_transport::notify_readable(const boost::system::error_code& error_code)
+		{
+			if (m_on_readable)
+			{
+				wait_callback on_readable = std::move(m_on_readable);
+				m_on_readable = nullptr;
+				on_readable(error_code);
+			}
+		}
+
+		unsigned short icmp_socket_transport::get_random_packet_identifier(const unsigned short first_identifier, const unsigned short last_identifier)
+		{
+			unsigned short ret = 0;
+
+			// produces randomness out of thin air
+			std::random_device rd;
+			std::mt19937 rng(rd());
+
+			// configured identifier range
+			std::uniform_int_distribution<> ushort_dist_range(first_identifier, last_identifier);
+
+			// get random value from range
+			ret = ushort_dist_range(rng);
+
+			return ret;
+		}
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/shared_ptr.hpp>
+#include <array>
+#include <vector>
+#include "icmp_socket_batch.h"
+#include "icmp_transport.h"
+#include "ipv4_packet.h"
+
+using boost::asio::ip::icmp;
+
+namespace utils
+{
+    namespace ping
+    {
+        //ICMP socket transport, the one executors use unless they are given another one
+        //It runs on either a Linux unprivileged ping socket or a raw ICMP socket, and on batched I/O mode
+        //requests and replies go through sendmmsg/recvmmsg with kernel timestamps
+        //Raw sockets get a kernel filter so only replies to our own identifier wake us up, their identifier is
+        //picked within a configurable range so transports sharing the host never pick the same one
+        //An ICMPv6 socket of the same kind is opened along with the IPV4 one when the host supports it, both of
+        //them share the same ICMP identifier and each request goes out through the one of its destination family
+        class icmp_socket_transport : public icmp_transport
+        {
+        public:
+            //ICMP socket kinds, datagram ones are the Linux unprivileged ping sockets (SOCK_DGRAM/IPPROTO_ICMP)
+            //The automatic mode goes for a datagram socket and falls back to a raw one if it cannot be opened
+            enum SOCKET_TYPE
+            {
+                AUTOMATIC_SOCKET = 0,
+                DATAGRAM_SOCKET,
+                RAW_SOCKET
+            };
+
+            //Some magic data
+            static constexpr int SOCKET_BUFFER_SIZE_IN_BYTES = 4 * 1024 * 1024;
+
+            icmp_socket_transport() :
+                m_resolver_ptr(nullptr),
+                m_packet_identifier(0),
+                m_first_identifier(1),
+                m_last_identifier(ipv4_header::MAX_IDENTIFIER_POSSIBLE),
+                m_batched_io(icmp_socket_batch::is_supported()),
+                m_requested_socket_type(AUTOMATIC_SOCKET),
+                m_socket_type(RAW_SOCKET) {}
+
+            ~icmp_socket_transport() { close(); }
+
+            bool open(boost::asio::io_context& async_engine) override;
+            void close() override;
+            bool is_open() const override;
+            void reset(const size_t max_request_size) override;
+            void cancel() override;
+            unsigned short get_packet_identifier() const override;
+            bool has_ipv4_header() const override;
+            void async_resolve(const std::string& target_host, const ADDRESS_FAMILY address_family, const resolve_callback& on_resolved) override;
+            unsigned char* queue_request(const icmp::endpoint& destination, const size_t packet_size, const uint64_t request_tag) override;
+            size_t nr_of_queued_requests() const override;
+            int flush_requests(const request_done_callback& on_request_done) override;
+            void async_wait_writable(const wait_callback& on_writable) override;
+            void async_wait_readable(const wait_callback& on_readable) override;
+            int drain_replies(const reply_callback& on_reply, const reply_callback& on_transmitted_request) override;
+
+            //socket settings, they are applied on next open()
+            bool set_batched_io(const bool enabled);
+            bool set_socket_type(const SOCKET_TYPE socket_type);
+            bool set_identifier_range(const unsigned short first_identifier, const unsigned short last_identifier);
+            SOCKET_TYPE get_socket_type() const;
+            bool has_ipv6_support() const;
+
+        private:
+            //Some magic data
+            static constexpr size_t IPV4_SOCKET = 0;
+            static constexpr size_t IPV6_SOCKET = 1;
+            static constexpr size_t NR_OF_SOCKETS = 2;
+
+            //request queued on non batched I/O mode, it goes out through a plain send_to
+            typedef struct queued_request_unit
+            {
+                icmp::endpoint destination;
+                uint64_t request_tag;
+                size_t packet_size;
+                std::vector<unsigned char> packet_bytes;
+            } queued_request;
+
+            //per address family socket state
+            typedef struct family_socket_unit
+            {
+                family_socket_unit() :
+                    socket_ptr(nullptr),
+                    kernel_timestamps(false),
+                    kernel_transmit_timestamps(false),
+                    nr_of_queued_requests(0),
+                    waiting_for_readable(false) {}
+
+                bool is_open() const { return ((socket_ptr) && (socket_ptr->is_open())); }
+
+                boost::shared_ptr<icmp::socket> socket_ptr;
+                bool kernel_timestamps;
+                bool kernel_transmit_timestamps;
+                icmp_socket_batch socket_batch;
+                size_t nr_of_queued_requests;
+                std::vector<queued_request> queued_requests;
+                std::vector<queued_request> sending_requests;
+                bool waiting_for_readable;
+            } family_socket;
+
+            //private helper methods
+            bool open_socket();
+            bool open_ipv6_socket();
+            bool open_datagram_socket(family_socket& socket, unsigned short& packet_identifier);
+            void setup_socket(family_socket& socket);
+            void close_socket(family_socket& socket);
+            unsigned char* queue_socket_request(family_socket& socket, const icmp::endpoint& destination, const size_t packet_size, const uint64_t request_tag);
+            int flush_socket_requests(family_socket& socket, const request_done_callback& on_request_done);
+            int drain_socket_replies(family_socket& socket, const reply_callback& on_reply, const reply_callback& on_transmitted_request);
+            void wait_socket_readable(const size_t socket_index);
+            void notify_readable(const boost::system::error_code& error_code);
+            static unsigned short get_random_packet_identifier(const unsigned short first_identifier, const unsigned short last_identifier);
+
+            //member vars
+            std::array<family_socket, NR_OF_SOCKETS> m_sockets;
+            boost::shared_ptr<icmp::resolver> m_resolver_ptr;
+            unsigned short m_packet_identifier;
+            unsigned short m_first_identifier;
+            unsigned short m_last_identifier;
+            bool m_batched_io;
+            SOCKET_TYPE m_requested_socket_type;
+            SOCKET_TYPE m_socket_type;
+            wait_callback m_on_readable;
+            std::array<unsigned char, ipv4_header::MAX_PACKET_SIZE> m_reply_bytes;
+            icmp::endpoint m_reply_endpoint;
+        };
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "icmp_socket_batch.h"
+
+using boost::asio::ip::icmp;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Network access of the ping executor
+        //Transports resolve target hosts, send ICMP echo requests and hand incoming ICMP packets over, all of it
+        //running on the async engine of the executor, so the executor logic does not depend on where packets go
+        //Requests are queued and then flushed all at once, and replies are drained once the transport is readable
+        //Requests go out as ICMP or ICMPv6 echoes depending on the family of their destination, and replies of both
+        //families come back through the same drain, told apart by the family of their source endpoint
+        class icmp_transport
+        {
+        public:
+            //address families a target host can be resolved into, dual-stack ones get both
+            enum ADDRESS_FAMILY
+            {
+                IPV4_FAMILY = 4,
+                IPV6_FAMILY = 6,
+                DUAL_STACK_FAMILY = 46
+            };
+
+            //callback types
+            typedef std::function<void(const boost::system::error_code& error_code)> wait_callback;
+            typedef std::function<void(const boost::system::error_code& error_code, const icmp::resolver::results_type& results)> resolve_callback;
+            typedef icmp_socket_batch::request_done_callback request_done_callback;
+            typedef icmp_socket_batch::reply_callback reply_callback;
+
+            virtual ~icmp_transport() {}
+
+            //It opens the transport on the given async engine, anything opened before is closed first
+            virtual bool open(boost::asio::io_context& async_engine) = 0;
+            //It closes the transport, pending async operations complete with operation_aborted
+            virtual void close() = 0;
+            virtual bool is_open() const = 0;
+            //It drops every queued request and gets ready for requests up to the given size
+            virtual void reset(const size_t max_request_size) = 0;
+            //It cancels pending waits and resolutions, they complete with operation_aborted
+            virtual void cancel() = 0;
+
+            //ICMP identifier the ICMP echo requests have to carry
+            virtual unsigned short get_packet_identifier() const = 0;
+            //IPV4 replies come either with their IPV4 header, or as plain ICMP packets with their TTL on the metadata
+            //IPV6 replies never carry their IPV6 header, their hop limit and destination address are on the metadata
+            virtual bool has_ipv4_header() const = 0;
+
+            //It resolves the given target host into addresses of the given family, dual-stack resolves into both
+            virtual void async_resolve(const std::string& target_host, const ADDRESS_FAMILY address_family, const resolve_callback& on_resolved) = 0;
+
+            //It returns the bytes to build the queued request on, or nullptr if it cannot be queued
+            //IPV6 requests cannot be queued when the transport has no IPV6 support
+            virtual unsigned char* queue_request(const icmp::endpoint& destination, const size_t packet_size, const uint64_t request_tag) = 0;
+            virtual size_t nr_of_queued_requests() const = 0;
+            //It sends the queued requests, requests queued by the callback included, until none is left
+            //A non-zero error means the rest has to wait for the transport to be writable
+            virtual int flush_requests(const request_done_callback& on_request_done) = 0;
+            virtual void async_wait_writable(const wait_callback& on_writable) = 0;
+
+            virtual void async_wait_readable(const wait_callback& on_readable) = 0;
+            //It hands every reply already received over, transmit timestamps of sent requests go first
+            virtual int drain_replies(const reply_callback& on_reply, const reply_callback& on_transmitted_request) = 0;
+        };
+    }
+}
@@ -0,0 +1,160 @@
+#include <cstring>
+#include "internet_checksum.h"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define INTERNET_CHECKSUM_X86_SIMD
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define INTERNET_CHECKSUM_NEON_SIMD
+#endif
+
+namespace
+{
+    //Each 32 bits lane gets added into a 64 bits accumulator, so carries never get lost
+    //and there is no need to fold them back until the very end
+    inline uint64_t add_native_words(const unsigned char* data, const size_t nr_of_words, uint64_t sum)
+    {
+        for (size_t it = 0; it < nr_of_words; ++it)
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, data + (it * sizeof(word)), sizeof(word));
+            sum += (word & 0xFFFFFFFF) + (word >> 32);
+        }
+
+        return sum;
+    }
+
+#if defined(INTERNET_CHECKSUM_X86_SIMD)
+    //It zero-extends the 32 bits lanes of the given block into 64 bits lanes and adds them to the accumulator
+    inline __m128i add_sse_block(const __m128i block, __m128i accumulator)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        accumulator = _mm_add_epi64(accumulator, _mm_unpacklo_epi32(block, zero));
+        return _mm_add_epi64(accumulator, _mm_unpackhi_epi32(block, zero));
+    }
+#endif
+}
+
+uint64_t internet_checksum_add(const unsigned char* data, const size_t size, uint64_t sum)
+{
+    size_t offset = 0;
+
+#if defined(__AVX2__)
+    //32 bytes per iteration
+    if (size >= 32)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i accumulator = _mm256_setzero_si256();
+
+        for (; offset + 32 <= size; offset += 32)
+        {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+            accumulator = _mm256_add_epi64(accumulator, _mm256_unpacklo_epi32(block, zero));
+            accumulator = _mm256_add_epi64(accumulator, _mm256_unpackhi_epi32(block, zero));
+        }
+
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), accumulator);
+        sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+
+#if defined(INTERNET_CHECKSUM_X86_SIMD)
+    //16 bytes per iteration, two independent accumulators to hide the add latency
+    if (size - offset >= 16)
+    {
+        __m128i accumulator_1 = _mm_setzero_si128();
+        __m128i accumulator_2 = _mm_setzero_si128();
+
+        for (; offset + 32 <= size; offset += 32)
+        {
+            accumulator_1 = add_sse_block(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset)), accumulator_1);
+            accumulator_2 = add_sse_block(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + 16)), accumulator_2);
+        }
+
+        for (; offset + 16 <= size; offset += 16)
+        {
+            accumulator_1 = add_sse_block(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset)), accumulator_1);
+        }
+
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(accumulator_1, accumulator_2));
+        sum += lanes[0] + lanes[1];
+    }
+#elif defined(INTERNET_CHECKSUM_NEON_SIMD)
+    //16 bytes per iteration, 32 bits lanes get pairwise added into 64 bits lanes
+    if (size >= 16)
+    {
+        uint64x2_t accumulator = vdupq_n_u64(0);
+
+        for (; offset + 16 <= size; offset += 16)
+        {
+            accumulator = vpadalq_u32(accumulator, vreinterpretq_u32_u8(vld1q_u8(data + offset)));
+        }
+
+        sum += vgetq_lane_u64(accumulator, 0) + vgetq_lane_u64(accumulator, 1);
+    }
+#endif
+
+    //portable path, 8 bytes at a time
+    size_t nr_of_words = (size - offset) / sizeof(uint64_t);
+    sum = add_native_words(data + offset, nr_of_words, sum);
+    offset += nr_of_words * sizeof(uint64_t);
+
+    //remaining 16 bits words
+    for (; offset + 2 <= size; offset += 2)
+    {
+        uint16_t word = 0;
+        std::memcpy(&word, data + offset, sizeof(word));
+        sum += word;
+    }
+
+    //odd trailing byte is padded with zero as if it was the high order byte of a network order word
+    if (offset < size)
+    {
+        uint16_t word = 0;
+        std::memcpy(&word, data + offset, 1);
+        sum += word;
+    }
+
+    return sum;
+}
+
+uint64_t internet_checksum_add_ipv6_pseudo_header(const unsigned char* source_address,
+                                                  const unsigned char* destination_address,
+                                                  const uint32_t upper_layer_size,
+                                                  const unsigned char next_header,
+                                                  uint64_t sum)
+{
+    //source address, destination address, upper layer size and next header, with zero padding in between
+    unsigned char pseudo_header[40] = { 0 };
+
+    std::memcpy(pseudo_header, source_address, 16);
+    std::memcpy(pseudo_header + 16, destination_address, 16);
+    pseudo_header[32] = static_cast<unsigned char>(upper_layer_size >> 24);
+    pseudo_header[33] = static_cast<unsigned char>(upper_layer_size >> 16);
+    pseudo_header[34] = static_cast<unsigned char>(upper_layer_size >> 8);
+    pseudo_header[35] = static_cast<unsigned char>(upper_layer_size & 0xFF);
+    pseudo_header[39] = next_header;
+
+    return internet_checksum_add(pseudo_header, sizeof(pseudo_header), sum);
+}
+
+uint16_t internet_checksum_finish(uint64_t sum)
+{
+    //folding the carries back until everything fits in 16 bits
+    while ((sum >> 16) != 0)
+    {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    uint16_t folded_sum = static_cast<uint16_t>(sum);
+
+    //the sum was computed over native words, so it still has to be taken to network byte order
+#if !defined(__BYTE_ORDER__) || (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    folded_sum = static_cast<uint16_t>((folded_sum >> 8) | (folded_sum << 8));
+#endif
+
+    return static_cast<uint16_t>(~folded_sum);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//Internet Checksum implementation as detailed in https://datatracker.ietf.org/doc/html/rfc1071
+//Bytes are summed on wide native words (SIMD lanes when available) and the result is only swapped
+//into network byte order once, which RFC 1071 section 2 (B) allows thanks to byte order independence
+
+//It adds the given bytes to a running native byte order sum
+//Chaining several calls is only valid when every chunk but the last one has an even size
+uint64_t internet_checksum_add(const unsigned char* data, const size_t size, uint64_t sum);
+
+//It adds the IPV6 pseudo header of RFC 8200 section 8.1 to a running native byte order sum
+//Addresses are the 16 bytes of each one in network order, the upper layer size is the one of the ICMPv6 packet
+uint64_t internet_checksum_add_ipv6_pseudo_header(const unsigned char* source_address,
+                                                  const unsigned char* destination_address,
+                                                  const uint32_t upper_layer_size,
+                                                  const unsigned char next_header,
+                                                  uint64_t sum);
+
+//It folds a running sum into its final one's complement 16 bits value, in host order
+uint16_t internet_checksum_finish(uint64_t sum);
+
+//It computes the checksum of the given bytes, in host order
+//Computing it over bytes that already contain a valid checksum field returns 0
+inline uint16_t internet_checksum(const unsigned char* data, const size_t size)
+{
+    return internet_checksum_finish(internet_checksum_add(data, size, 0));
+}
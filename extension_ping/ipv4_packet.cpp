@@ -1,18 +1,33 @@
 #include "ipv4_packet.h"
+#include "internet_checksum.h"
 
-//Clean internal packet buffer
-void ipv4_header::clear()
+//check that the viewed bytes hold a complete IPV4 header
+bool ipv4_header::is_ready() const
 {
-	std::fill(packet_buffer, packet_buffer + sizeof(packet_buffer), 0);
+    bool ret = false;
+
+    //version, header length and options length have to make sense for the bytes we got
+    if ((packet_buffer) &&
+        (packet_size >= IPV4_HEADER_SIZE_IN_BYTES) &&
+        (version() == IPV4_VERSION) &&
+        (header_length() >= IPV4_HEADER_SIZE_IN_BYTES) &&
+        (header_length() <= IPV4_PACKET_SIZE_IN_BYTES) &&
+        (header_length() <= packet_size))
+    {
+        ret = true;
+    }
+
+    return ret;
 }
 
-//check that packet is ready for usage
-bool ipv4_header::is_ready() const
+//It verifies the header checksum, options included
+bool ipv4_header::is_checksum_valid() const
 {
     bool ret = false;
 
-    //just doing a naive check to look for specific IPV4 header
-    if (version() == IPV4_VERSION)
+    //summing a header along with its own checksum has to give all ones
+    if ((is_ready()) &&
+        (internet_checksum(packet_buffer, header_length()) == 0))
     {
         ret = true;
     }
@@ -48,10 +63,4 @@ boost::asio::ip::address_v4 ipv4_header::destination_address() const
         } 
     };
     return boost::asio::ip::address_v4(bytes);
-}
-
-//short-from-network helpers
-unsigned short ipv4_header::get_short_from_offsets(const unsigned short offset_1, const unsigned short offset_2) const
-{
-    return (packet_buffer[offset_1] << 8) + packet_buffer[offset_2];
 }
\ No newline at end of file
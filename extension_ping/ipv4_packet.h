@@ -1,10 +1,11 @@
 #pragma once
 
 #include <algorithm>
-#include <sstream>
+#include <cstddef>
 #include <boost/asio/ip/address_v4.hpp>
 
-
+//Non-owning IPV4 header view
+//It parses the header fields straight from the caller-provided bytes, no copies are involved
 class ipv4_header
 {
 public:
@@ -39,7 +40,8 @@ public:
     static const unsigned short IPV4_VERSION = 4;
 
     //Lifecycle management
-    ipv4_header() { clear(); }
+    ipv4_header() : packet_buffer(nullptr), packet_size(0) {}
+    ipv4_header(const unsigned char* packet_bytes, const size_t packet_bytes_size) : packet_buffer(packet_bytes), packet_size(packet_bytes_size) {}
 
     //Getters
     unsigned char version() const { return (packet_buffer[OFFSET_FIELD_VERSION_AND_HEADER] >> 4) & 0xF; }
@@ -52,39 +54,24 @@ public:
     unsigned short fragment_offset() const { return get_short_from_offsets(OFFSET_FIELD_FRAGMENT_START, OFFSET_FIELD_FRAGMENT_END) & 0x1FFF; }
     unsigned int time_to_live() const { return packet_buffer[OFFSET_FIELD_TIME_TO_LIVE]; }
     unsigned char protocol() const { return packet_buffer[OFFSET_FIELD_PROTOCOL]; }
-    unsigned short header_checksum() const { return get_short_from_offsets(OFFSET_FIELD_HEADER_CHECKSUM_START, IPV4_HEADER_SIZE_IN_BYTES); }
+    unsigned short header_checksum() const { return get_short_from_offsets(OFFSET_FIELD_HEADER_CHECKSUM_START, OFFSET_FIELD_HEADER_CHECKSUM_END); }
     boost::asio::ip::address_v4 source_address() const;
     boost::asio::ip::address_v4 destination_address() const;
 
+    //Bytes following the header, options included
+    size_t payload_offset() const { return header_length(); }
+    size_t payload_size() const { return (is_ready()) ? (packet_size - header_length()) : 0; }
+
     //Helpers
-    void clear();
     bool is_ready() const;
+    bool is_checksum_valid() const;
 
-    friend std::istream& operator>>(std::istream& input_stream, ipv4_header& header)
+private:
+    unsigned short get_short_from_offsets(const unsigned short offset_1, const unsigned short offset_2) const
     {
-        input_stream.read(reinterpret_cast<char*>(header.packet_buffer), IPV4_HEADER_SIZE_IN_BYTES);
-        if (header.version() != 4)
-        {
-            input_stream.setstate(std::ios::failbit);
-        }
-            
-        //check if we can medir la radio
-        std::streamsize options_length = header.header_length() - IPV4_HEADER_SIZE_IN_BYTES;
-        if ((options_length < 0) ||
-            (options_length > 40))
-        {
-            input_stream.setstate(std::ios::failbit);
-        }            
-        else
-        {
-            input_stream.read(reinterpret_cast<char*>(header.packet_buffer) + IPV4_HEADER_SIZE_IN_BYTES, options_length);
-        }
-            
-        return input_stream;
+        return (packet_buffer[offset_1] << 8) + packet_buffer[offset_2];
     }
 
-private:
-    unsigned short get_short_from_offsets(const unsigned short offset_1, const unsigned short offset_2) const;
-
-    unsigned char packet_buffer[IPV4_PACKET_SIZE_IN_BYTES];
+    const unsigned char* packet_buffer;
+    size_t packet_size;
 };
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "latency_histogram.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It counts a new latency sample, anything over the covered range goes to the last bucket
+		void latency_histogram::add(const chrono::microseconds& latency)
+		{
+			uint32_t& bucket = m_buckets[get_bucket_index(latency)];
+
+			//saturated buckets just stop counting, they are already way past anything else
+			if (bucket < std::numeric_limits<uint32_t>::max())
+			{
+				++bucket;
+				++m_nr_of_samples;
+			}
+		}
+
+		//It adds the samples of the given histogram to this one
+		void latency_histogram::merge(const latency_histogram& other)
+		{
+			for (size_t bucket_index = 0; bucket_index < NR_OF_BUCKETS; ++bucket_index)
+			{
+				uint64_t merged_count = static_cast<uint64_t>(m_buckets[bucket_index]) + other.m_buckets[bucket_index];
+				uint32_t new_count = static_cast<uint32_t>(std::min<uint64_t>(merged_count, std::numeric_limits<uint32_t>::max()));
+
+				m_nr_of_samples += (new_count - m_buckets[bucket_index]);
+				m_buckets[bucket_index] = new_count;
+			}
+		}
+
+		//It returns the latency below which the given fraction (0 to 1) of the samples fall
+		//Zero is returned when there are no samples at all
+		chrono::microseconds latency_histogram::get_quantile(const double quantile) const
+		{
+			chrono::microseconds ret = chrono::microseconds::zero();
+
+			if ((m_nr_of_samples > 0) &&
+				(quantile >= 0.0) &&
+				(quantile <= 1.0))
+			{
+				//rank of the wanted sample, counting from zero
+				double rank = quantile * static_cast<double>(m_nr_of_samples - 1);
+				uint64_t nr_of_samples_so_far = 0;
+
+				for (size_t bucket_index = 0; bucket_index < NR_OF_BUCKETS; ++bucket_index)
+				{
+					nr_of_samples_so_far += m_buckets[bucket_index];
+					if (static_cast<double>(nr_of_samples_so_far) > rank)
+					{
+						ret = chrono::microseconds(static_cast<chrono::microseconds::rep>(std::llround(get_bucket_value(bucket_index))));
+						break;
+					}
+				}
+			}
+
+			return ret;
+		}
+
+		//It returns the number of samples counted so far
+		uint64_t latency_histogram::get_nr_of_samples() const
+		{
+			return m_nr_of_samples;
+		}
+
+		//It forgets about every sample
+		void latency_histogram::clear()
+		{
+			m_nr_of_samples = 0;
+			m_buckets.fill(0);
+		}
+
+		//It returns the highest relative error of the quantiles
+		double latency_histogram::get_relative_accuracy()
+		{
+			return ((get_gamma() - 1.0) / (get_gamma() + 1.0));
+		}
+
+		//It returns the bucket of the given latency, sub-microsecond latencies share the first one
+		size_t latency_histogram::get_bucket_index(const chrono::microseconds& latency)
+		{
+			size_t ret = 0;
+
+			//this runs on every reply, so the divisor is worked out once
+			static const double log_gamma = std::log(get_gamma());
+
+			if (latency.count() > 1)
+			{
+				double bucket_index = std::ceil(std::log(static_cast<double>(latency.count())) / log_gamma);
+				ret = static_cast<size_t>(std::min(bucket_index, static_cast<double>(NR_OF_BUCKETS - 1)));
+			}
+
+			return ret;
+		}
+
+		//It returns the latency reported for the samples of the given bucket
+		//It is the point of the bucket with the same relative distance to both of its borders
+		double latency_histogram::get_bucket_value(const size_t bucket_index)
+		{
+			double ret = 1.0;
+
+			if (bucket_index > 0)
+			{
+				ret = (2.0 * std::pow(get_gamma(), static_cast<double>(bucket_index))) / (get_gamma() + 1.0);
+			}
+
+			return ret;
+		}
+
+		//It returns the ratio between the borders of each bucket, picked so the buckets cover the whole latency range
+		double latency_histogram::get_gamma()
+		{
+			static const double gamma = std::exp(std::log(MAX_LATENCY_IN_US) / static_cast<double>(NR_OF_BUCKETS - 1));
+
+			return gamma;
+		}
+	}
+}
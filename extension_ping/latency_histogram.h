@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <boost/asio.hpp>
+#include <cstdint>
+
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Log-bucketed latency histogram, in the DDSketch way
+        //Bucket i holds the latencies in (gamma^(i-1), gamma^i] microseconds, so every quantile comes back
+        //within the same relative error no matter how long the tail is, and two histograms are merged
+        //by just adding their buckets up
+        //Buckets cover from 1 microsecond to 60 seconds with a relative error under 2%, in a fixed 2KB
+        class latency_histogram
+        {
+        public:
+            //Some magic data
+            static constexpr size_t NR_OF_BUCKETS = 512;
+            static constexpr double MAX_LATENCY_IN_US = 60000000.0;
+
+            latency_histogram() { clear(); }
+
+            void add(const chrono::microseconds& latency);
+            void merge(const latency_histogram& other);
+            chrono::microseconds get_quantile(const double quantile) const;
+            uint64_t get_nr_of_samples() const;
+            void clear();
+            static double get_relative_accuracy();
+
+        private:
+            //private helper methods
+            static size_t get_bucket_index(const chrono::microseconds& latency);
+            static double get_bucket_value(const size_t bucket_index);
+            static double get_gamma();
+
+            //member vars
+            uint64_t m_nr_of_samples;
+            std::array<uint32_t, NR_OF_BUCKETS> m_buckets;
+        };
+    }
+}
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include "latency_tracker.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It counts a new latency sample of the given target host
+		void latency_tracker::store_sample(const std::string& target_host, const chrono::microseconds& latency)
+		{
+			store_sample(target_host, latency, chrono::steady_clock::now());
+		}
+
+		//It counts a new latency sample of the given target host at the given point in time
+		//The slot it falls in gets recycled first if it still holds an older time slot
+		void latency_tracker::store_sample(const std::string& target_host, const chrono::microseconds& latency, const chrono::steady_clock::time_point& now)
+		{
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			auto entry_it = m_entries.find(target_host);
+			if (entry_it == m_entries.end())
+			{
+				if (m_entries.size() >= m_max_nr_of_entries)
+				{
+					make_room();
+				}
+
+				tracked_host new_entry;
+				new_entry.slot_ids.assign(m_nr_of_slots, -1);
+				new_entry.slots.resize(m_nr_of_slots);
+				entry_it = m_entries.emplace(target_host, std::move(new_entry)).first;
+			}
+
+			tracked_host& entry = entry_it->second;
+			int64_t slot_id = get_slot_id(now);
+			size_t slot_index = static_cast<size_t>(slot_id % static_cast<int64_t>(m_nr_of_slots));
+
+			if (entry.slot_ids[slot_index] != slot_id)
+			{
+				entry.slot_ids[slot_index] = slot_id;
+				entry.slots[slot_index].clear();
+			}
+
+			entry.slots[slot_index].add(latency);
+			entry.last_update_time = now;
+		}
+
+		//It merges the histograms of the given target host that fall within the given window, ending now
+		bool latency_tracker::get_histogram(const std::string& target_host, const chrono::seconds& window, latency_histogram& histogram)
+		{
+			return get_histogram(target_host, window, chrono::steady_clock::now(), histogram);
+		}
+
+		//It merges the histograms of the given target host that fall within the given window, ending at the given point in time
+		//Windows are rounded up to whole slots, the current slot always counts
+		bool latency_tracker::get_histogram(const std::string& target_host, const chrono::seconds& window, const chrono::steady_clock::time_point& now, latency_histogram& histogram)
+		{
+			bool ret = false;
+
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			auto entry_it = m_entries.find(target_host);
+			if (entry_it != m_entries.end())
+			{
+				int64_t current_slot_id = get_slot_id(now);
+				int64_t nr_of_slots = std::max<int64_t>(1, (window.count() + m_slot_duration.count() - 1) / m_slot_duration.count());
+				nr_of_slots = std::min<int64_t>(nr_of_slots, static_cast<int64_t>(m_nr_of_slots));
+
+				histogram.clear();
+				for (size_t slot_index = 0; slot_index < m_nr_of_slots; ++slot_index)
+				{
+					int64_t slot_id = entry_it->second.slot_ids[slot_index];
+					if ((slot_id > (current_slot_id - nr_of_slots)) &&
+						(slot_id <= current_slot_id))
+					{
+						histogram.merge(entry_it->second.slots[slot_index]);
+					}
+				}
+
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It returns every target host being tracked
+		void latency_tracker::get_target_hosts(std::vector<std::string>& target_hosts)
+		{
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			for (const auto& entry : m_entries)
+			{
+				target_hosts.push_back(entry.first);
+			}
+		}
+
+		//It sets the duration and number of the time slots, previous samples are dropped as they no longer fit
+		bool latency_tracker::set_slots(const chrono::seconds& slot_duration, const size_t nr_of_slots)
+		{
+			bool ret = false;
+
+			if ((slot_duration > chrono::seconds::zero()) &&
+				(nr_of_slots > 0))
+			{
+				std::lock_guard<std::mutex> guard(m_tracker_mutex);
+				m_slot_duration = slot_duration;
+				m_nr_of_slots = nr_of_slots;
+				m_entries.clear();
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It returns the longest window histograms can be read over
+		chrono::seconds latency_tracker::get_max_window()
+		{
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			return (m_slot_duration * static_cast<chrono::seconds::rep>(m_nr_of_slots));
+		}
+
+		//It forgets about every target host
+		void latency_tracker::clear()
+		{
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+			m_entries.clear();
+		}
+
+		//It returns the number of target hosts being tracked
+		size_t latency_tracker::size()
+		{
+			std::lock_guard<std::mutex> guard(m_tracker_mutex);
+
+			return m_entries.size();
+		}
+
+		//It returns the time slot the given point in time falls in
+		int64_t latency_tracker::get_slot_id(const chrono::steady_clock::time_point& now) const
+		{
+			return static_cast<int64_t>(chrono::duration_cast<chrono::seconds>(now.time_since_epoch()).count() / m_slot_duration.count());
+		}
+
+		//It keeps the tracker bounded, the least recently updated host goes first
+		void latency_tracker::make_room()
+		{
+			if (!m_entries.empty())
+			{
+				auto oldest_entry_it = std::min_element(m_entries.begin(), m_entries.end(),
+					[](const std::pair<const std::string, tracked_host>& first, const std::pair<const std::string, tracked_host>& second)
+					{
+						return (first.second.last_update_time < second.second.last_update_time);
+					});
+
+				m_entries.erase(oldest_entry_it);
+			}
+		}
+	}
+}
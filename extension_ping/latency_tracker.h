@@ -0,0 +1,65 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "latency_histogram.h"
+
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Per target host rolling latency histograms shared across executions
+        //Each target host gets a ring of histograms, one per time slot, and the slots falling within
+        //the requested window get merged on lookup, so percentiles can be read over any window up to
+        //the whole ring while every reply only costs one bucket increment
+        //Memory is fixed per target host, the ring is allocated on its first sample
+        class latency_tracker
+        {
+        public:
+            //Some magic data
+            static constexpr unsigned int DEFAULT_SLOT_DURATION_IN_S = 300;
+            static constexpr size_t DEFAULT_NR_OF_SLOTS = 12;
+            static constexpr size_t DEFAULT_MAX_NR_OF_ENTRIES = 1024;
+
+            latency_tracker() :
+                m_slot_duration(chrono::seconds(DEFAULT_SLOT_DURATION_IN_S)),
+                m_nr_of_slots(DEFAULT_NR_OF_SLOTS),
+                m_max_nr_of_entries(DEFAULT_MAX_NR_OF_ENTRIES) {}
+
+            void store_sample(const std::string& target_host, const chrono::microseconds& latency);
+            void store_sample(const std::string& target_host, const chrono::microseconds& latency, const chrono::steady_clock::time_point& now);
+            bool get_histogram(const std::string& target_host, const chrono::seconds& window, latency_histogram& histogram);
+            bool get_histogram(const std::string& target_host, const chrono::seconds& window, const chrono::steady_clock::time_point& now, latency_histogram& histogram);
+            void get_target_hosts(std::vector<std::string>& target_hosts);
+            bool set_slots(const chrono::seconds& slot_duration, const size_t nr_of_slots);
+            chrono::seconds get_max_window();
+            void clear();
+            size_t size();
+
+        private:
+            //per target host ring of histograms, each slot knows which time slot it holds
+            typedef struct tracked_host_unit
+            {
+                std::vector<int64_t> slot_ids;
+                std::vector<latency_histogram> slots;
+                chrono::steady_clock::time_point last_update_time;
+            } tracked_host;
+
+            //private helper methods
+            int64_t get_slot_id(const chrono::steady_clock::time_point& now) const;
+            void make_room();
+
+            //member vars
+            std::mutex m_tracker_mutex;
+            chrono::seconds m_slot_duration;
+            size_t m_nr_of_slots;
+            size_t m_max_nr_of_entries;
+            std::unordered_map<std::string, tracked_host> m_entries;
+        };
+    }
+}
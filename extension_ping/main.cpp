@@ -7,6 +7,7 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <osquery/core/flags.h>
 #include <osquery/core/system.h>
 #include <osquery/sdk/sdk.h>
 #include <osquery/sql/dynamic_table_row.h>
@@ -25,6 +26,421 @@ namespace ping_definitions {
     static const char* COLUMN_NAME_SEQUENCE_NUMBER = "sequence_number";
     static const char* COLUMN_NAME_TIME_TO_LIVE = "time_to_live";
     static const char* COLUMN_NAME_LATENCY = "latency";
+    static const char* COLUMN_NAME_LATENCY_US = "latency_us";
+    static const char* COLUMN_NAME_TIMESTAMP = "timestamp";
+    static const char* COLUMN_NAME_ADDRESS_FAMILY = "address_family";
+    static const char* PING_CACHE_TABLE_NAME = "ping_cache";
+    static const char* PING_HISTORY_TABLE_NAME = "ping_history";
+    static const char* PING_CHANGES_TABLE_NAME = "ping_changes";
+    static const char* COLUMN_NAME_STATE = "state";
+    static const char* COLUMN_NAME_PREVIOUS_STATE = "previous_state";
+    static const char* COLUMN_NAME_PREVIOUS_IP_ADDRESS = "previous_ip_address";
+    static const char* COLUMN_NAME_RTT_BAND_LOW_US = "rtt_band_low_us";
+    static const char* COLUMN_NAME_RTT_BAND_HIGH_US = "rtt_band_high_us";
+    static const char* COLUMN_NAME_CHANGES = "changes";
+    static const char* COLUMN_NAME_COUNT = "count";
+    static const char* COLUMN_NAME_INTERVAL_MS = "interval_ms";
+    static const char* COLUMN_NAME_TIMEOUT_MS = "timeout_ms";
+    static const char* COLUMN_NAME_PAYLOAD_SIZE = "payload_size";
+    static const char* PING_STATS_TABLE_NAME = "ping_stats";
+    static const char* COLUMN_NAME_TRANSMITTED = "transmitted";
+    static const char* COLUMN_NAME_RECEIVED = "received";
+    static const char* COLUMN_NAME_PACKET_LOSS = "packet_loss";
+    static const char* COLUMN_NAME_MIN_US = "min_us";
+    static const char* COLUMN_NAME_AVG_US = "avg_us";
+    static const char* COLUMN_NAME_MAX_US = "max_us";
+    static const char* COLUMN_NAME_STDDEV_US = "stddev_us";
+    static const char* COLUMN_NAME_JITTER_US = "jitter_us";
+    static const char* PING_QUANTILES_TABLE_NAME = "ping_quantiles";
+    static const char* COLUMN_NAME_WINDOW_S = "window_s";
+    static const char* COLUMN_NAME_QUANTILE = "quantile";
+    static const char* COLUMN_NAME_SAMPLES = "samples";
+    static const double DEFAULT_QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+    static const char* PING_ENGINE_METRICS_TABLE_NAME = "ping_engine_metrics";
+    static const char* COLUMN_NAME_ENGINE = "engine";
+    static const char* COLUMN_NAME_TYPE = "type";
+    static const char* COLUMN_NAME_NAME = "name";
+    static const char* COLUMN_NAME_TOTAL_US = "total_us";
+    static const char* COLUMN_NAME_P50_US = "p50_us";
+    static const char* COLUMN_NAME_P90_US = "p90_us";
+    static const char* COLUMN_NAME_P99_US = "p99_us";
+    static const char* COLUMN_NAME_ERROR_CODE = "error_code";
+    static const char* COLUMN_NAME_ERROR_CATEGORY = "error_category";
+    static const char* COLUMN_NAME_ERROR_MESSAGE = "error_message";
+    static const char* ENGINE_NAME_QUERY = "query";
+    static const char* ENGINE_NAME_BACKGROUND = "background";
+    static const char* METRIC_TYPE_COUNTER = "counter";
+    static const char* METRIC_TYPE_STAGE = "stage";
+    static const char* METRIC_TYPE_ERROR = "error";
+}
+
+FLAG(uint64,
+     ping_min_timeout_ms,
+     utils::ping::rtt_estimator::DEFAULT_MIN_TIMEOUT_IN_MS,
+     "Minimum time in milliseconds to wait for an ICMP echo reply");
+
+FLAG(uint64,
+     ping_max_timeout_ms,
+     utils::ping::rtt_estimator::DEFAULT_MAX_TIMEOUT_IN_MS,
+     "Maximum time in milliseconds to wait for an ICMP echo reply");
+
+FLAG(uint64,
+     ping_initial_timeout_ms,
+     utils::ping::rtt_estimator::DEFAULT_INITIAL_TIMEOUT_IN_MS,
+     "Time in milliseconds to wait for an ICMP echo reply of a host with no round trip time history");
+
+FLAG(string,
+     ping_socket_type,
+     "auto",
+     "ICMP socket to ping through: datagram (unprivileged ping socket), raw, or auto to try datagram first");
+
+FLAG(string,
+     ping_address_family,
+     "ipv4",
+     "Address family hosts are pinged on when a query does not ask for one: ipv4, ipv6, or dual to ping hostnames on both at once");
+
+FLAG(uint64,
+     ping_engine_shards,
+     utils::ping::sharded_ping_executor::DEFAULT_NR_OF_SHARDS,
+     "Number of ICMP ping engines queries are spread over, each one with its own thread, sockets and ICMP identifier range");
+
+FLAG(bool,
+     ping_engine_pin_cores,
+     false,
+     "Pin the thread of each ICMP ping engine that serves queries to its own core (Linux only)");
+
+FLAG(string,
+     ping_cache_targets,
+     "",
+     "Comma separated hosts to probe in the background for the ping_cache and ping_history tables, each one optionally followed by @<interval in ms>");
+
+FLAG(uint64,
+     ping_cache_interval_ms,
+     utils::ping::ping_scheduler::DEFAULT_INTERVAL_IN_MS,
+     "Time in milliseconds between background probes of a host with no interval of its own");
+
+FLAG(uint64,
+     ping_cache_history_size,
+     utils::ping::ping_scheduler::DEFAULT_HISTORY_SIZE,
+     "Number of background probe samples kept per host");
+
+FLAG(uint64,
+     ping_max_send_rate,
+     utils::ping::send_pacer::DEFAULT_MAX_SEND_RATE,
+     "Maximum ICMP echo requests per second sent by the whole extension, 0 means no limit");
+
+FLAG(uint64,
+     ping_send_burst,
+     utils::ping::send_pacer::DEFAULT_SEND_BURST,
+     "ICMP echo requests the extension can send back to back after an idle period");
+
+FLAG(uint64,
+     ping_max_subnet_send_rate,
+     utils::ping::send_pacer::DEFAULT_MAX_SUBNET_SEND_RATE,
+     "Maximum ICMP echo requests per second sent to each /24 subnet, 0 means no limit");
+
+FLAG(uint64,
+     ping_subnet_send_burst,
+     utils::ping::send_pacer::DEFAULT_SUBNET_SEND_BURST,
+     "ICMP echo requests that can be sent back to back to each /24 subnet after an idle period");
+
+FLAG(uint64,
+     ping_histogram_slot_s,
+     utils::ping::latency_tracker::DEFAULT_SLOT_DURATION_IN_S,
+     "Time in seconds covered by each latency histogram slot of the ping_quantiles table");
+
+FLAG(uint64,
+     ping_histogram_slots,
+     utils::ping::latency_tracker::DEFAULT_NR_OF_SLOTS,
+     "Number of latency histogram slots kept per host, the longest window is this many slots");
+
+
+//It returns the columns shared by every ping table
+static TableColumns get_ping_columns(ColumnOptions host_column_options)
+{
+  return {
+      std::make_tuple(ping_definitions::COLUMN_NAME_HOST,
+                      osquery::TEXT_TYPE,
+                      host_column_options),
+
+      std::make_tuple(ping_definitions::COLUMN_NAME_RESULT,
+                      TEXT_TYPE,
+                      ColumnOptions::DEFAULT),
+
+      std::make_tuple(ping_definitions::COLUMN_NAME_IP_ADDRESS,
+                      TEXT_TYPE,
+                      ColumnOptions::DEFAULT),
+
+      std::make_tuple(ping_definitions::COLUMN_NAME_SEQUENCE_NUMBER,
+                      INTEGER_TYPE,
+                      ColumnOptions::DEFAULT),
+
+      std::make_tuple(ping_definitions::COLUMN_NAME_TIME_TO_LIVE,
+                      INTEGER_TYPE,
+                      ColumnOptions::DEFAULT),
+
+      std::make_tuple(ping_definitions::COLUMN_NAME_LATENCY,
+                      UNSIGNED_BIGINT_TYPE,
+                      ColumnOptions::DEFAULT),
+
+      std::make_tuple(ping_definitions::COLUMN_NAME_LATENCY_US,
+                      UNSIGNED_BIGINT_TYPE,
+                      ColumnOptions::DEFAULT),
+
+      std::make_tuple(ping_definitions::COLUMN_NAME_ADDRESS_FAMILY,
+                      INTEGER_TYPE,
+                      ColumnOptions::DEFAULT)
+  };
+}
+
+//It appends the hidden columns tuning the ICMP echo requests of a query
+//Like `SELECT * FROM ping WHERE host = 'x' AND count = 4 AND timeout_ms = 200;`
+static void add_ping_option_columns(TableColumns& columns)
+{
+  for (const auto& column_name : {ping_definitions::COLUMN_NAME_COUNT,
+                                  ping_definitions::COLUMN_NAME_INTERVAL_MS,
+                                  ping_definitions::COLUMN_NAME_TIMEOUT_MS,
+                                  ping_definitions::COLUMN_NAME_PAYLOAD_SIZE}) {
+    columns.push_back(std::make_tuple(column_name,
+                                      INTEGER_TYPE,
+                                      ColumnOptions::HIDDEN));
+  }
+}
+
+//It reads a single integer query constraint, it returns false if it was given more than once or it is negative
+static bool get_ping_option_constraint(QueryContext& request, const char* column_name, int& value)
+{
+  bool ret = false;
+
+  auto values = request.constraints[column_name].getAll<int>(osquery::EQUALS);
+  if (values.empty()) {
+    ret = true;
+  } else if ((values.size() == 1) && (*values.begin() >= 0)) {
+    value = *values.begin();
+    ret = true;
+  }
+
+  return ret;
+}
+
+//It parses an address family name (ipv4, ipv6 or dual), it returns false if it is not a known one
+static bool get_address_family(const std::string& address_family_name, utils::ping::icmp_transport::ADDRESS_FAMILY& address_family)
+{
+  bool ret = true;
+
+  if (address_family_name == "ipv4") {
+    address_family = utils::ping::icmp_transport::IPV4_FAMILY;
+  } else if (address_family_name == "ipv6") {
+    address_family = utils::ping::icmp_transport::IPV6_FAMILY;
+  } else if (address_family_name == "dual") {
+    address_family = utils::ping::icmp_transport::DUAL_STACK_FAMILY;
+  } else {
+    ret = false;
+  }
+
+  return ret;
+}
+
+//Address family of queries with no address_family constraint, it is parsed once out of the ping_address_family flag
+//at startup, before any query runs
+static utils::ping::icmp_transport::ADDRESS_FAMILY default_address_family = utils::ping::icmp_transport::IPV4_FAMILY;
+
+//It reads the address family out of the address_family constraint, `address_family IN (4, 6)` pings both at once
+//With no constraint the ping_address_family flag is used
+static bool get_address_family_constraint(QueryContext& request, utils::ping::icmp_transport::ADDRESS_FAMILY& address_family)
+{
+  bool ret = false;
+
+  auto values = request.constraints[ping_definitions::COLUMN_NAME_ADDRESS_FAMILY].getAll<int>(osquery::EQUALS);
+  if (values.empty()) {
+    address_family = default_address_family;
+    ret = true;
+  } else if (values == std::set<int>{utils::ping::icmp_transport::IPV4_FAMILY}) {
+    address_family = utils::ping::icmp_transport::IPV4_FAMILY;
+    ret = true;
+  } else if (values == std::set<int>{utils::ping::icmp_transport::IPV6_FAMILY}) {
+    address_family = utils::ping::icmp_transport::IPV6_FAMILY;
+    ret = true;
+  } else if (values == std::set<int>{utils::ping::icmp_transport::IPV4_FAMILY, utils::ping::icmp_transport::IPV6_FAMILY}) {
+    address_family = utils::ping::icmp_transport::DUAL_STACK_FAMILY;
+    ret = true;
+  }
+
+  return ret;
+}
+
+//It reads the ICMP echo request options out of the hidden columns constraints, missing ones keep their default
+//It logs a warning if the options are not valid
+static bool get_ping_request_options(QueryContext& request, utils::ping::ping_request_options& options)
+{
+  bool ret = false;
+
+  int count = static_cast<int>(options.nr_of_ping_requests);
+  int interval_ms = static_cast<int>(options.request_interval.count());
+  int timeout_ms = static_cast<int>(options.timeout.count());
+  int payload_size = static_cast<int>(options.payload_size);
+
+  if ((get_ping_option_constraint(request, ping_definitions::COLUMN_NAME_COUNT, count)) &&
+      (get_ping_option_constraint(request, ping_definitions::COLUMN_NAME_INTERVAL_MS, interval_ms)) &&
+      (get_ping_option_constraint(request, ping_definitions::COLUMN_NAME_TIMEOUT_MS, timeout_ms)) &&
+      (get_ping_option_constraint(request, ping_definitions::COLUMN_NAME_PAYLOAD_SIZE, payload_size)) &&
+      (get_address_family_constraint(request, options.address_family))) {
+    options.nr_of_ping_requests = count;
+    options.request_interval = std::chrono::milliseconds(interval_ms);
+    options.timeout = std::chrono::milliseconds(timeout_ms);
+    options.payload_size = payload_size;
+    ret = options.is_valid();
+  }
+
+  if (!ret) {
+    LOG(WARNING) << "Invalid ping request options, count, interval_ms, timeout_ms and payload_size can only be given once and within their limits, and address_family can only be 4, 6 or both";
+  }
+
+  return ret;
+}
+
+//It fills the hidden columns with the options the row was probed with, so it matches the query constraints
+static void fill_ping_options_row(const utils::ping::ping_request_options& options, DynamicTableRowHolder& new_row)
+{
+  new_row[ping_definitions::COLUMN_NAME_COUNT] =
+      INTEGER(options.nr_of_ping_requests);
+  new_row[ping_definitions::COLUMN_NAME_INTERVAL_MS] =
+      INTEGER(options.request_interval.count());
+  new_row[ping_definitions::COLUMN_NAME_TIMEOUT_MS] =
+      INTEGER(options.timeout.count());
+  new_row[ping_definitions::COLUMN_NAME_PAYLOAD_SIZE] =
+      INTEGER(options.payload_size);
+}
+
+//It returns the text of the result column for the given kind of ping response
+static const char* get_ping_result_text(const unsigned int type, const bool valid_checksum)
+{
+  const char* ret = "";
+
+  if (type == utils::ping::ping_response_data::TARGET_HOST_NOT_FOUND) {
+    ret = "Target host was not found";
+  } else if (type == utils::ping::ping_response_data::TIMEOUT) {
+    ret = "There was a timeout waiting for response from target host";
+  } else if (type == utils::ping::ping_response_data::REPLY_DATA) {
+    ret = (valid_checksum) ? "Success" : "Reply was received with an invalid checksum";
+  }
+
+  return ret;
+}
+
+//It fills a table row out of a ping response, it returns false if there is nothing to report
+static bool fill_ping_row(const utils::ping::ping_response_data& ping_data, DynamicTableRowHolder& new_row)
+{
+  bool ret = true;
+
+  new_row[ping_definitions::COLUMN_NAME_ADDRESS_FAMILY] =
+      INTEGER(ping_data.address_family);
+
+  if (ping_data.type == ping_data.TARGET_HOST_NOT_FOUND) { //Checking if this is a host not found scenario
+    new_row[ping_definitions::COLUMN_NAME_HOST] = 
+        ping_data.target_hostname;
+    new_row[ping_definitions::COLUMN_NAME_RESULT] =
+        get_ping_result_text(ping_data.type, ping_data.valid_checksum);
+
+  } else if (ping_data.type == ping_data.TIMEOUT) { //Checking if this is a timeout scenario
+    new_row[ping_definitions::COLUMN_NAME_HOST] = 
+        ping_data.target_hostname;
+    new_row[ping_definitions::COLUMN_NAME_RESULT] =
+        get_ping_result_text(ping_data.type, ping_data.valid_checksum);
+    new_row[ping_definitions::COLUMN_NAME_IP_ADDRESS] = 
+        ping_data.response_address;
+
+  } else if (ping_data.type == ping_data.REPLY_DATA) { //Checking if this is a new data scenario
+    new_row[ping_definitions::COLUMN_NAME_HOST] =
+        ping_data.target_hostname;
+    new_row[ping_definitions::COLUMN_NAME_RESULT] = 
+        get_ping_result_text(ping_data.type, ping_data.valid_checksum);
+    new_row[ping_definitions::COLUMN_NAME_IP_ADDRESS] =
+        INTEGER(ping_data.response_address);
+    new_row[ping_definitions::COLUMN_NAME_SEQUENCE_NUMBER] =
+        INTEGER(ping_data.sequence_number);
+    new_row[ping_definitions::COLUMN_NAME_TIME_TO_LIVE] =
+        INTEGER(ping_data.time_to_live);
+    new_row[ping_definitions::COLUMN_NAME_LATENCY] =
+        UNSIGNED_BIGINT(ping_data.round_trip_time);
+    new_row[ping_definitions::COLUMN_NAME_LATENCY_US] =
+        UNSIGNED_BIGINT(ping_data.round_trip_time_us);
+
+  } else {
+    ret = false;
+  }
+
+  return ret;
+}
+
+//It fills a table row out of a compact ping result, this is the only place its response address becomes text
+//It returns false if there is nothing to report
+static bool fill_ping_row(const utils::ping::ping_result_record& result,
+                          const std::string& target_hostname,
+                          DynamicTableRowHolder& new_row)
+{
+  bool ret = true;
+
+  new_row[ping_definitions::COLUMN_NAME_ADDRESS_FAMILY] =
+      INTEGER(result.address_family);
+
+  if ((result.type == utils::ping::ping_response_data::TARGET_HOST_NOT_FOUND) ||
+      (result.type == utils::ping::ping_response_data::TIMEOUT)) { //Checking if this is a host not found or a timeout scenario
+    new_row[ping_definitions::COLUMN_NAME_HOST] =
+        target_hostname;
+    new_row[ping_definitions::COLUMN_NAME_RESULT] =
+        get_ping_result_text(result.type, result.valid_checksum);
+    if (result.type == utils::ping::ping_response_data::TIMEOUT) {
+      new_row[ping_definitions::COLUMN_NAME_IP_ADDRESS] =
+          utils::ping::ping_result_pool::get_response_address_text(result);
+    }
+
+  } else if (result.type == utils::ping::ping_response_data::REPLY_DATA) { //Checking if this is a new data scenario
+    new_row[ping_definitions::COLUMN_NAME_HOST] =
+        target_hostname;
+    new_row[ping_definitions::COLUMN_NAME_RESULT] =
+        get_ping_result_text(result.type, result.valid_checksum);
+    new_row[ping_definitions::COLUMN_NAME_IP_ADDRESS] =
+        utils::ping::ping_result_pool::get_response_address_text(result);
+    new_row[ping_definitions::COLUMN_NAME_SEQUENCE_NUMBER] =
+        INTEGER(result.sequence_number);
+    new_row[ping_definitions::COLUMN_NAME_TIME_TO_LIVE] =
+        INTEGER(result.time_to_live);
+    new_row[ping_definitions::COLUMN_NAME_LATENCY] =
+        UNSIGNED_BIGINT(result.round_trip_time_us / 1000);
+    new_row[ping_definitions::COLUMN_NAME_LATENCY_US] =
+        UNSIGNED_BIGINT(result.round_trip_time_us);
+
+  } else {
+    ret = false;
+  }
+
+  return ret;
+}
+
+//Rows of a swept network or address range keep the range as their host, so they match the query constraint,
+//and the probed address goes to the ip_address column
+static void fill_ping_range_row(const std::vector<std::pair<std::string, utils::ping::target_range>>& target_ranges,
+                                const utils::ping::ping_result_record& result,
+                                const std::string& target_hostname,
+                                DynamicTableRowHolder& new_row)
+{
+  boost::system::error_code address_error_code;
+  auto target_address = boost::asio::ip::make_address_v4(target_hostname, address_error_code);
+
+  if (!address_error_code) {
+    for (const auto& target_range : target_ranges) {
+      if (target_range.second.contains(target_address)) {
+        new_row[ping_definitions::COLUMN_NAME_HOST] =
+            target_range.first;
+        if (result.type == utils::ping::ping_response_data::TIMEOUT) {
+          new_row[ping_definitions::COLUMN_NAME_IP_ADDRESS] =
+              target_hostname;
+        }
+        break;
+      }
+    }
+  }
 }
 
 
@@ -34,10 +450,254 @@ class PingTable : public TablePlugin
 
   // It return the table's column name and type pairs
   TableColumns columns() const {
-    return {
+    auto ret = get_ping_columns(osquery::ColumnOptions::REQUIRED);
+    add_ping_option_columns(ret);
+    return ret;
+  }
+
+
+  //It generates a complete table representation
+  TableRows generate(QueryContext& request) 
+  {
+    TableRows results;
+
+    auto hosts = request.constraints[ping_definitions::COLUMN_NAME_HOST].getAll(osquery::EQUALS); 
+
+    try {
+      //All the requested hosts are pinged at once, so a few slow or down hosts do not add up
+      //Networks (10.0.0.0/24) and address ranges (10.0.0.1-10.0.0.50) are swept too
+      std::vector<std::string> target_hosts;
+      std::vector<std::pair<std::string, utils::ping::target_range>> target_ranges;
+      for (const auto& host : hosts) {
+        utils::ping::target_range new_range;
+        if (new_range.parse(host)) {
+          target_ranges.emplace_back(host, new_range);
+        } else {
+          target_hosts.push_back(host);
+        }
+      }
+
+      //Results stay compact records in a pool of this query until their rows are built
+      utils::ping::ping_result_pool result_pool;
+      utils::ping::ping_request_options options;
+
+      //Sending the actual ping requests, tuned through the hidden columns
+      const bool valid_options = get_ping_request_options(request, options);
+      if ((valid_options) && (!target_ranges.empty())) {
+
+        //Ranges are walked lazily through a bounded window of in-flight hosts,
+        //and rows are built as each host completes
+        size_t next_host_index = 0;
+        size_t next_range_index = 0;
+        auto next_target_host = [&](std::string& target_host) {
+          bool ret = false;
+
+          //an empty host would read as none ready yet, so they are skipped
+          while ((!ret) && (next_host_index < target_hosts.size())) {
+            target_host = target_hosts[next_host_index++];
+            ret = (!target_host.empty());
+          }
+
+          while ((!ret) && (next_range_index < target_ranges.size())) {
+            ret = target_ranges[next_range_index].second.next(target_host);
+            if (!ret) {
+              ++next_range_index;
+            }
+          }
+
+          return ret;
+        };
+
+        utils::send_icmp_ping_to_targets(next_target_host, options, [&](const utils::ping::ping_result_record& result, const std::string& target_hostname) {
+          auto new_row = make_table_row();
+          if (fill_ping_row(result, target_hostname, new_row)) {
+            if (hosts.count(target_hostname) == 0) {
+              fill_ping_range_row(target_ranges, result, target_hostname, new_row);
+            }
+            fill_ping_options_row(options, new_row);
+            results.push_back(std::move(new_row));
+          }
+        });
+      } else if ((valid_options) &&
+          (utils::send_icmp_ping_to_targets(target_hosts, options, result_pool) &&
+          (!result_pool.empty()))) {
+
+        //Parsing the ping results
+        results.reserve(result_pool.size());
+        for (const auto& result : result_pool.get_records()) {
+          auto new_row = make_table_row();
+          if (fill_ping_row(result, result_pool.get_hostname(result.host_id), new_row)) {
+            fill_ping_options_row(options, new_row);
+            results.push_back(std::move(new_row));
+          }
+        }
+      }
+    } 
+    catch (std::exception& error) 
+    {
+      LOG(WARNING) << "There was a problem running ping request: " << error.what();
+    }
+
+    return results;
+  }
+};
+
+
+//Tables reading what the background scheduler already probed, no packets are sent on queries
+class PingSamplesTable : public TablePlugin 
+{
+ public:
+  explicit PingSamplesTable(bool latest_only) : latest_only_(latest_only) {}
+
+ private:
+
+  // It return the table's column name and type pairs
+  TableColumns columns() const {
+    auto ret = get_ping_columns(osquery::ColumnOptions::INDEX);
+    ret.push_back(std::make_tuple(ping_definitions::COLUMN_NAME_TIMESTAMP,
+                                  BIGINT_TYPE,
+                                  ColumnOptions::DEFAULT));
+    return ret;
+  }
+
+
+  //It generates a complete table representation out of the in-memory samples
+  TableRows generate(QueryContext& request) 
+  {
+    TableRows results;
+
+    auto hosts = request.constraints[ping_definitions::COLUMN_NAME_HOST].getAll(osquery::EQUALS); 
+
+    utils::ping::ping_sample_collection samples;
+    utils::get_ping_scheduler().get_samples(hosts, latest_only_, samples);
+
+    for (const auto& sample : samples) {
+      auto new_row = make_table_row();
+      if (fill_ping_row(sample.data, new_row)) {
+        new_row[ping_definitions::COLUMN_NAME_TIMESTAMP] =
+            BIGINT(std::chrono::duration_cast<std::chrono::seconds>(sample.probe_time.time_since_epoch()).count());
+        results.push_back(std::move(new_row));
+      }
+    }
+
+    return results;
+  }
+
+  bool latest_only_;
+};
+
+//Latest sample of each host
+class PingCacheTable : public PingSamplesTable
+{
+ public:
+  PingCacheTable() : PingSamplesTable(true) {}
+};
+
+//Every sample kept for each host
+class PingHistoryTable : public PingSamplesTable
+{
+ public:
+  PingHistoryTable() : PingSamplesTable(false) {}
+};
+
+
+//Table pinging the requested hosts like the ping one, but only returning the hosts whose state changed
+//since the last time they were pinged: reachability, responding IP address or RTT band
+class PingChangesTable : public TablePlugin 
+{
+ private:
+
+  // It return the table's column name and type pairs
+  TableColumns columns() const {
+    auto ret = get_ping_columns(osquery::ColumnOptions::REQUIRED);
+
+    ret.push_back(std::make_tuple(ping_definitions::COLUMN_NAME_STATE,
+                                  TEXT_TYPE,
+                                  ColumnOptions::DEFAULT));
+    ret.push_back(std::make_tuple(ping_definitions::COLUMN_NAME_PREVIOUS_STATE,
+                                  TEXT_TYPE,
+                                  ColumnOptions::DEFAULT));
+    ret.push_back(std::make_tuple(ping_definitions::COLUMN_NAME_PREVIOUS_IP_ADDRESS,
+                                  TEXT_TYPE,
+                                  ColumnOptions::DEFAULT));
+    ret.push_back(std::make_tuple(ping_definitions::COLUMN_NAME_RTT_BAND_LOW_US,
+                                  UNSIGNED_BIGINT_TYPE,
+                                  ColumnOptions::DEFAULT));
+    ret.push_back(std::make_tuple(ping_definitions::COLUMN_NAME_RTT_BAND_HIGH_US,
+                                  UNSIGNED_BIGINT_TYPE,
+                                  ColumnOptions::DEFAULT));
+    ret.push_back(std::make_tuple(ping_definitions::COLUMN_NAME_CHANGES,
+                                  TEXT_TYPE,
+                                  ColumnOptions::DEFAULT));
+    add_ping_option_columns(ret);
+    return ret;
+  }
+
+
+  //It generates the rows of the hosts whose state changed
+  TableRows generate(QueryContext& request) 
+  {
+    TableRows results;
+
+    auto hosts = request.constraints[ping_definitions::COLUMN_NAME_HOST].getAll(osquery::EQUALS); 
+
+    try {
+      std::vector<std::string> target_hosts(hosts.begin(), hosts.end());
+      utils::ping::ping_response_data_collection result_ping_data;
+      utils::ping::host_state_tracker::state_change_collection state_changes;
+      utils::ping::ping_request_options options;
+
+      if ((get_ping_request_options(request, options)) &&
+          (utils::send_icmp_ping_to_targets(target_hosts, options, result_ping_data))) {
+        utils::get_host_state_tracker().update(result_ping_data, state_changes);
+      }
+
+      for (const auto& state_change : state_changes) {
+        auto new_row = make_table_row();
+        if (fill_ping_row(state_change.data, new_row)) {
+          new_row[ping_definitions::COLUMN_NAME_STATE] =
+              utils::ping::host_state_tracker::get_state_name(state_change.current_state.state);
+          new_row[ping_definitions::COLUMN_NAME_PREVIOUS_STATE] =
+              utils::ping::host_state_tracker::get_state_name(state_change.previous_state.state);
+          new_row[ping_definitions::COLUMN_NAME_PREVIOUS_IP_ADDRESS] =
+              state_change.previous_state.response_address;
+          new_row[ping_definitions::COLUMN_NAME_CHANGES] =
+              utils::ping::host_state_tracker::get_changes_description(state_change.changes);
+          fill_ping_options_row(options, new_row);
+
+          if (state_change.current_state.state == utils::ping::host_state_tracker::REACHABLE) {
+            new_row[ping_definitions::COLUMN_NAME_RTT_BAND_LOW_US] =
+                UNSIGNED_BIGINT(state_change.rtt_band_low_us);
+            new_row[ping_definitions::COLUMN_NAME_RTT_BAND_HIGH_US] =
+                UNSIGNED_BIGINT(state_change.rtt_band_high_us);
+          }
+
+          results.push_back(std::move(new_row));
+        }
+      }
+    } 
+    catch (std::exception& error) 
+    {
+      LOG(WARNING) << "There was a problem running ping request: " << error.what();
+    }
+
+    return results;
+  }
+};
+
+
+//Table returning a single summary row per host, like the one ping prints on exit
+//Echoes are folded into the summary by the engine as they complete, so large counts do not add rows
+class PingStatsTable : public TablePlugin 
+{
+ private:
+
+  // It return the table's column name and type pairs
+  TableColumns columns() const {
+    TableColumns ret = {
         std::make_tuple(ping_definitions::COLUMN_NAME_HOST,
-                        osquery::TEXT_TYPE,
-                        osquery::ColumnOptions::REQUIRED),
+                        TEXT_TYPE,
+                        ColumnOptions::REQUIRED),
 
         std::make_tuple(ping_definitions::COLUMN_NAME_RESULT,
                         TEXT_TYPE,
@@ -45,86 +705,311 @@ class PingTable : public TablePlugin
 
         std::make_tuple(ping_definitions::COLUMN_NAME_IP_ADDRESS,
                         TEXT_TYPE,
+                        ColumnOptions::DEFAULT)
+    };
+
+    for (const auto& column_name : {ping_definitions::COLUMN_NAME_ADDRESS_FAMILY,
+                                    ping_definitions::COLUMN_NAME_TRANSMITTED,
+                                    ping_definitions::COLUMN_NAME_RECEIVED}) {
+      ret.push_back(std::make_tuple(column_name,
+                                    INTEGER_TYPE,
+                                    ColumnOptions::DEFAULT));
+    }
+
+    ret.push_back(std::make_tuple(ping_definitions::COLUMN_NAME_PACKET_LOSS,
+                                  DOUBLE_TYPE,
+                                  ColumnOptions::DEFAULT));
+
+    for (const auto& column_name : {ping_definitions::COLUMN_NAME_MIN_US,
+                                    ping_definitions::COLUMN_NAME_AVG_US,
+                                    ping_definitions::COLUMN_NAME_MAX_US,
+                                    ping_definitions::COLUMN_NAME_STDDEV_US,
+                                    ping_definitions::COLUMN_NAME_JITTER_US}) {
+      ret.push_back(std::make_tuple(column_name,
+                                    UNSIGNED_BIGINT_TYPE,
+                                    ColumnOptions::DEFAULT));
+    }
+
+    add_ping_option_columns(ret);
+    return ret;
+  }
+
+
+  //It generates one summary row per requested host
+  TableRows generate(QueryContext& request) 
+  {
+    TableRows results;
+
+    auto hosts = request.constraints[ping_definitions::COLUMN_NAME_HOST].getAll(osquery::EQUALS); 
+
+    try {
+      std::vector<std::string> target_hosts(hosts.begin(), hosts.end());
+      utils::ping::ping_statistics_data_collection result_statistics_data;
+      utils::ping::ping_request_options options;
+
+      if ((get_ping_request_options(request, options)) &&
+          (utils::send_icmp_ping_to_targets(target_hosts, options, result_statistics_data))) {
+
+        for (const auto& statistics_data : result_statistics_data) {
+          const auto& statistics = statistics_data.statistics;
+          auto new_row = make_table_row();
+          new_row[ping_definitions::COLUMN_NAME_HOST] =
+              statistics_data.target_hostname;
+          new_row[ping_definitions::COLUMN_NAME_ADDRESS_FAMILY] =
+              INTEGER(statistics_data.address_family);
+
+          if (!statistics_data.target_found) {
+            new_row[ping_definitions::COLUMN_NAME_RESULT] =
+                "Target host was not found";
+          } else if (statistics.get_nr_of_transmitted() > 0) {
+            new_row[ping_definitions::COLUMN_NAME_RESULT] =
+                (statistics.get_nr_of_received() > 0) ? "Success" : "There was a timeout waiting for response from target host";
+            new_row[ping_definitions::COLUMN_NAME_IP_ADDRESS] =
+                statistics_data.response_address;
+            new_row[ping_definitions::COLUMN_NAME_TRANSMITTED] =
+                INTEGER(statistics.get_nr_of_transmitted());
+            new_row[ping_definitions::COLUMN_NAME_RECEIVED] =
+                INTEGER(statistics.get_nr_of_received());
+            new_row[ping_definitions::COLUMN_NAME_PACKET_LOSS] =
+                DOUBLE(statistics.get_packet_loss());
+
+            if (statistics.get_nr_of_received() > 0) {
+              new_row[ping_definitions::COLUMN_NAME_MIN_US] =
+                  UNSIGNED_BIGINT(statistics.get_min().count());
+              new_row[ping_definitions::COLUMN_NAME_AVG_US] =
+                  UNSIGNED_BIGINT(statistics.get_avg().count());
+              new_row[ping_definitions::COLUMN_NAME_MAX_US] =
+                  UNSIGNED_BIGINT(statistics.get_max().count());
+              new_row[ping_definitions::COLUMN_NAME_STDDEV_US] =
+                  UNSIGNED_BIGINT(statistics.get_stddev().count());
+              new_row[ping_definitions::COLUMN_NAME_JITTER_US] =
+                  UNSIGNED_BIGINT(statistics.get_jitter().count());
+            }
+          } else {
+            //no echo could be sent, so there is nothing to report
+            continue;
+          }
+
+          fill_ping_options_row(options, new_row);
+          results.push_back(std::move(new_row));
+        }
+      }
+    } 
+    catch (std::exception& error) 
+    {
+      LOG(WARNING) << "There was a problem running ping request: " << error.what();
+    }
+
+    return results;
+  }
+};
+
+
+//Table reading round trip time percentiles out of the latency histograms every engine keeps feeding,
+//no packets are sent on queries
+//Like `SELECT * FROM ping_quantiles WHERE host = 'x' AND window_s = 3600 AND quantile IN (0.5, 0.99);`
+class PingQuantilesTable : public TablePlugin 
+{
+ private:
+
+  // It return the table's column name and type pairs
+  TableColumns columns() const {
+    return {
+        std::make_tuple(ping_definitions::COLUMN_NAME_HOST,
+                        TEXT_TYPE,
+                        ColumnOptions::INDEX),
+
+        std::make_tuple(ping_definitions::COLUMN_NAME_WINDOW_S,
+                        BIGINT_TYPE,
                         ColumnOptions::DEFAULT),
 
-        std::make_tuple(ping_definitions::COLUMN_NAME_SEQUENCE_NUMBER,
-                        INTEGER_TYPE,
+        std::make_tuple(ping_definitions::COLUMN_NAME_QUANTILE,
+                        DOUBLE_TYPE,
                         ColumnOptions::DEFAULT),
 
-        std::make_tuple(ping_definitions::COLUMN_NAME_TIME_TO_LIVE,
-                        INTEGER_TYPE,
+        std::make_tuple(ping_definitions::COLUMN_NAME_LATENCY_US,
+                        UNSIGNED_BIGINT_TYPE,
                         ColumnOptions::DEFAULT),
 
-        std::make_tuple(ping_definitions::COLUMN_NAME_LATENCY,
+        std::make_tuple(ping_definitions::COLUMN_NAME_SAMPLES,
                         UNSIGNED_BIGINT_TYPE,
                         ColumnOptions::DEFAULT)
     };
   }
 
 
-  //It generates a complete table representation
+  //It generates one row per host, window and quantile
+  //Missing windows default to the longest one and missing quantiles to p50, p90, p99 and p99.9
   TableRows generate(QueryContext& request) 
   {
     TableRows results;
-    size_t default_number_of_ping_requests = 1;
-
-    auto hosts = request.constraints[ping_definitions::COLUMN_NAME_HOST].getAll(osquery::EQUALS); 
 
     try {
-      for (const auto& target_host : hosts) {
-        utils::ping::ping_response_data_collection result_ping_data;
-
-        //Sending the actual ping request
-        if ((utils::send_icmp_ping_to_target(target_host, default_number_of_ping_requests, result_ping_data) &&
-            (!result_ping_data.empty()))) {
-
-          //Parsing the ping response data
-          for (const auto& ping_data : result_ping_data) {
-            auto new_row = make_table_row();
-            
-            if (ping_data.type == ping_data.TARGET_HOST_NOT_FOUND) { //Checking if this is a host not found scenario
-              new_row[ping_definitions::COLUMN_NAME_HOST] = 
-                  ping_data.target_hostname;
-              new_row[ping_definitions::COLUMN_NAME_RESULT] =
-                  "Target host was not found";
-              results.push_back(std::move(new_row));
-
-
-            } else if (ping_data.type == ping_data.TIMEOUT) { //Checking if this is a timeout scenario
-              new_row[ping_definitions::COLUMN_NAME_HOST] = 
-                  ping_data.target_hostname;
-              new_row[ping_definitions::COLUMN_NAME_RESULT] =
-                  "There was a timeout waiting for response from target host";
-              new_row[ping_definitions::COLUMN_NAME_IP_ADDRESS] = 
-                  ping_data.response_address;
-              results.push_back(std::move(new_row));
-
-            } else if (ping_data.type == ping_data.REPLY_DATA) { //Checking if this is a new data scenario
-              new_row[ping_definitions::COLUMN_NAME_HOST] =
-                  ping_data.target_hostname;
-              new_row[ping_definitions::COLUMN_NAME_RESULT] = 
-                  "Success";
-              new_row[ping_definitions::COLUMN_NAME_IP_ADDRESS] =
-                  INTEGER(ping_data.response_address);
-              new_row[ping_definitions::COLUMN_NAME_SEQUENCE_NUMBER] =
-                  INTEGER(ping_data.sequence_number);
-              new_row[ping_definitions::COLUMN_NAME_TIME_TO_LIVE] =
-                  INTEGER(ping_data.time_to_live);
-              new_row[ping_definitions::COLUMN_NAME_LATENCY] =
-                  UNSIGNED_BIGINT(ping_data.round_trip_time);
-              results.push_back(std::move(new_row));
+      auto& tracker = utils::get_latency_tracker();
+      auto hosts = request.constraints[ping_definitions::COLUMN_NAME_HOST].getAll(osquery::EQUALS);
+      auto windows = request.constraints[ping_definitions::COLUMN_NAME_WINDOW_S].getAll<long long>(osquery::EQUALS);
+      auto quantiles = request.constraints[ping_definitions::COLUMN_NAME_QUANTILE].getAll<double>(osquery::EQUALS);
+
+      std::vector<std::string> target_hosts(hosts.begin(), hosts.end());
+      if (target_hosts.empty()) {
+        tracker.get_target_hosts(target_hosts);
+      }
+
+      if (windows.empty()) {
+        windows.insert(tracker.get_max_window().count());
+      }
+
+      if (quantiles.empty()) {
+        quantiles.insert(std::begin(ping_definitions::DEFAULT_QUANTILES), std::end(ping_definitions::DEFAULT_QUANTILES));
+      }
+
+      utils::ping::latency_histogram histogram;
+      for (const auto& target_host : target_hosts) {
+        for (const auto& window : windows) {
+          if ((window > 0) &&
+              (tracker.get_histogram(target_host, std::chrono::seconds(window), histogram)) &&
+              (histogram.get_nr_of_samples() > 0)) {
+            for (const auto& quantile : quantiles) {
+              if ((quantile >= 0.0) && (quantile <= 1.0)) {
+                auto new_row = make_table_row();
+                new_row[ping_definitions::COLUMN_NAME_HOST] = target_host;
+                new_row[ping_definitions::COLUMN_NAME_WINDOW_S] = BIGINT(window);
+                new_row[ping_definitions::COLUMN_NAME_QUANTILE] = DOUBLE(quantile);
+                new_row[ping_definitions::COLUMN_NAME_LATENCY_US] =
+                    UNSIGNED_BIGINT(histogram.get_quantile(quantile).count());
+                new_row[ping_definitions::COLUMN_NAME_SAMPLES] =
+                    UNSIGNED_BIGINT(histogram.get_nr_of_samples());
+                results.push_back(std::move(new_row));
+              }
             }
           }
         }
       }
-    } 
+    }
     catch (std::exception& error) 
     {
-      LOG(WARNING) << "There was a problem running ping request: " << error.what();
+      LOG(WARNING) << "There was a problem reading ping latency quantiles: " << error.what();
+    }
+
+    return results;
+  }
+};
+
+
+//Table reading the hot path metrics of both ICMP ping engines, no packets are sent on queries
+//Counters come as one row each, stages as one row each with their time percentiles, and errors
+//as one row per place and error code
+//Like `SELECT name, count, p99_us FROM ping_engine_metrics WHERE engine = 'query' AND type = 'stage';`
+class PingEngineMetricsTable : public TablePlugin 
+{
+ private:
+
+  // It return the table's column name and type pairs
+  TableColumns columns() const {
+    TableColumns ret;
+
+    for (const auto& column_name : {ping_definitions::COLUMN_NAME_ENGINE,
+                                    ping_definitions::COLUMN_NAME_TYPE,
+                                    ping_definitions::COLUMN_NAME_NAME}) {
+      ret.push_back(std::make_tuple(column_name,
+                                    TEXT_TYPE,
+                                    ColumnOptions::DEFAULT));
+    }
+
+    for (const auto& column_name : {ping_definitions::COLUMN_NAME_COUNT,
+                                    ping_definitions::COLUMN_NAME_TOTAL_US,
+                                    ping_definitions::COLUMN_NAME_P50_US,
+                                    ping_definitions::COLUMN_NAME_P90_US,
+                                    ping_definitions::COLUMN_NAME_P99_US,
+                                    ping_definitions::COLUMN_NAME_MAX_US}) {
+      ret.push_back(std::make_tuple(column_name,
+                                    UNSIGNED_BIGINT_TYPE,
+                                    ColumnOptions::DEFAULT));
+    }
+
+    ret.push_back(std::make_tuple(ping_definitions::COLUMN_NAME_ERROR_CODE,
+                                  INTEGER_TYPE,
+                                  ColumnOptions::DEFAULT));
+
+    for (const auto& column_name : {ping_definitions::COLUMN_NAME_ERROR_CATEGORY,
+                                    ping_definitions::COLUMN_NAME_ERROR_MESSAGE}) {
+      ret.push_back(std::make_tuple(column_name,
+                                    TEXT_TYPE,
+                                    ColumnOptions::DEFAULT));
+    }
+
+    return ret;
+  }
+
+
+  //It generates the metric rows of both engines
+  TableRows generate(QueryContext& /*request*/) 
+  {
+    TableRows results;
+
+    try {
+      utils::ping::engine_metrics::metrics_data metrics;
+      utils::get_icmp_ping_engine().get_engine_metrics(metrics);
+      fill_engine_rows(ping_definitions::ENGINE_NAME_QUERY, metrics, results);
+
+      utils::get_ping_scheduler().get_engine().get_engine_metrics().get_metrics(metrics);
+      fill_engine_rows(ping_definitions::ENGINE_NAME_BACKGROUND, metrics, results);
+    }
+    catch (std::exception& error) 
+    {
+      LOG(WARNING) << "There was a problem reading ping engine metrics: " << error.what();
     }
 
     return results;
   }
+
+
+  //It adds the rows of the given engine metrics
+  static void fill_engine_rows(const char* engine_name, const utils::ping::engine_metrics::metrics_data& metrics, TableRows& results)
+  {
+    using utils::ping::engine_metrics;
+
+    for (size_t counter = 0; counter < engine_metrics::NR_OF_COUNTERS; ++counter) {
+      auto new_row = make_table_row();
+      new_row[ping_definitions::COLUMN_NAME_ENGINE] = engine_name;
+      new_row[ping_definitions::COLUMN_NAME_TYPE] = ping_definitions::METRIC_TYPE_COUNTER;
+      new_row[ping_definitions::COLUMN_NAME_NAME] =
+          engine_metrics::get_counter_name(static_cast<engine_metrics::COUNTER_TYPE>(counter));
+      new_row[ping_definitions::COLUMN_NAME_COUNT] = UNSIGNED_BIGINT(metrics.counters[counter]);
+      results.push_back(std::move(new_row));
+    }
+
+    for (size_t stage = 0; stage < engine_metrics::NR_OF_STAGES; ++stage) {
+      const auto& histogram = metrics.stage_histograms[stage];
+      auto new_row = make_table_row();
+      new_row[ping_definitions::COLUMN_NAME_ENGINE] = engine_name;
+      new_row[ping_definitions::COLUMN_NAME_TYPE] = ping_definitions::METRIC_TYPE_STAGE;
+      new_row[ping_definitions::COLUMN_NAME_NAME] =
+          engine_metrics::get_stage_name(static_cast<engine_metrics::STAGE_TYPE>(stage));
+      new_row[ping_definitions::COLUMN_NAME_COUNT] = UNSIGNED_BIGINT(histogram.get_nr_of_samples());
+      new_row[ping_definitions::COLUMN_NAME_TOTAL_US] = UNSIGNED_BIGINT(metrics.stage_total_times[stage].count());
+
+      if (histogram.get_nr_of_samples() > 0) {
+        new_row[ping_definitions::COLUMN_NAME_P50_US] = UNSIGNED_BIGINT(histogram.get_quantile(0.5).count());
+        new_row[ping_definitions::COLUMN_NAME_P90_US] = UNSIGNED_BIGINT(histogram.get_quantile(0.9).count());
+        new_row[ping_definitions::COLUMN_NAME_P99_US] = UNSIGNED_BIGINT(histogram.get_quantile(0.99).count());
+        new_row[ping_definitions::COLUMN_NAME_MAX_US] = UNSIGNED_BIGINT(histogram.get_quantile(1.0).count());
+      }
+      results.push_back(std::move(new_row));
+    }
+
+    for (const auto& error : metrics.errors) {
+      auto new_row = make_table_row();
+      new_row[ping_definitions::COLUMN_NAME_ENGINE] = engine_name;
+      new_row[ping_definitions::COLUMN_NAME_TYPE] = ping_definitions::METRIC_TYPE_ERROR;
+      new_row[ping_definitions::COLUMN_NAME_NAME] = engine_metrics::get_error_source_name(error.source);
+      new_row[ping_definitions::COLUMN_NAME_COUNT] = UNSIGNED_BIGINT(error.count);
+      new_row[ping_definitions::COLUMN_NAME_ERROR_CODE] = INTEGER(error.value);
+      new_row[ping_definitions::COLUMN_NAME_ERROR_CATEGORY] = error.category;
+      new_row[ping_definitions::COLUMN_NAME_ERROR_MESSAGE] = error.message;
+      results.push_back(std::move(new_row));
+    }
+  }
 };
 
 //Extension registration
@@ -132,12 +1017,95 @@ REGISTER_EXTERNAL(PingTable,
                   ping_definitions::REGISTRY_NAME,
                   ping_definitions::EXTENSION_NAME);
 
+REGISTER_EXTERNAL(PingCacheTable,
+                  ping_definitions::REGISTRY_NAME,
+                  ping_definitions::PING_CACHE_TABLE_NAME);
+
+REGISTER_EXTERNAL(PingHistoryTable,
+                  ping_definitions::REGISTRY_NAME,
+                  ping_definitions::PING_HISTORY_TABLE_NAME);
+
+REGISTER_EXTERNAL(PingChangesTable,
+                  ping_definitions::REGISTRY_NAME,
+                  ping_definitions::PING_CHANGES_TABLE_NAME);
+
+REGISTER_EXTERNAL(PingStatsTable,
+                  ping_definitions::REGISTRY_NAME,
+                  ping_definitions::PING_STATS_TABLE_NAME);
+
+REGISTER_EXTERNAL(PingQuantilesTable,
+                  ping_definitions::REGISTRY_NAME,
+                  ping_definitions::PING_QUANTILES_TABLE_NAME);
+
+REGISTER_EXTERNAL(PingEngineMetricsTable,
+                  ping_definitions::REGISTRY_NAME,
+                  ping_definitions::PING_ENGINE_METRICS_TABLE_NAME);
+
+//It applies the extension flags to the given ICMP ping engine
+static void configure_ping_engine(utils::ping::icmp_v4_ping_executor& engine)
+{
+  //Per host timeouts are derived from the measured round trip times, within these limits
+  if (!engine.get_rtt_estimator().set_timeout_limits(
+          std::chrono::milliseconds(FLAGS_ping_min_timeout_ms),
+          std::chrono::milliseconds(FLAGS_ping_max_timeout_ms),
+          std::chrono::milliseconds(FLAGS_ping_initial_timeout_ms))) {
+    LOG(WARNING) << "Invalid ping timeout limits, using the default ones";
+  }
+
+  //Datagram ping sockets do not need root, raw ones are the fallback
+  if (FLAGS_ping_socket_type == "datagram") {
+    engine.set_socket_type(utils::ping::icmp_v4_ping_executor::DATAGRAM_SOCKET);
+  } else if (FLAGS_ping_socket_type == "raw") {
+    engine.set_socket_type(utils::ping::icmp_v4_ping_executor::RAW_SOCKET);
+  } else if (FLAGS_ping_socket_type != "auto") {
+    LOG(WARNING) << "Invalid ping socket type " << FLAGS_ping_socket_type << ", using auto";
+  }
+}
+
 int main(int argc, char* argv[]) 
 {
   int ret = EXIT_FAILURE;
 
   osquery::Initializer runner(argc, argv, ToolType::EXTENSION);
 
+  //Query shards are set up before anything else touches them, each one of them is configured on its own
+  if (!utils::get_icmp_ping_engine().set_nr_of_shards(FLAGS_ping_engine_shards, FLAGS_ping_engine_pin_cores)) {
+    LOG(WARNING) << "Invalid number of ping engine shards " << FLAGS_ping_engine_shards << ", using "
+                 << utils::get_icmp_ping_engine().get_nr_of_shards();
+  }
+  for (size_t shard_index = 0; shard_index < utils::get_icmp_ping_engine().get_nr_of_shards(); ++shard_index) {
+    configure_ping_engine(utils::get_icmp_ping_engine().get_shard(shard_index));
+  }
+  configure_ping_engine(utils::get_ping_scheduler().get_engine());
+
+  //Both engines share the same pacer, so their requests add up against the same limits
+  if (!utils::get_send_pacer().set_send_rate(FLAGS_ping_max_send_rate, FLAGS_ping_send_burst)) {
+    LOG(WARNING) << "Invalid ping send rate, using the default one";
+  }
+  if (!utils::get_send_pacer().set_subnet_send_rate(FLAGS_ping_max_subnet_send_rate, FLAGS_ping_subnet_send_burst)) {
+    LOG(WARNING) << "Invalid ping subnet send rate, using the default one";
+  }
+
+  //Queries with no address_family constraint ping on the flag one
+  if (!get_address_family(FLAGS_ping_address_family, default_address_family)) {
+    LOG(WARNING) << "Invalid ping address family " << FLAGS_ping_address_family << ", using ipv4";
+  }
+
+  //Latency histograms are shared by both engines too
+  if (!utils::get_latency_tracker().set_slots(std::chrono::seconds(FLAGS_ping_histogram_slot_s), FLAGS_ping_histogram_slots)) {
+    LOG(WARNING) << "Invalid ping histogram slots, using the default ones";
+  }
+
+  //Background probing only runs when there is something to probe
+  if (!FLAGS_ping_cache_targets.empty()) {
+    utils::get_ping_scheduler().set_history_size(FLAGS_ping_cache_history_size);
+    if (!utils::get_ping_scheduler().add_targets(FLAGS_ping_cache_targets,
+                                                 std::chrono::milliseconds(FLAGS_ping_cache_interval_ms))) {
+      LOG(WARNING) << "Some ping cache targets are not valid, they will not be probed";
+    }
+    utils::get_ping_scheduler().start();
+  }
+
   auto status = startExtension(ping_definitions::EXTENSION_NAME,
                                ping_definitions::EXTENSION_VERSION);
 
@@ -147,6 +1115,7 @@ int main(int argc, char* argv[])
     runner.waitForShutdown();
 
     //ant then ask to shut it down
+    utils::get_ping_scheduler().stop();
     ret = runner.shutdown(0);
 
   } else {
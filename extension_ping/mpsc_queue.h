@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace utils
+{
+    namespace ping
+    {
+        //Lock-free multiple producer, single consumer queue
+        //Producers push onto an atomic list head through a CAS loop, so pushing never blocks nor waits
+        //on the consumer, and the consumer takes the whole list at once with a single exchange
+        //The list is kept newest first, so the consumer reverses it to hand the items over in push order,
+        //items pushed by the same producer always come out in the order they went in
+        //Nodes are only touched by their producer until they are published, and then only by the consumer,
+        //so there is no ABA problem and no need for hazard pointers
+        template <typename T>
+        class mpsc_queue
+        {
+        public:
+            mpsc_queue() : m_head(nullptr) {}
+            ~mpsc_queue() { consume_all([](T&) {}); }
+
+            mpsc_queue(const mpsc_queue&) = delete;
+            mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+            //It adds the given item, it can be called from any thread
+            //It returns true when the queue was empty, so only the first push after a consume has to wake the consumer up
+            bool push(T&& value)
+            {
+                queue_node* new_node = new queue_node(std::move(value));
+
+                queue_node* current_head = m_head.load(std::memory_order_relaxed);
+                do
+                {
+                    new_node->next = current_head;
+                } while (!m_head.compare_exchange_weak(current_head, new_node, std::memory_order_release, std::memory_order_relaxed));
+
+                return (current_head == nullptr);
+            }
+
+            //It hands every queued item over to the given callback in push order, it can only be called from the consumer thread
+            //It returns the number of items consumed
+            template <typename Callback>
+            size_t consume_all(Callback&& on_item)
+            {
+                size_t ret = 0;
+
+                //reversing the taken list so items come out in push order
+                queue_node* taken_nodes = m_head.exchange(nullptr, std::memory_order_acquire);
+                queue_node* ordered_nodes = nullptr;
+                while (taken_nodes)
+                {
+                    queue_node* next_node = taken_nodes->next;
+                    taken_nodes->next = ordered_nodes;
+                    ordered_nodes = taken_nodes;
+                    taken_nodes = next_node;
+                }
+
+                while (ordered_nodes)
+                {
+                    queue_node* next_node = ordered_nodes->next;
+                    on_item(ordered_nodes->value);
+                    delete ordered_nodes;
+                    ordered_nodes = next_node;
+                    ++ret;
+                }
+
+                return ret;
+            }
+
+            //Check if there is nothing queued, it is only a hint when producers are pushing
+            bool empty() const
+            {
+                return (m_head.load(std::memory_order_acquire) == nullptr);
+            }
+
+        private:
+            typedef struct queue_node_unit
+            {
+                explicit queue_node_unit(T&& new_value) :
+                    value(std::move(new_value)),
+                    next(nullptr) {}
+
+                T value;
+                queue_node_unit* next;
+            } queue_node;
+
+            //member vars
+            std::atomic<queue_node*> m_head;
+        };
+    }
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include "ping_result_pool.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It returns the ID of the given hostname, hostnames seen for the first time get the next one
+		uint32_t ping_result_pool::intern_hostname(const std::string& hostname)
+		{
+			auto host_it = m_host_ids.emplace(hostname, static_cast<uint32_t>(m_hostnames.size()));
+			if (host_it.second)
+			{
+				//map nodes never move, so the stored key can be handed out by its ID
+				m_hostnames.push_back(&host_it.first->first);
+			}
+
+			return host_it.first->second;
+		}
+
+		//It returns the hostname interned with the given ID, or an empty one if there is no such ID
+		const std::string& ping_result_pool::get_hostname(const uint32_t host_id) const
+		{
+			static const std::string empty_hostname;
+
+			return (host_id < m_hostnames.size()) ? *m_hostnames[host_id] : empty_hostname;
+		}
+
+		//It returns the number of hostnames interned so far
+		size_t ping_result_pool::get_nr_of_hostnames() const
+		{
+			return m_hostnames.size();
+		}
+
+		//It appends the given record, its host ID has to come from this pool
+		void ping_result_pool::add_record(const ping_result_record& record)
+		{
+			m_records.push_back(record);
+		}
+
+		//It makes room for the given number of records, so filling the pool does not reallocate on the way
+		void ping_result_pool::reserve(const size_t nr_of_records)
+		{
+			m_records.reserve(nr_of_records);
+		}
+
+		//It returns every record, in the order they were added
+		const std::vector<ping_result_record>& ping_result_pool::get_records() const
+		{
+			return m_records;
+		}
+
+		//It returns the number of records
+		size_t ping_result_pool::size() const
+		{
+			return m_records.size();
+		}
+
+		//Check if there are no records
+		bool ping_result_pool::empty() const
+		{
+			return m_records.empty();
+		}
+
+		//It forgets about every record and hostname, the record buffer is kept for the next query
+		void ping_result_pool::clear()
+		{
+			m_records.clear();
+			m_hostnames.clear();
+			m_host_ids.clear();
+		}
+
+		//It stores the given address on the given record in binary form
+		void ping_result_pool::set_response_address(const boost::asio::ip::address& address, ping_result_record& record)
+		{
+			if (address.is_v6())
+			{
+				boost::asio::ip::address_v6 address_v6 = address.to_v6();
+				boost::asio::ip::address_v6::bytes_type address_bytes = address_v6.to_bytes();
+				std::copy(address_bytes.begin(), address_bytes.end(), record.response_address.begin());
+				record.response_address_size = static_cast<uint8_t>(address_bytes.size());
+				record.response_scope_id = static_cast<uint32_t>(address_v6.scope_id());
+			}
+			else
+			{
+				boost::asio::ip::address_v4::bytes_type address_bytes = address.to_v4().to_bytes();
+				std::copy(address_bytes.begin(), address_bytes.end(), record.response_address.begin());
+				record.response_address_size = static_cast<uint8_t>(address_bytes.size());
+				record.response_scope_id = 0;
+			}
+		}
+
+		//It returns the response address of the given record, or an unspecified one if it has none
+		boost::asio::ip::address ping_result_pool::get_response_address(const ping_result_record& record)
+		{
+			boost::asio::ip::address ret;
+
+			if (record.response_address_size == sizeof(boost::asio::ip::address_v6::bytes_type))
+			{
+				boost::asio::ip::address_v6::bytes_type address_bytes;
+				std::copy(record.response_address.begin(), record.response_address.begin() + address_bytes.size(), address_bytes.begin());
+				ret = boost::asio::ip::address_v6(address_bytes, record.response_scope_id);
+			}
+			else if (record.response_address_size == sizeof(boost::asio::ip::address_v4::bytes_type))
+			{
+				boost::asio::ip::address_v4::bytes_type address_bytes;
+				std::copy(record.response_address.begin(), record.response_address.begin() + address_bytes.size(), address_bytes.begin());
+				ret = boost::asio::ip::address_v4(address_bytes);
+			}
+
+			return ret;
+		}
+
+		//It returns the response address of the given record as text, or an empty one if it has none
+		std::string ping_result_pool::get_response_address_text(const ping_result_record& record)
+		{
+			std::string ret;
+
+			if (record.has_response_address())
+			{
+				ret = get_response_address(record).to_string();
+			}
+
+			return ret;
+		}
+	}
+}
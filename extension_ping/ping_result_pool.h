@@ -0,0 +1,99 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace utils
+{
+    namespace ping
+    {
+        //compact result of a single ICMP echo request
+        //It is trivially copyable, so results move around as plain bytes with no allocation, the target host is
+        //the ID it got on the result pool of its query and the response address is kept in binary form
+        //Both only turn into text once, when the result is emitted
+        typedef struct ping_result_record_unit
+        {
+            //Some magic data
+            static constexpr size_t MAX_ADDRESS_SIZE = 16;
+
+            ping_result_record_unit()
+            {
+                clear();
+            }
+
+            void clear()
+            {
+                round_trip_time_us = 0;
+                host_id = 0;
+                response_scope_id = 0;
+                packet_identifier = 0;
+                sequence_number = 0;
+                type = 0;
+                address_family = 0;
+                time_to_live = 0;
+                response_address_size = 0;
+                ready = false;
+                valid_checksum = false;
+                response_address.fill(0);
+            }
+
+            bool is_ready() const { return ready; }
+            bool has_response_address() const { return (response_address_size > 0); }
+
+            uint64_t round_trip_time_us;
+            uint32_t host_id;
+            uint32_t response_scope_id;
+            uint16_t packet_identifier;
+            uint16_t sequence_number;
+            uint8_t type;  //one of ping_response_data::RESPONSE_TYPE
+            uint8_t address_family;
+            uint8_t time_to_live;
+            uint8_t response_address_size;
+            bool ready;
+            bool valid_checksum;
+            std::array<unsigned char, MAX_ADDRESS_SIZE> response_address;
+
+        } ping_result_record;
+
+        static_assert(std::is_trivially_copyable<ping_result_record>::value, "Result records have to be trivially copyable");
+
+        //Per query pool of compact results
+        //Records are kept back to back on a single growing buffer, and every target hostname is stored only once,
+        //records refer to it through the ID it was interned with
+        //A pool belongs to one query at a time, it is not thread safe
+        class ping_result_pool
+        {
+        public:
+            ping_result_pool() {}
+
+            ping_result_pool(const ping_result_pool&) = delete;
+            ping_result_pool& operator=(const ping_result_pool&) = delete;
+            ping_result_pool(ping_result_pool&&) = default;
+            ping_result_pool& operator=(ping_result_pool&&) = default;
+
+            uint32_t intern_hostname(const std::string& hostname);
+            const std::string& get_hostname(const uint32_t host_id) const;
+            size_t get_nr_of_hostnames() const;
+            void add_record(const ping_result_record& record);
+            void reserve(const size_t nr_of_records);
+            const std::vector<ping_result_record>& get_records() const;
+            size_t size() const;
+            bool empty() const;
+            void clear();
+            static void set_response_address(const boost::asio::ip::address& address, ping_result_record& record);
+            static boost::asio::ip::address get_response_address(const ping_result_record& record);
+            static std::string get_response_address_text(const ping_result_record& record);
+
+        private:
+            //member vars
+            std::unordered_map<std::string, uint32_t> m_host_ids;
+            std::vector<const std::string*> m_hostnames;
+            std::vector<ping_result_record> m_records;
+        };
+    }
+}
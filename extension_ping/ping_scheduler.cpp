@@ -0,0 +1,283 @@
+#include <sstream>
+#include "ping_scheduler.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It adds a target host to probe on the given interval, or changes the interval of a known one
+		bool ping_scheduler::add_target(const std::string& target_host, const chrono::milliseconds& interval)
+		{
+			bool ret = false;
+
+			//defense programming sanity check
+			if ((!target_host.empty()) &&
+				(interval > chrono::milliseconds::zero()))
+			{
+				std::lock_guard<std::mutex> guard(m_scheduler_mutex);
+
+				scheduled_target& target = m_targets[target_host];
+				target.interval = interval;
+				target.next_probe_time = chrono::steady_clock::now();
+				ret = true;
+			}
+
+			//new target hosts get probed right away
+			m_scheduler_event.notify_all();
+
+			return ret;
+		}
+
+		//It adds a comma separated list of target hosts, each one optionally followed by @<interval in ms>
+		//Like "10.0.0.1@1000,www.google.com@30000,8.8.8.8", target hosts with no interval get the default one
+		bool ping_scheduler::add_targets(const std::string& target_list, const chrono::milliseconds& default_interval)
+		{
+			bool ret = true;
+
+			std::istringstream target_stream(target_list);
+			std::string target_entry;
+			while (std::getline(target_stream, target_entry, TARGET_SEPARATOR))
+			{
+				if (target_entry.empty())
+				{
+					continue;
+				}
+
+				std::string target_host = target_entry;
+				chrono::milliseconds interval = default_interval;
+
+				size_t separator_position = target_entry.find(INTERVAL_SEPARATOR);
+				if (separator_position != std::string::npos)
+				{
+					target_host = target_entry.substr(0, separator_position);
+
+					try
+					{
+						interval = chrono::milliseconds(std::stoul(target_entry.substr(separator_position + 1)));
+					}
+					catch (const std::exception&)
+					{
+						interval = chrono::milliseconds::zero();
+					}
+				}
+
+				if (!add_target(target_host, interval))
+				{
+					ret = false;
+				}
+			}
+
+			return ret;
+		}
+
+		//It stops probing the given target host and drops its samples
+		bool ping_scheduler::remove_target(const std::string& target_host)
+		{
+			std::lock_guard<std::mutex> guard(m_scheduler_mutex);
+
+			return (m_targets.erase(target_host) > 0);
+		}
+
+		//It stops probing every target host and drops their samples
+		void ping_scheduler::clear_targets()
+		{
+			std::lock_guard<std::mutex> guard(m_scheduler_mutex);
+
+			m_targets.clear();
+		}
+
+		//It changes the number of samples kept per target host, current samples are dropped
+		void ping_scheduler::set_history_size(const size_t history_size)
+		{
+			std::lock_guard<std::mutex> guard(m_scheduler_mutex);
+
+			if (history_size > 0)
+			{
+				m_history_size = history_size;
+
+				for (auto& target : m_targets)
+				{
+					target.second.samples.clear();
+					target.second.next_sample_index = 0;
+					target.second.nr_of_samples = 0;
+				}
+			}
+		}
+
+		//It starts the background probing thread
+		bool ping_scheduler::start()
+		{
+			bool ret = false;
+
+			std::lock_guard<std::mutex> guard(m_scheduler_mutex);
+
+			if (!m_scheduler_thread.joinable())
+			{
+				m_stop_requested = false;
+				m_scheduler_thread = std::thread(&ping_scheduler::run, this);
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It stops the background probing thread, samples are kept
+		//An ongoing probe round is not interrupted, so this waits for it to finish
+		void ping_scheduler::stop()
+		{
+			{
+				std::lock_guard<std::mutex> guard(m_scheduler_mutex);
+				m_stop_requested = true;
+			}
+
+			m_scheduler_event.notify_all();
+
+			if (m_scheduler_thread.joinable())
+			{
+				m_scheduler_thread.join();
+			}
+		}
+
+		bool ping_scheduler::is_running()
+		{
+			std::lock_guard<std::mutex> guard(m_scheduler_mutex);
+
+			return ((m_scheduler_thread.joinable()) && (!m_stop_requested));
+		}
+
+		//It copies the samples of the given target hosts, or of every target host if none is given
+		//Samples of each target host go from the oldest to the latest one
+		void ping_scheduler::get_samples(const std::set<std::string>& target_hosts, const bool latest_only, ping_sample_collection& samples)
+		{
+			std::lock_guard<std::mutex> guard(m_scheduler_mutex);
+
+			if (target_hosts.empty())
+			{
+				for (const auto& target : m_targets)
+				{
+					copy_samples(target.second, latest_only, samples);
+				}
+			}
+			else
+			{
+				for (const auto& target_host : target_hosts)
+				{
+					auto target_it = m_targets.find(target_host);
+					if (target_it != m_targets.end())
+					{
+						copy_samples(target_it->second, latest_only, samples);
+					}
+				}
+			}
+		}
+
+		//It returns the ICMP ping engine used for background probing, so it can be configured
+		icmp_v4_ping_executor& ping_scheduler::get_engine()
+		{
+			return m_pinger;
+		}
+
+		//Background probing loop
+		//Every due target host is probed at once on a single execution, so slow or down hosts do not
+		//delay the others, and then the thread sleeps until the next target host is due
+		void ping_scheduler::run()
+		{
+			std::unique_lock<std::mutex> lock(m_scheduler_mutex);
+
+			while (!m_stop_requested)
+			{
+				chrono::steady_clock::time_point now = chrono::steady_clock::now();
+				chrono::steady_clock::time_point next_probe_time = chrono::steady_clock::time_point::max();
+
+				m_due_targets.clear();
+				for (const auto& target : m_targets)
+				{
+					if (target.second.next_probe_time <= now)
+					{
+						m_due_targets.push_back(target.first);
+					}
+					else
+					{
+						next_probe_time = std::min(next_probe_time, target.second.next_probe_time);
+					}
+				}
+
+				if (m_due_targets.empty())
+				{
+					if (next_probe_time == chrono::steady_clock::time_point::max())
+					{
+						m_scheduler_event.wait(lock);
+					}
+					else
+					{
+						m_scheduler_event.wait_until(lock, next_probe_time);
+					}
+
+					continue;
+				}
+
+				//queries only wait on the lock for the samples copy, never on the network
+				std::chrono::system_clock::time_point probe_time = std::chrono::system_clock::now();
+				m_response_data.clear();
+
+				lock.unlock();
+				m_pinger.execute(m_due_targets, 1, m_response_data);
+				lock.lock();
+
+				now = chrono::steady_clock::now();
+				for (const auto& due_target : m_due_targets)
+				{
+					//target host might have been removed while it was being probed
+					auto target_it = m_targets.find(due_target);
+					if (target_it != m_targets.end())
+					{
+						//a probe round longer than the interval just makes the next one start right away
+						target_it->second.next_probe_time = std::max(target_it->second.next_probe_time + target_it->second.interval, now);
+					}
+				}
+
+				for (const auto& response_data : m_response_data)
+				{
+					auto target_it = m_targets.find(response_data.target_hostname);
+					if (target_it != m_targets.end())
+					{
+						store_sample(target_it->second, probe_time, response_data);
+					}
+				}
+			}
+		}
+
+		//It stores a sample on the ring of the given target host, overwriting the oldest one when full
+		//Scheduler lock should be already held
+		void ping_scheduler::store_sample(scheduled_target& target, const std::chrono::system_clock::time_point& probe_time, const ping_response_data& data)
+		{
+			if (target.samples.size() != m_history_size)
+			{
+				target.samples.resize(m_history_size);
+				target.next_sample_index = 0;
+				target.nr_of_samples = 0;
+			}
+
+			ping_sample& sample = target.samples[target.next_sample_index];
+			sample.probe_time = probe_time;
+			sample.data = data;
+
+			target.next_sample_index = (target.next_sample_index + 1) % m_history_size;
+			target.nr_of_samples = std::min(target.nr_of_samples + 1, m_history_size);
+		}
+
+		//It copies the samples of the given target host, from the oldest to the latest one
+		//Scheduler lock should be already held
+		void ping_scheduler::copy_samples(const scheduled_target& target, const bool latest_only, ping_sample_collection& samples) const
+		{
+			size_t nr_of_samples = (latest_only) ? std::min<size_t>(target.nr_of_samples, 1) : target.nr_of_samples;
+			size_t ring_size = target.samples.size();
+
+			for (size_t it = 0; it < nr_of_samples; ++it)
+			{
+				size_t sample_index = (target.next_sample_index + ring_size - nr_of_samples + it) % ring_size;
+				samples.push_back(target.samples[sample_index]);
+			}
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "icmp_ping_executor.h"
+
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //ping sample data object, a response along with the wall clock time its request went out
+        typedef struct ping_sample_unit
+        {
+            std::chrono::system_clock::time_point probe_time;
+            ping_response_data data;
+        } ping_sample;
+
+        typedef std::vector<ping_sample> ping_sample_collection;
+
+        //Background probing helper class
+        //A dedicated thread keeps probing the configured target hosts, each one on its own interval,
+        //through its own ICMP ping engine, so it never waits on the queries of the ping table
+        //The latest samples of each target host are kept in a bounded ring, queries just copy them out
+        class ping_scheduler
+        {
+        public:
+            //Some magic data
+            static constexpr unsigned int DEFAULT_INTERVAL_IN_MS = 10000;
+            static constexpr size_t DEFAULT_HISTORY_SIZE = 60;
+            static constexpr char TARGET_SEPARATOR = ',';
+            static constexpr char INTERVAL_SEPARATOR = '@';
+
+            explicit ping_scheduler(send_pacer* pacer = nullptr, latency_tracker* tracker = nullptr) :
+                m_history_size(DEFAULT_HISTORY_SIZE),
+                m_stop_requested(false),
+                m_pinger(pacer, tracker) {}
+
+            ~ping_scheduler() { stop(); }
+
+            bool add_target(const std::string& target_host, const chrono::milliseconds& interval);
+            bool add_targets(const std::string& target_list, const chrono::milliseconds& default_interval);
+            bool remove_target(const std::string& target_host);
+            void clear_targets();
+            void set_history_size(const size_t history_size);
+            bool start();
+            void stop();
+            bool is_running();
+            void get_samples(const std::set<std::string>& target_hosts, const bool latest_only, ping_sample_collection& samples);
+            icmp_v4_ping_executor& get_engine();
+
+        private:
+            //per target host state
+            typedef struct scheduled_target_unit
+            {
+                scheduled_target_unit() :
+                    interval(chrono::milliseconds::zero()),
+                    next_sample_index(0),
+                    nr_of_samples(0) {}
+
+                chrono::milliseconds interval;
+                chrono::steady_clock::time_point next_probe_time;
+                size_t next_sample_index;
+                size_t nr_of_samples;
+                ping_sample_collection samples;
+            } scheduled_target;
+
+            typedef std::map<std::string, scheduled_target> scheduled_target_collection;
+
+            //private helper methods
+            void run();
+            void store_sample(scheduled_target& target, const std::chrono::system_clock::time_point& probe_time, const ping_response_data& data);
+            void copy_samples(const scheduled_target& target, const bool latest_only, ping_sample_collection& samples) const;
+
+            //member vars
+            std::mutex m_scheduler_mutex;
+            std::condition_variable m_scheduler_event;
+            std::thread m_scheduler_thread;
+            size_t m_history_size;
+            bool m_stop_requested;
+            scheduled_target_collection m_targets;
+            std::vector<std::string> m_due_targets;
+            ping_response_data_collection m_response_data;
+            icmp_v4_ping_executor m_pinger;
+        };
+    }
+}
@@ -0,0 +1,121 @@
+#include "resolver_cache.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It returns the cached resolution of the given hostname and address family if it did not expire yet
+		bool resolver_cache::lookup(const std::string& hostname, cache_entry& entry, const bool ipv6)
+		{
+			bool ret = false;
+
+			std::lock_guard<std::mutex> guard(m_cache_mutex);
+
+			auto entry_it = m_entries.find(cache_key(hostname, ipv6));
+			if (entry_it != m_entries.end())
+			{
+				if (entry_it->second.expiration_time > chrono::steady_clock::now())
+				{
+					entry = entry_it->second;
+					ret = true;
+				}
+				else
+				{
+					//stale entry, host has to be resolved again
+					m_entries.erase(entry_it);
+				}
+			}
+
+			return ret;
+		}
+
+		//It caches a successful resolution, under the address family of the resolved endpoint
+		void resolver_cache::store_resolved(const std::string& hostname, const icmp::endpoint& resolved_endpoint)
+		{
+			cache_entry new_entry;
+			new_entry.found = true;
+			new_entry.resolved_endpoint = resolved_endpoint;
+
+			std::lock_guard<std::mutex> guard(m_cache_mutex);
+			new_entry.expiration_time = chrono::steady_clock::now() + m_positive_ttl;
+			store_entry(cache_key(hostname, resolved_endpoint.address().is_v6()), new_entry);
+		}
+
+		//It caches a host not found resolution of the given address family
+		void resolver_cache::store_not_found(const std::string& hostname, const bool ipv6)
+		{
+			cache_entry new_entry;
+			new_entry.found = false;
+
+			std::lock_guard<std::mutex> guard(m_cache_mutex);
+			new_entry.expiration_time = chrono::steady_clock::now() + m_negative_ttl;
+			store_entry(cache_key(hostname, ipv6), new_entry);
+		}
+
+		//It changes the time to live of the entries cached from now on
+		void resolver_cache::set_time_to_live(const chrono::seconds& positive_ttl, const chrono::seconds& negative_ttl)
+		{
+			std::lock_guard<std::mutex> guard(m_cache_mutex);
+
+			m_positive_ttl = positive_ttl;
+			m_negative_ttl = negative_ttl;
+		}
+
+		//It drops every cached entry
+		void resolver_cache::clear()
+		{
+			std::lock_guard<std::mutex> guard(m_cache_mutex);
+
+			m_entries.clear();
+		}
+
+		size_t resolver_cache::size()
+		{
+			std::lock_guard<std::mutex> guard(m_cache_mutex);
+
+			return m_entries.size();
+		}
+
+		//It stores an entry, cache lock should be already held
+		void resolver_cache::store_entry(const cache_key& key, const cache_entry& entry)
+		{
+			if ((m_entries.size() >= m_max_nr_of_entries) &&
+				(m_entries.find(key) == m_entries.end()))
+			{
+				make_room();
+			}
+
+			m_entries[key] = entry;
+		}
+
+		//It keeps the cache bounded, expired entries go first and then the ones about to expire
+		void resolver_cache::make_room()
+		{
+			chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+			for (auto entry_it = m_entries.begin(); entry_it != m_entries.end();)
+			{
+				if (entry_it->second.expiration_time <= now)
+				{
+					entry_it = m_entries.erase(entry_it);
+				}
+				else
+				{
+					++entry_it;
+				}
+			}
+
+			if ((!m_entries.empty()) &&
+				(m_entries.size() >= m_max_nr_of_entries))
+			{
+				auto oldest_entry_it = std::min_element(m_entries.begin(), m_entries.end(),
+					[](const std::pair<const cache_key, cache_entry>& first, const std::pair<const cache_key, cache_entry>& second)
+					{
+						return (first.second.expiration_time < second.second.expiration_time);
+					});
+
+				m_entries.erase(oldest_entry_it);
+			}
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <unordered_map>
+
+using boost::asio::ip::icmp;
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Hostname to ICMP endpoint cache shared across executions
+        //Both resolved hosts and not found hosts are cached, each kind with its own time to live
+        //IPV4 and IPV6 resolutions of the same hostname are cached apart, a host might only have one of them
+        class resolver_cache
+        {
+        public:
+            //Some magic data
+            static constexpr unsigned int DEFAULT_POSITIVE_TTL_IN_SECS = 60;
+            static constexpr unsigned int DEFAULT_NEGATIVE_TTL_IN_SECS = 30;
+            static constexpr size_t DEFAULT_MAX_NR_OF_ENTRIES = 4096;
+
+            //cached resolution data object
+            typedef struct cache_entry_unit
+            {
+                cache_entry_unit() : found(false) {}
+
+                bool found;
+                icmp::endpoint resolved_endpoint;
+                chrono::steady_clock::time_point expiration_time;
+            } cache_entry;
+
+            resolver_cache() :
+                m_positive_ttl(chrono::seconds(DEFAULT_POSITIVE_TTL_IN_SECS)),
+                m_negative_ttl(chrono::seconds(DEFAULT_NEGATIVE_TTL_IN_SECS)),
+                m_max_nr_of_entries(DEFAULT_MAX_NR_OF_ENTRIES) {}
+
+            bool lookup(const std::string& hostname, cache_entry& entry, const bool ipv6 = false);
+            void store_resolved(const std::string& hostname, const icmp::endpoint& resolved_endpoint);
+            void store_not_found(const std::string& hostname, const bool ipv6 = false);
+            void set_time_to_live(const chrono::seconds& positive_ttl, const chrono::seconds& negative_ttl);
+            void clear();
+            size_t size();
+
+        private:
+            //(hostname, is IPV6) pairs
+            typedef std::pair<std::string, bool> cache_key;
+
+            struct cache_key_hash
+            {
+                size_t operator()(const cache_key& key) const
+                {
+                    return (std::hash<std::string>()(key.first) ^ static_cast<size_t>(key.second));
+                }
+            };
+
+            //private helper methods
+            void store_entry(const cache_key& key, const cache_entry& entry);
+            void make_room();
+
+            //member vars
+            std::mutex m_cache_mutex;
+            chrono::steady_clock::duration m_positive_ttl;
+            chrono::steady_clock::duration m_negative_ttl;
+            size_t m_max_nr_of_entries;
+            std::unordered_map<cache_key, cache_entry, cache_key_hash> m_entries;
+        };
+    }
+}
@@ -0,0 +1,160 @@
+#include "rtt_estimator.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It returns the time to wait for an ICMP Echo Reply of the given target host
+		//Hosts with no history get the initial timeout
+		chrono::microseconds rtt_estimator::get_timeout(const unsigned long target_address)
+		{
+			chrono::microseconds ret = chrono::microseconds::zero();
+
+			std::lock_guard<std::mutex> guard(m_estimator_mutex);
+
+			auto entry_it = m_entries.find(target_address);
+			if (entry_it != m_entries.end())
+			{
+				ret = clamp_timeout(entry_it->second.timeout);
+			}
+			else
+			{
+				ret = clamp_timeout(m_initial_timeout);
+			}
+
+			return ret;
+		}
+
+		//It returns the current estimation of the given target host, if there is any
+		bool rtt_estimator::lookup(const unsigned long target_address, estimation_entry& entry)
+		{
+			bool ret = false;
+
+			std::lock_guard<std::mutex> guard(m_estimator_mutex);
+
+			auto entry_it = m_entries.find(target_address);
+			if (entry_it != m_entries.end())
+			{
+				entry = entry_it->second;
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It folds a new round trip time measurement into the estimation of the given target host
+		//SRTT = 7/8 SRTT + 1/8 R, RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, timeout = SRTT + 4 RTTVAR
+		void rtt_estimator::store_sample(const unsigned long target_address, const chrono::microseconds& round_trip_time)
+		{
+			std::lock_guard<std::mutex> guard(m_estimator_mutex);
+
+			estimation_entry& entry = get_entry(target_address);
+
+			if (entry.nr_of_samples == 0)
+			{
+				entry.smoothed_rtt = round_trip_time;
+				entry.rtt_variance = round_trip_time / 2;
+			}
+			else
+			{
+				chrono::microseconds rtt_error = (entry.smoothed_rtt > round_trip_time) ?
+					(entry.smoothed_rtt - round_trip_time) : (round_trip_time - entry.smoothed_rtt);
+
+				entry.rtt_variance = ((entry.rtt_variance * 3) + rtt_error) / 4;
+				entry.smoothed_rtt = ((entry.smoothed_rtt * 7) + round_trip_time) / 8;
+			}
+
+			++entry.nr_of_samples;
+			entry.timeout = entry.smoothed_rtt + (entry.rtt_variance * 4);
+			entry.last_update_time = chrono::steady_clock::now();
+		}
+
+		//A missed reply doubles the timeout of the given target host, so a slow link that went over its
+		//estimation gets more room on its next ICMP Echo Request instead of timing out over and over
+		void rtt_estimator::store_timeout(const unsigned long target_address)
+		{
+			std::lock_guard<std::mutex> guard(m_estimator_mutex);
+
+			estimation_entry& entry = get_entry(target_address);
+
+			chrono::microseconds current_timeout = (entry.timeout > chrono::microseconds::zero()) ? entry.timeout : m_initial_timeout;
+			entry.timeout = clamp_timeout(current_timeout * 2);
+			entry.last_update_time = chrono::steady_clock::now();
+		}
+
+		//It changes the timeout limits, the initial timeout is the one used for hosts with no history
+		bool rtt_estimator::set_timeout_limits(const chrono::milliseconds& min_timeout, const chrono::milliseconds& max_timeout, const chrono::milliseconds& initial_timeout)
+		{
+			bool ret = false;
+
+			if ((min_timeout > chrono::milliseconds::zero()) &&
+				(min_timeout <= max_timeout))
+			{
+				std::lock_guard<std::mutex> guard(m_estimator_mutex);
+
+				m_min_timeout = min_timeout;
+				m_max_timeout = max_timeout;
+				m_initial_timeout = initial_timeout;
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It drops every estimation
+		void rtt_estimator::clear()
+		{
+			std::lock_guard<std::mutex> guard(m_estimator_mutex);
+
+			m_entries.clear();
+		}
+
+		size_t rtt_estimator::size()
+		{
+			std::lock_guard<std::mutex> guard(m_estimator_mutex);
+
+			return m_entries.size();
+		}
+
+		//It keeps the given timeout within the configured limits
+		chrono::microseconds rtt_estimator::clamp_timeout(const chrono::microseconds& timeout) const
+		{
+			return std::min(std::max(timeout, m_min_timeout), m_max_timeout);
+		}
+
+		//It returns the estimation of the given target host, creating it if needed
+		//Estimator lock should be already held
+		rtt_estimator::estimation_entry& rtt_estimator::get_entry(const unsigned long target_address)
+		{
+			if ((m_entries.size() >= m_max_nr_of_entries) &&
+				(m_entries.find(target_address) == m_entries.end()))
+			{
+				make_room();
+			}
+
+			return m_entries[target_address];
+		}
+
+		//It keeps the estimator bounded, the least recently updated hosts go first
+		//A whole batch of them goes at once, so sweeps over many more hosts than fit do not pay a full scan per host
+		void rtt_estimator::make_room()
+		{
+			if (!m_entries.empty())
+			{
+				std::vector<std::pair<chrono::steady_clock::time_point, unsigned long>> entries_by_age;
+				entries_by_age.reserve(m_entries.size());
+				for (const auto& entry : m_entries)
+				{
+					entries_by_age.emplace_back(entry.second.last_update_time, entry.first);
+				}
+
+				size_t nr_of_evictions = std::max<size_t>(1, entries_by_age.size() / EVICTION_BATCH_FRACTION);
+				std::nth_element(entries_by_age.begin(), entries_by_age.begin() + (nr_of_evictions - 1), entries_by_age.end());
+				for (size_t it = 0; it < nr_of_evictions; ++it)
+				{
+					m_entries.erase(entries_by_age[it].second);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <mutex>
+#include <unordered_map>
+
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Per target host round trip time estimator shared across executions
+        //It follows the TCP retransmission timer rules (RFC 6298): a smoothed RTT and RTT variance
+        //are kept for each host, and the time to wait for an ICMP Echo Reply is derived from them
+        class rtt_estimator
+        {
+        public:
+            //Some magic data
+            static constexpr unsigned int DEFAULT_MIN_TIMEOUT_IN_MS = 20;
+            static constexpr unsigned int DEFAULT_MAX_TIMEOUT_IN_MS = 5000;
+            static constexpr unsigned int DEFAULT_INITIAL_TIMEOUT_IN_MS = 1000;
+            static constexpr size_t DEFAULT_MAX_NR_OF_ENTRIES = 4096;
+            static constexpr size_t EVICTION_BATCH_FRACTION = 16;
+
+            //per target host estimation data object
+            typedef struct estimation_entry_unit
+            {
+                estimation_entry_unit() :
+                    nr_of_samples(0),
+                    smoothed_rtt(chrono::microseconds::zero()),
+                    rtt_variance(chrono::microseconds::zero()),
+                    timeout(chrono::microseconds::zero()) {}
+
+                size_t nr_of_samples;
+                chrono::microseconds smoothed_rtt;
+                chrono::microseconds rtt_variance;
+                chrono::microseconds timeout;
+                chrono::steady_clock::time_point last_update_time;
+            } estimation_entry;
+
+            rtt_estimator() :
+                m_min_timeout(chrono::milliseconds(DEFAULT_MIN_TIMEOUT_IN_MS)),
+                m_max_timeout(chrono::milliseconds(DEFAULT_MAX_TIMEOUT_IN_MS)),
+                m_initial_timeout(chrono::milliseconds(DEFAULT_INITIAL_TIMEOUT_IN_MS)),
+                m_max_nr_of_entries(DEFAULT_MAX_NR_OF_ENTRIES) {}
+
+            chrono::microseconds get_timeout(const unsigned long target_address);
+            bool lookup(const unsigned long target_address, estimation_entry& entry);
+            void store_sample(const unsigned long target_address, const chrono::microseconds& round_trip_time);
+            void store_timeout(const unsigned long target_address);
+            bool set_timeout_limits(const chrono::milliseconds& min_timeout, const chrono::milliseconds& max_timeout, const chrono::milliseconds& initial_timeout);
+            void clear();
+            size_t size();
+
+        private:
+            //private helper methods
+            chrono::microseconds clamp_timeout(const chrono::microseconds& timeout) const;
+            estimation_entry& get_entry(const unsigned long target_address);
+            void make_room();
+
+            //member vars
+            std::mutex m_estimator_mutex;
+            chrono::microseconds m_min_timeout;
+            chrono::microseconds m_max_timeout;
+            chrono::microseconds m_initial_timeout;
+            size_t m_max_nr_of_entries;
+            std::unordered_map<unsigned long, estimation_entry> m_entries;
+        };
+    }
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cmath>
+#include "rtt_statistics.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It folds the round trip time of an answered ICMP echo request into the statistics
+		void rtt_statistics::add_reply(const chrono::microseconds& round_trip_time)
+		{
+			double sample = static_cast<double>(round_trip_time.count());
+
+			if (m_nr_of_received == 0)
+			{
+				m_min = round_trip_time;
+				m_max = round_trip_time;
+			}
+			else
+			{
+				m_min = std::min(m_min, round_trip_time);
+				m_max = std::max(m_max, round_trip_time);
+				m_sum_of_differences += std::fabs(sample - static_cast<double>(m_last.count()));
+			}
+
+			++m_nr_of_transmitted;
+			++m_nr_of_received;
+			m_last = round_trip_time;
+
+			//Welford's update: new mean first, then the squared deviation against both the old and the new mean
+			double delta = sample - m_mean;
+			m_mean += delta / static_cast<double>(m_nr_of_received);
+			m_sum_of_squared_deviations += delta * (sample - m_mean);
+		}
+
+		//It accounts for an ICMP echo request that never got its reply
+		void rtt_statistics::add_loss()
+		{
+			++m_nr_of_transmitted;
+		}
+
+		//It forgets about every sample
+		void rtt_statistics::clear()
+		{
+			m_nr_of_transmitted = 0;
+			m_nr_of_received = 0;
+			m_min = chrono::microseconds::zero();
+			m_max = chrono::microseconds::zero();
+			m_last = chrono::microseconds::zero();
+			m_mean = 0.0;
+			m_sum_of_squared_deviations = 0.0;
+			m_sum_of_differences = 0.0;
+		}
+
+		//It returns the number of ICMP echo requests accounted for
+		size_t rtt_statistics::get_nr_of_transmitted() const
+		{
+			return m_nr_of_transmitted;
+		}
+
+		//It returns the number of ICMP echo requests that got their reply
+		size_t rtt_statistics::get_nr_of_received() const
+		{
+			return m_nr_of_received;
+		}
+
+		//It returns the percentage of ICMP echo requests that never got their reply
+		double rtt_statistics::get_packet_loss() const
+		{
+			double ret = 0.0;
+
+			if (m_nr_of_transmitted > 0)
+			{
+				ret = (100.0 * static_cast<double>(m_nr_of_transmitted - m_nr_of_received)) / static_cast<double>(m_nr_of_transmitted);
+			}
+
+			return ret;
+		}
+
+		//It returns the lowest round trip time
+		chrono::microseconds rtt_statistics::get_min() const
+		{
+			return m_min;
+		}
+
+		//It returns the highest round trip time
+		chrono::microseconds rtt_statistics::get_max() const
+		{
+			return m_max;
+		}
+
+		//It returns the mean round trip time
+		chrono::microseconds rtt_statistics::get_avg() const
+		{
+			return chrono::microseconds(static_cast<chrono::microseconds::rep>(std::llround(m_mean)));
+		}
+
+		//It returns the round trip time population standard deviation, the mdev of ping
+		chrono::microseconds rtt_statistics::get_stddev() const
+		{
+			chrono::microseconds ret = chrono::microseconds::zero();
+
+			if (m_nr_of_received > 0)
+			{
+				ret = chrono::microseconds(static_cast<chrono::microseconds::rep>(std::llround(std::sqrt(m_sum_of_squared_deviations / static_cast<double>(m_nr_of_received)))));
+			}
+
+			return ret;
+		}
+
+		//It returns the mean difference between consecutive round trip times
+		chrono::microseconds rtt_statistics::get_jitter() const
+		{
+			chrono::microseconds ret = chrono::microseconds::zero();
+
+			if (m_nr_of_received > 1)
+			{
+				ret = chrono::microseconds(static_cast<chrono::microseconds::rep>(std::llround(m_sum_of_differences / static_cast<double>(m_nr_of_received - 1))));
+			}
+
+			return ret;
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <boost/asio.hpp>
+
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Round trip time statistics accumulator, like the summary ping prints on exit
+        //Samples are folded in as they show up and never stored, mean and variance are kept through
+        //Welford's online algorithm, so memory use is the same no matter the number of samples
+        //Jitter is the mean difference between consecutive round trip times
+        class rtt_statistics
+        {
+        public:
+            rtt_statistics() { clear(); }
+
+            void add_reply(const chrono::microseconds& round_trip_time);
+            void add_loss();
+            void clear();
+            size_t get_nr_of_transmitted() const;
+            size_t get_nr_of_received() const;
+            double get_packet_loss() const;
+            chrono::microseconds get_min() const;
+            chrono::microseconds get_max() const;
+            chrono::microseconds get_avg() const;
+            chrono::microseconds get_stddev() const;
+            chrono::microseconds get_jitter() const;
+
+        private:
+            //member vars
+            size_t m_nr_of_transmitted;
+            size_t m_nr_of_received;
+            chrono::microseconds m_min;
+            chrono::microseconds m_max;
+            chrono::microseconds m_last;
+            double m_mean;
+            double m_sum_of_squared_deviations;
+            double m_sum_of_differences;
+        };
+    }
+}
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include "send_pacer.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It reserves the next send slot for an ICMP echo request to the given target host
+		//It returns when the request can go out, which is right now unless the process-wide or the subnet bucket is empty
+		//The slot is taken no matter what, so the caller is expected to send at the returned time and not ask again
+		chrono::steady_clock::time_point send_pacer::reserve(const unsigned long target_address, const chrono::steady_clock::time_point& now)
+		{
+			return reserve_subnet(static_cast<uint64_t>(target_address >> (32 - SUBNET_PREFIX_LENGTH)), now);
+		}
+
+		//It reserves the next send slot for an ICMP echo request to the given IPV4 or IPV6 target host
+		//IPV6 subnets keep their highest bit set, so they never share a bucket with an IPV4 one
+		chrono::steady_clock::time_point send_pacer::reserve(const boost::asio::ip::address& target_address, const chrono::steady_clock::time_point& now)
+		{
+			uint64_t subnet = 0;
+
+			if (target_address.is_v6())
+			{
+				boost::asio::ip::address_v6::bytes_type address_bytes = target_address.to_v6().to_bytes();
+				for (size_t it = 0; it < (IPV6_SUBNET_PREFIX_LENGTH / 8); ++it)
+				{
+					subnet = (subnet << 8) | address_bytes[it];
+				}
+				subnet |= (static_cast<uint64_t>(1) << 63);
+			}
+			else
+			{
+				subnet = static_cast<uint64_t>(target_address.to_v4().to_ulong() >> (32 - SUBNET_PREFIX_LENGTH));
+			}
+
+			return reserve_subnet(subnet, now);
+		}
+
+		//It takes a send slot out of the process-wide bucket and out of the bucket of the given subnet
+		chrono::steady_clock::time_point send_pacer::reserve_subnet(const uint64_t subnet, const chrono::steady_clock::time_point& now)
+		{
+			chrono::steady_clock::time_point ret = now;
+
+			std::lock_guard<std::mutex> guard(m_pacer_mutex);
+
+			drop_sent_requests(now);
+
+			auto subnet_it = m_subnet_arrival_times.find(subnet);
+
+			//request can only go out once both buckets have a token for it
+			if (m_bucket.is_limited())
+			{
+				ret = std::max(ret, get_conforming_time(m_bucket, m_arrival_time));
+			}
+
+			if ((m_subnet_bucket.is_limited()) &&
+				(subnet_it != m_subnet_arrival_times.end()))
+			{
+				ret = std::max(ret, get_conforming_time(m_subnet_bucket, subnet_it->second));
+			}
+
+			//and now taking those tokens
+			if (m_bucket.is_limited())
+			{
+				m_arrival_time = std::max(m_arrival_time, ret) + m_bucket.emission_interval;
+			}
+
+			if (m_subnet_bucket.is_limited())
+			{
+				if (subnet_it == m_subnet_arrival_times.end())
+				{
+					make_room(now);
+					subnet_it = m_subnet_arrival_times.emplace(subnet, ret).first;
+				}
+
+				subnet_it->second = std::max(subnet_it->second, ret) + m_subnet_bucket.emission_interval;
+			}
+
+			if (ret > now)
+			{
+				m_queued_send_times.push(ret);
+			}
+
+			return ret;
+		}
+
+		//It sets the process-wide send rate limit in ICMP echo requests per second, zero means no limit
+		//Burst is the number of ICMP echo requests that can go out back to back after an idle period
+		bool send_pacer::set_send_rate(const unsigned int max_send_rate, const unsigned int send_burst)
+		{
+			bool ret = false;
+
+			token_bucket new_bucket;
+			if (get_token_bucket(max_send_rate, send_burst, new_bucket))
+			{
+				std::lock_guard<std::mutex> guard(m_pacer_mutex);
+				m_bucket = new_bucket;
+				m_arrival_time = chrono::steady_clock::time_point();
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It sets the send rate limit of each destination subnet in ICMP echo requests per second, zero means no limit
+		bool send_pacer::set_subnet_send_rate(const unsigned int max_send_rate, const unsigned int send_burst)
+		{
+			bool ret = false;
+
+			token_bucket new_bucket;
+			if (get_token_bucket(max_send_rate, send_burst, new_bucket))
+			{
+				std::lock_guard<std::mutex> guard(m_pacer_mutex);
+				m_subnet_bucket = new_bucket;
+				m_subnet_arrival_times.clear();
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It returns the number of ICMP echo requests waiting for their send slot at the given point in time
+		size_t send_pacer::get_queue_depth(const chrono::steady_clock::time_point& now)
+		{
+			std::lock_guard<std::mutex> guard(m_pacer_mutex);
+
+			drop_sent_requests(now);
+
+			return m_queued_send_times.size();
+		}
+
+		//It returns the number of ICMP echo requests waiting for their send slot right now
+		size_t send_pacer::get_queue_depth()
+		{
+			return get_queue_depth(chrono::steady_clock::now());
+		}
+
+		//It returns the number of destination subnets being tracked
+		size_t send_pacer::get_nr_of_subnets()
+		{
+			std::lock_guard<std::mutex> guard(m_pacer_mutex);
+
+			return m_subnet_arrival_times.size();
+		}
+
+		//It forgets about every reserved send slot, limits are kept
+		void send_pacer::clear()
+		{
+			std::lock_guard<std::mutex> guard(m_pacer_mutex);
+
+			m_arrival_time = chrono::steady_clock::time_point();
+			m_subnet_arrival_times.clear();
+			m_queued_send_times = send_time_queue();
+		}
+
+		//It builds a token bucket out of the given rate and burst, a limited bucket needs room for at least one request
+		bool send_pacer::get_token_bucket(const unsigned int max_send_rate, const unsigned int send_burst, token_bucket& bucket)
+		{
+			bool ret = false;
+
+			if (max_send_rate == 0)
+			{
+				bucket = token_bucket();
+				ret = true;
+			}
+			else if (send_burst > 0)
+			{
+				bucket.emission_interval = chrono::nanoseconds(chrono::seconds(1)) / max_send_rate;
+				bucket.burst_tolerance = bucket.emission_interval * (send_burst - 1);
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It returns the earliest point in time a request conforms to the given bucket
+		chrono::steady_clock::time_point send_pacer::get_conforming_time(const token_bucket& bucket, const chrono::steady_clock::time_point& arrival_time)
+		{
+			return (arrival_time - bucket.burst_tolerance);
+		}
+
+		//It forgets about the reserved send slots whose time already came
+		void send_pacer::drop_sent_requests(const chrono::steady_clock::time_point& now)
+		{
+			while ((!m_queued_send_times.empty()) &&
+				(m_queued_send_times.top() <= now))
+			{
+				m_queued_send_times.pop();
+			}
+		}
+
+		//It makes sure there is room for a new subnet
+		//Subnets whose bucket is already full again are dropped first, as forgetting them changes nothing,
+		//otherwise the one that was going to be full the soonest is dropped
+		void send_pacer::make_room(const chrono::steady_clock::time_point& now)
+		{
+			if (m_subnet_arrival_times.size() >= m_max_nr_of_subnets)
+			{
+				for (auto subnet_it = m_subnet_arrival_times.begin(); subnet_it != m_subnet_arrival_times.end();)
+				{
+					if (subnet_it->second <= now)
+					{
+						subnet_it = m_subnet_arrival_times.erase(subnet_it);
+					}
+					else
+					{
+						++subnet_it;
+					}
+				}
+			}
+
+			if (m_subnet_arrival_times.size() >= m_max_nr_of_subnets)
+			{
+				auto oldest_it = std::min_element(m_subnet_arrival_times.begin(), m_subnet_arrival_times.end(),
+					[](const std::pair<const uint64_t, chrono::steady_clock::time_point>& first, const std::pair<const uint64_t, chrono::steady_clock::time_point>& second)
+					{
+						return (first.second < second.second);
+					});
+
+				m_subnet_arrival_times.erase(oldest_it);
+			}
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //Process-wide ICMP echo request pacer shared by every ICMP ping engine
+        //Each ICMP echo request takes a send slot out of a token bucket with the configured rate and burst,
+        //and another one out of the bucket of its destination subnet, so large sweeps do not trip ICMP rate
+        //limiting on routers and target hosts and turn their own bursts into timeouts
+        //Buckets are kept as their theoretical arrival time (GCRA), so a slot is reserved in O(1) and
+        //the caller learns right away when its request can go out, instead of polling for tokens
+        //IPV4 subnets are /24 ones and IPV6 subnets are /64 ones, each family on its own key space
+        class send_pacer
+        {
+        public:
+            //Some magic data
+            static constexpr unsigned int DEFAULT_MAX_SEND_RATE = 10000;
+            static constexpr unsigned int DEFAULT_SEND_BURST = 256;
+            static constexpr unsigned int DEFAULT_MAX_SUBNET_SEND_RATE = 1000;
+            static constexpr unsigned int DEFAULT_SUBNET_SEND_BURST = 64;
+            static constexpr unsigned int SUBNET_PREFIX_LENGTH = 24;
+            static constexpr unsigned int IPV6_SUBNET_PREFIX_LENGTH = 64;
+            static constexpr size_t DEFAULT_MAX_NR_OF_SUBNETS = 4096;
+
+            //token bucket data object, a zero emission interval means no limit at all
+            typedef struct token_bucket_unit
+            {
+                token_bucket_unit() :
+                    emission_interval(chrono::nanoseconds::zero()),
+                    burst_tolerance(chrono::nanoseconds::zero()) {}
+
+                bool is_limited() const { return (emission_interval > chrono::nanoseconds::zero()); }
+
+                chrono::nanoseconds emission_interval;
+                chrono::nanoseconds burst_tolerance;
+            } token_bucket;
+
+            send_pacer() :
+                m_max_nr_of_subnets(DEFAULT_MAX_NR_OF_SUBNETS)
+            {
+                set_send_rate(DEFAULT_MAX_SEND_RATE, DEFAULT_SEND_BURST);
+                set_subnet_send_rate(DEFAULT_MAX_SUBNET_SEND_RATE, DEFAULT_SUBNET_SEND_BURST);
+            }
+
+            chrono::steady_clock::time_point reserve(const unsigned long target_address, const chrono::steady_clock::time_point& now);
+            chrono::steady_clock::time_point reserve(const boost::asio::ip::address& target_address, const chrono::steady_clock::time_point& now);
+            bool set_send_rate(const unsigned int max_send_rate, const unsigned int send_burst);
+            bool set_subnet_send_rate(const unsigned int max_send_rate, const unsigned int send_burst);
+            size_t get_queue_depth(const chrono::steady_clock::time_point& now);
+            size_t get_queue_depth();
+            size_t get_nr_of_subnets();
+            void clear();
+
+        private:
+            typedef std::priority_queue<chrono::steady_clock::time_point, std::vector<chrono::steady_clock::time_point>, std::greater<chrono::steady_clock::time_point>> send_time_queue;
+
+            //private helper methods
+            chrono::steady_clock::time_point reserve_subnet(const uint64_t subnet, const chrono::steady_clock::time_point& now);
+            static bool get_token_bucket(const unsigned int max_send_rate, const unsigned int send_burst, token_bucket& bucket);
+            static chrono::steady_clock::time_point get_conforming_time(const token_bucket& bucket, const chrono::steady_clock::time_point& arrival_time);
+            void drop_sent_requests(const chrono::steady_clock::time_point& now);
+            void make_room(const chrono::steady_clock::time_point& now);
+
+            //member vars
+            std::mutex m_pacer_mutex;
+            token_bucket m_bucket;
+            token_bucket m_subnet_bucket;
+            chrono::steady_clock::time_point m_arrival_time;
+            size_t m_max_nr_of_subnets;
+            std::unordered_map<uint64_t, chrono::steady_clock::time_point> m_subnet_arrival_times;
+            send_time_queue m_queued_send_times;
+        };
+    }
+}
@@ -0,0 +1,637 @@
+#include <algorithm>
+#include <future>
+#include <thread>
+#include "ipv4_packet.h"
+#include "sharded_ping_executor.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It probes the given target hosts on their shards at once, results come back in the order target hosts were requested in
+		bool sharded_ping_executor::execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_response_data_collection& response_data)
+		{
+			bool ret = false;
+
+			//a single shard needs no splitting nor merging
+			if (m_shards.size() == 1)
+			{
+				ret = m_shards.front()->execute(target_hosts, options, response_data);
+			}
+			else if ((!target_hosts.empty()) &&
+				(options.is_valid()))
+			{
+				std::vector<size_t> target_shards;
+				std::vector<std::vector<std::string>> shard_target_hosts;
+				split_target_hosts(target_hosts, target_shards, shard_target_hosts);
+
+				//every shard gets its part of the query at once, and they all run at the same time
+				std::vector<ping_response_data_collection> shard_response_data(m_shards.size());
+				std::vector<std::future<bool>> shard_completions(m_shards.size());
+				for (size_t shard_index = 0; shard_index < m_shards.size(); ++shard_index)
+				{
+					if (!shard_target_hosts[shard_index].empty())
+					{
+						shard_completions[shard_index] = m_shards[shard_index]->submit(shard_target_hosts[shard_index], options, shard_response_data[shard_index]);
+					}
+				}
+
+				for (auto& shard_completion : shard_completions)
+				{
+					if (shard_completion.valid())
+					{
+						shard_completion.get();
+					}
+				}
+
+				merge_shard_data(target_hosts, target_shards, shard_response_data, response_data);
+				ret = (!response_data.empty());
+			}
+
+			return ret;
+		}
+
+		//It probes the given target hosts on their shards at once, each one of them gets a single statistics summary
+		//Summaries come back in the order target hosts were requested in
+		bool sharded_ping_executor::execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_statistics_data_collection& statistics_data)
+		{
+			bool ret = false;
+
+			//a single shard needs no splitting nor merging
+			if (m_shards.size() == 1)
+			{
+				ret = m_shards.front()->execute(target_hosts, options, statistics_data);
+			}
+			else if ((!target_hosts.empty()) &&
+				(options.is_valid()))
+			{
+				std::vector<size_t> target_shards;
+				std::vector<std::vector<std::string>> shard_target_hosts;
+				split_target_hosts(target_hosts, target_shards, shard_target_hosts);
+
+				std::vector<ping_statistics_data_collection> shard_statistics_data(m_shards.size());
+				std::vector<std::future<bool>> shard_completions(m_shards.size());
+				for (size_t shard_index = 0; shard_index < m_shards.size(); ++shard_index)
+				{
+					if (!shard_target_hosts[shard_index].empty())
+					{
+						shard_completions[shard_index] = m_shards[shard_index]->submit(shard_target_hosts[shard_index], options, shard_statistics_data[shard_index]);
+					}
+				}
+
+				for (auto& shard_completion : shard_completions)
+				{
+					if (shard_completion.valid())
+					{
+						shard_completion.get();
+					}
+				}
+
+				merge_shard_data(target_hosts, target_shards, shard_statistics_data, statistics_data);
+				ret = (!statistics_data.empty());
+			}
+
+			return ret;
+		}
+
+		//It probes the given target hosts on their shards at once, results are appended to the given pool as compact
+		//records in the order target hosts were requested in
+		//Every shard fills a pool of its own, so shards never share one while they run
+		bool sharded_ping_executor::execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_result_pool& result_pool)
+		{
+			bool ret = false;
+
+			//a single shard needs no splitting nor merging
+			if (m_shards.size() == 1)
+			{
+				ret = m_shards.front()->execute(target_hosts, options, result_pool);
+			}
+			else if ((!target_hosts.empty()) &&
+				(options.is_valid()))
+			{
+				std::vector<size_t> target_shards;
+				std::vector<std::vector<std::string>> shard_target_hosts;
+				split_target_hosts(target_hosts, target_shards, shard_target_hosts);
+
+				std::vector<ping_result_pool> shard_pools(m_shards.size());
+				std::vector<std::future<bool>> shard_completions(m_shards.size());
+				for (size_t shard_index = 0; shard_index < m_shards.size(); ++shard_index)
+				{
+					if (!shard_target_hosts[shard_index].empty())
+					{
+						shard_completions[shard_index] = m_shards[shard_index]->submit(shard_target_hosts[shard_index], options, shard_pools[shard_index]);
+					}
+				}
+
+				for (auto& shard_completion : shard_completions)
+				{
+					if (shard_completion.valid())
+					{
+						shard_completion.get();
+					}
+				}
+
+				size_t nr_of_records = result_pool.size();
+				merge_shard_pools(target_hosts, target_shards, shard_pools, result_pool);
+				ret = (result_pool.size() > nr_of_records);
+			}
+
+			return ret;
+		}
+
+		//It probes every target host the source hands over on its shard, every shard keeps its own share of the window
+		//The source is pulled and the handler is called from the calling thread only, so neither of them has to be thread safe
+		bool sharded_ping_executor::execute(const icmp_v4_ping_executor::target_host_source& next_target_host, const ping_request_options& options, const icmp_v4_ping_executor::response_handler& on_response, const size_t max_targets_in_flight)
+		{
+			icmp_v4_ping_executor::result_handler on_result = nullptr;
+
+			//every result turns into response data right before the handler gets it
+			if (on_response)
+			{
+				on_result = [&on_response](const ping_result_record& result, const std::string& target_hostname)
+				{
+					ping_response_data response_data;
+					icmp_v4_ping_executor::get_response_data(result, target_hostname, response_data);
+					on_response(response_data);
+				};
+			}
+
+			return execute(next_target_host, options, on_result, max_targets_in_flight);
+		}
+
+		//Same as above, but results go to the given handler as compact records along with their target hostname
+		bool sharded_ping_executor::execute(const icmp_v4_ping_executor::target_host_source& next_target_host, const ping_request_options& options, const icmp_v4_ping_executor::result_handler& on_result, const size_t max_targets_in_flight)
+		{
+			bool ret = false;
+
+			//a single shard needs no routing
+			if (m_shards.size() == 1)
+			{
+				ret = m_shards.front()->execute(next_target_host, options, on_result, max_targets_in_flight);
+			}
+			else if ((next_target_host) &&
+				(on_result) &&
+				(options.is_valid()) &&
+				(max_targets_in_flight > 0))
+			{
+				size_t shard_targets_in_flight = std::max<size_t>(1, (max_targets_in_flight + m_shards.size() - 1) / m_shards.size());
+
+				//lanes hold no more target hosts than their shard can have in flight, so a slow shard holds the
+				//source back instead of piling up the target hosts of its faster peers
+				std::vector<std::unique_ptr<shard_lane>> lanes;
+				router_signal signal;
+				for (size_t shard_index = 0; shard_index < m_shards.size(); ++shard_index)
+				{
+					lanes.emplace_back(new shard_lane(shard_targets_in_flight));
+					shard_lane& lane = *lanes.back();
+
+					bool is_submitted = m_shards[shard_index]->submit(
+
+						//inline callback
+						[&lane, &signal](std::string& target_host)
+						{
+							return get_next_target_host(lane, signal, target_host);
+						},
+
+						options,
+
+						//inline callback
+						[&lane, &signal](const ping_result_record& result, const std::string& target_hostname)
+						{
+							hand_result_over(lane, signal, result, target_hostname);
+						},
+
+						//inline callback
+						[&lane, &signal](const bool succeeded, ping_response_data_collection&)
+						{
+							complete_lane(lane, signal, succeeded);
+						},
+
+						shard_targets_in_flight);
+
+					if (!is_submitted)
+					{
+						lane.completed = true;
+					}
+				}
+
+				std::vector<bool> completed_shards(m_shards.size(), false);
+				std::string target_host;
+				bool has_target_host = false;
+				size_t target_shard = 0;
+				bool source_exhausted = false;
+
+				try
+				{
+					bool all_completed = false;
+					while (!all_completed)
+					{
+						//results go out before more target hosts come in
+						drain_lanes(lanes, on_result);
+
+						if ((!source_exhausted) &&
+							(route_target_hosts(next_target_host, lanes, completed_shards, target_host, has_target_host, target_shard)))
+						{
+							source_exhausted = true;
+							close_lanes(lanes);
+						}
+
+						//results handed over by shards that just completed are not left behind
+						all_completed = poll_shard_completions(lanes, signal, completed_shards, ret);
+						if (all_completed)
+						{
+							drain_lanes(lanes, on_result);
+						}
+						else
+						{
+							wait_for_router_signal(signal);
+						}
+					}
+				}
+				catch (...)
+				{
+					//shards keep using their lanes until they are done, so they are waited for before going on
+					close_lanes(lanes);
+					while (!poll_shard_completions(lanes, signal, completed_shards, ret))
+					{
+						wait_for_router_signal(signal);
+					}
+
+					throw;
+				}
+			}
+
+			return ret;
+		}
+
+		//It replaces the shards with the given number of brand new ones, so it is meant to be called before any query
+		//Shards get disjoint ICMP identifier ranges, and their reactor threads get a core each when asked to
+		bool sharded_ping_executor::set_nr_of_shards(const size_t nr_of_shards, const bool pin_to_cores)
+		{
+			bool ret = false;
+
+			//defense programming sanity check
+			if ((nr_of_shards > 0) &&
+				(nr_of_shards <= MAX_NR_OF_SHARDS))
+			{
+				m_shards.clear();
+				m_hash_ring.clear();
+
+				size_t identifiers_per_shard = ipv4_header::MAX_IDENTIFIER_POSSIBLE / nr_of_shards;
+				for (size_t shard_index = 0; shard_index < nr_of_shards; ++shard_index)
+				{
+					icmp_transport* transport = (m_get_transport) ? m_get_transport(shard_index) : nullptr;
+					m_shards.emplace_back(new icmp_v4_ping_executor(m_send_pacer, m_latency_tracker, transport));
+
+					if (nr_of_shards > 1)
+					{
+						unsigned short first_identifier = static_cast<unsigned short>(1 + (shard_index * identifiers_per_shard));
+						m_shards.back()->set_identifier_range(first_identifier, static_cast<unsigned short>(first_identifier + identifiers_per_shard - 1));
+					}
+
+					if (pin_to_cores)
+					{
+						m_shards.back()->set_reactor_cpu(static_cast<unsigned int>(shard_index));
+					}
+
+					//every shard owns many points of the ring, so target hosts are evenly spread over them
+					for (size_t virtual_node = 0; virtual_node < NR_OF_VIRTUAL_NODES; ++virtual_node)
+					{
+						m_hash_ring.emplace_back(get_hash(std::to_string(shard_index) + "#" + std::to_string(virtual_node)), shard_index);
+					}
+				}
+
+				std::sort(m_hash_ring.begin(), m_hash_ring.end());
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It returns the number of shards queries are spread over
+		size_t sharded_ping_executor::get_nr_of_shards() const
+		{
+			return m_shards.size();
+		}
+
+		//It returns the shard the given target host belongs to, the owner of the first ring point at or after its hash
+		size_t sharded_ping_executor::get_shard_index(const std::string& target_host) const
+		{
+			size_t ret = 0;
+
+			if (m_shards.size() > 1)
+			{
+				auto point_it = std::lower_bound(m_hash_ring.begin(), m_hash_ring.end(), std::make_pair(get_hash(target_host), static_cast<size_t>(0)));
+				if (point_it == m_hash_ring.end())
+				{
+					point_it = m_hash_ring.begin();
+				}
+
+				ret = point_it->second;
+			}
+
+			return ret;
+		}
+
+		//It returns the given shard, so it can be configured on its own
+		icmp_v4_ping_executor& sharded_ping_executor::get_shard(const size_t shard_index)
+		{
+			return *m_shards[shard_index];
+		}
+
+		//It returns the metrics of every shard added up
+		void sharded_ping_executor::get_engine_metrics(engine_metrics::metrics_data& metrics)
+		{
+			metrics.clear();
+
+			for (auto& shard : m_shards)
+			{
+				engine_metrics::metrics_data shard_metrics;
+				shard->get_engine_metrics().get_metrics(shard_metrics);
+				metrics.merge(shard_metrics);
+			}
+		}
+
+		//It gives each shard the target hosts that belong to it, and keeps the shard of each one of them for merging
+		void sharded_ping_executor::split_target_hosts(const std::vector<std::string>& target_hosts, std::vector<size_t>& target_shards, std::vector<std::vector<std::string>>& shard_target_hosts) const
+		{
+			target_shards.resize(target_hosts.size());
+			shard_target_hosts.resize(m_shards.size());
+
+			for (size_t it = 0; it < target_hosts.size(); ++it)
+			{
+				target_shards[it] = get_shard_index(target_hosts[it]);
+				if (!target_hosts[it].empty())
+				{
+					shard_target_hosts[target_shards[it]].push_back(target_hosts[it]);
+				}
+			}
+		}
+
+		//It pulls target hosts from the source and routes them into the lanes of their shards, on the calling thread
+		//A target host whose lane is full is kept aside, and nothing else is pulled until its shard makes room for it
+		//It returns true once the source is exhausted
+		bool sharded_ping_executor::route_target_hosts(const icmp_v4_ping_executor::target_host_source& next_target_host, std::vector<std::unique_ptr<shard_lane>>& lanes, const std::vector<bool>& completed_shards, std::string& target_host, bool& has_target_host, size_t& target_shard)
+		{
+			bool ret = false;
+
+			while (!ret)
+			{
+				if (!has_target_host)
+				{
+					if (!next_target_host(target_host))
+					{
+						ret = true;
+						break;
+					}
+
+					if (target_host.empty())
+					{
+						continue;
+					}
+
+					target_shard = get_shard_index(target_host);
+					has_target_host = true;
+				}
+
+				shard_lane& lane = *lanes[target_shard];
+				if (completed_shards[target_shard])
+				{
+					//its shard is already gone, so it gets no results
+					has_target_host = false;
+					continue;
+				}
+
+				bool is_routed = lane.target_hosts.push(std::move(target_host));
+				if (!is_routed)
+				{
+					//the shard wakes the calling thread up once it takes a target host out
+					lane.router_waiting.store(true);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					is_routed = lane.target_hosts.push(std::move(target_host));
+				}
+
+				if (!is_routed)
+				{
+					break;
+				}
+
+				has_target_host = false;
+				lane.router_waiting.store(false);
+
+				//a shard that ran out of target hosts waits to be resumed
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (lane.shard_idle.exchange(false))
+				{
+					m_shards[target_shard]->resume_target_sources();
+				}
+			}
+
+			return ret;
+		}
+
+		//It lets every shard know no more target hosts are coming, so they finish once their lane is empty
+		void sharded_ping_executor::close_lanes(std::vector<std::unique_ptr<shard_lane>>& lanes)
+		{
+			for (size_t shard_index = 0; shard_index < lanes.size(); ++shard_index)
+			{
+				lanes[shard_index]->source_exhausted.store(true);
+				m_shards[shard_index]->resume_target_sources();
+			}
+		}
+
+		//It hands the results waiting on every lane over to the given handler, on the calling thread
+		void sharded_ping_executor::drain_lanes(std::vector<std::unique_ptr<shard_lane>>& lanes, const icmp_v4_ping_executor::result_handler& on_result)
+		{
+			for (auto& lane : lanes)
+			{
+				lane->results.consume_all([&on_result](shard_result& result)
+				{
+					on_result(result.result, result.target_hostname);
+				});
+			}
+		}
+
+		//It collects the outcome of every shard that completed since the last call, it returns true once all of them did
+		//Outcomes are read under the mutex of the router signal, so a completed shard is already done with the signal
+		bool sharded_ping_executor::poll_shard_completions(std::vector<std::unique_ptr<shard_lane>>& lanes, router_signal& signal, std::vector<bool>& completed_shards, bool& succeeded)
+		{
+			bool ret = true;
+
+			std::lock_guard<std::mutex> guard(signal.signal_mutex);
+			for (size_t shard_index = 0; shard_index < lanes.size(); ++shard_index)
+			{
+				if (!lanes[shard_index]->completed)
+				{
+					ret = false;
+				}
+				else if (!completed_shards[shard_index])
+				{
+					completed_shards[shard_index] = true;
+					if (lanes[shard_index]->succeeded)
+					{
+						succeeded = true;
+					}
+				}
+			}
+
+			return ret;
+		}
+
+		//It hands the next target host of the lane over to its shard, on the reactor thread of the shard
+		//It returns true with an empty target host when the lane has none ready yet, the calling thread resumes
+		//the shard once it routes the next one, and it returns false once the lane is closed and empty
+		bool sharded_ping_executor::get_next_target_host(shard_lane& lane, router_signal& signal, std::string& target_host)
+		{
+			bool ret = true;
+
+			//the lane is closed after its last target host was routed, so a closed lane found empty afterwards is done
+			bool source_exhausted = lane.source_exhausted.load();
+			if (!lane.target_hosts.pop(target_host))
+			{
+				if (source_exhausted)
+				{
+					ret = false;
+				}
+				else
+				{
+					lane.shard_idle.store(true);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (!lane.target_hosts.pop(target_host))
+					{
+						target_host.clear();
+					}
+				}
+			}
+
+			//taking a target host out makes room for the one the calling thread might be waiting to route
+			if (!target_host.empty())
+			{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (lane.router_waiting.exchange(false))
+				{
+					notify_router(signal);
+				}
+			}
+
+			return ret;
+		}
+
+		//It hands a result over to the calling thread, on the reactor thread of its shard
+		//Only the first result after a drain wakes the calling thread up
+		void sharded_ping_executor::hand_result_over(shard_lane& lane, router_signal& signal, const ping_result_record& result, const std::string& target_hostname)
+		{
+			if (lane.results.push(shard_result{ result, target_hostname }))
+			{
+				notify_router(signal);
+			}
+		}
+
+		//It records the outcome of the shard of the lane and wakes the calling thread up, on the reactor thread of the shard
+		//The calling thread is notified under the lock, so it can let go of the signal as soon as it sees every shard completed
+		void sharded_ping_executor::complete_lane(shard_lane& lane, router_signal& signal, const bool succeeded)
+		{
+			std::lock_guard<std::mutex> guard(signal.signal_mutex);
+			lane.completed = true;
+			lane.succeeded = succeeded;
+			signal.pending = true;
+			signal.signal_condition.notify_one();
+		}
+
+		//It wakes the calling thread up
+		void sharded_ping_executor::notify_router(router_signal& signal)
+		{
+			{
+				std::lock_guard<std::mutex> guard(signal.signal_mutex);
+				signal.pending = true;
+			}
+
+			signal.signal_condition.notify_one();
+		}
+
+		//It waits until a shard wakes the calling thread up
+		//Every event the calling thread acts on rings it, and the pending flag keeps the ones rung in between
+		void sharded_ping_executor::wait_for_router_signal(router_signal& signal)
+		{
+			std::unique_lock<std::mutex> lock(signal.signal_mutex);
+			signal.signal_condition.wait(lock, [&signal]() { return signal.pending; });
+			signal.pending = false;
+		}
+
+		//It puts the results of every shard back in the order target hosts were requested in
+		//Shards keep the order of their own target hosts, and the rows of a target host come one after the other
+		template <typename T>
+		void sharded_ping_executor::merge_shard_data(const std::vector<std::string>& target_hosts, const std::vector<size_t>& target_shards, std::vector<std::vector<T>>& shard_data, std::vector<T>& merged_data)
+		{
+			std::vector<size_t> shard_positions(shard_data.size(), 0);
+
+			for (size_t it = 0; it < target_hosts.size(); ++it)
+			{
+				std::vector<T>& data = shard_data[target_shards[it]];
+				size_t& position = shard_positions[target_shards[it]];
+
+				while ((position < data.size()) &&
+					(data[position].target_hostname == target_hosts[it]))
+				{
+					merged_data.push_back(std::move(data[position++]));
+				}
+			}
+		}
+
+		//Same as above for compact records, their host IDs are interned again on the merged pool
+		void sharded_ping_executor::merge_shard_pools(const std::vector<std::string>& target_hosts, const std::vector<size_t>& target_shards, const std::vector<ping_result_pool>& shard_pools, ping_result_pool& merged_pool)
+		{
+			std::vector<size_t> shard_positions(shard_pools.size(), 0);
+
+			size_t nr_of_records = merged_pool.size();
+			for (const auto& shard_pool : shard_pools)
+			{
+				nr_of_records += shard_pool.size();
+			}
+			merged_pool.reserve(nr_of_records);
+
+			for (size_t it = 0; it < target_hosts.size(); ++it)
+			{
+				const ping_result_pool& shard_pool = shard_pools[target_shards[it]];
+				const std::vector<ping_result_record>& records = shard_pool.get_records();
+				size_t& position = shard_positions[target_shards[it]];
+
+				uint32_t host_id = 0;
+				bool is_interned = false;
+				while ((position < records.size()) &&
+					(shard_pool.get_hostname(records[position].host_id) == target_hosts[it]))
+				{
+					if (!is_interned)
+					{
+						host_id = merged_pool.intern_hostname(target_hosts[it]);
+						is_interned = true;
+					}
+
+					ping_result_record record = records[position++];
+					record.host_id = host_id;
+					merged_pool.add_record(record);
+				}
+			}
+		}
+
+		//It returns the FNV-1a hash of the given key, with its bits mixed up so close keys land far apart on the ring
+		uint32_t sharded_ping_executor::get_hash(const std::string& key)
+		{
+			uint32_t ret = 2166136261U;
+
+			for (unsigned char key_byte : key)
+			{
+				ret ^= key_byte;
+				ret *= 16777619U;
+			}
+
+			ret ^= ret >> 16;
+			ret *= 0x85ebca6bU;
+			ret ^= ret >> 13;
+			ret *= 0xc2b2ae35U;
+			ret ^= ret >> 16;
+
+			return ret;
+		}
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "engine_metrics.h"
+#include "icmp_ping_executor.h"
+#include "icmp_transport.h"
+#include "latency_tracker.h"
+#include "mpsc_queue.h"
+#include "ping_result_pool.h"
+#include "send_pacer.h"
+#include "spsc_queue.h"
+
+namespace utils
+{
+    namespace ping
+    {
+        //Set of ICMP ping engines (shards) working side by side, so probing is no longer bound to a single reactor thread
+        //Each shard is a whole executor, with its own reactor thread, io_context, sockets, timers and in-flight probes,
+        //and raw sockets of different shards pick their ICMP identifier out of disjoint ranges, so shards never
+        //share state nor a lock while sending requests and matching replies
+        //Target hosts go to shards through consistent hashing of their name, so a target host always lands on the
+        //same shard and its round trip time history and cached resolutions stay there, and changing the number of
+        //shards only moves about 1/N of the target hosts
+        //Queries are split into one submission per shard and their results are merged back in the order target
+        //hosts were requested in
+        //Streaming executions are driven by the calling thread, it routes target hosts to their shards and hands
+        //the results of every shard over, so shards never contend on a lock for either of them
+        //Reactor threads can be pinned to separate cores
+        class sharded_ping_executor
+        {
+        public:
+            //Some magic data
+            static constexpr size_t DEFAULT_NR_OF_SHARDS = 1;
+            static constexpr size_t MAX_NR_OF_SHARDS = 64;
+            static constexpr size_t NR_OF_VIRTUAL_NODES = 64;
+
+            //it returns the transport of the given shard, or nullptr for an ICMP socket one
+            typedef std::function<icmp_transport*(const size_t shard_index)> transport_factory;
+
+            explicit sharded_ping_executor(send_pacer* pacer = nullptr, latency_tracker* tracker = nullptr, const transport_factory& get_transport = nullptr) :
+                m_send_pacer(pacer),
+                m_latency_tracker(tracker),
+                m_get_transport(get_transport)
+            {
+                set_nr_of_shards(DEFAULT_NR_OF_SHARDS, false);
+            }
+
+            bool execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_response_data_collection& response_data);
+            bool execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_statistics_data_collection& statistics_data);
+            bool execute(const std::vector<std::string>& target_hosts, const ping_request_options& options, ping_result_pool& result_pool);
+            bool execute(const icmp_v4_ping_executor::target_host_source& next_target_host, const ping_request_options& options, const icmp_v4_ping_executor::response_handler& on_response, const size_t max_targets_in_flight = icmp_v4_ping_executor::DEFAULT_MAX_TARGETS_IN_FLIGHT);
+            bool execute(const icmp_v4_ping_executor::target_host_source& next_target_host, const ping_request_options& options, const icmp_v4_ping_executor::result_handler& on_result, const size_t max_targets_in_flight = icmp_v4_ping_executor::DEFAULT_MAX_TARGETS_IN_FLIGHT);
+            bool set_nr_of_shards(const size_t nr_of_shards, const bool pin_to_cores);
+            size_t get_nr_of_shards() const;
+            size_t get_shard_index(const std::string& target_host) const;
+            icmp_v4_ping_executor& get_shard(const size_t shard_index);
+            void get_engine_metrics(engine_metrics::metrics_data& metrics);
+
+        private:
+            //result of a streaming execution on its way from its shard to the calling thread
+            typedef struct shard_result_unit
+            {
+                ping_result_record result;
+                std::string target_hostname;
+            } shard_result;
+
+            //lane of a shard on a streaming execution
+            //The calling thread routes target hosts into a bounded queue the shard takes them from, and the shard
+            //hands results back through a queue the calling thread drains, each queue has a single producer and
+            //a single consumer, so both directions are lock-free
+            //The idle and waiting flags let each side sleep until the other one makes progress
+            //The outcome of the shard is only touched under the mutex of the router signal
+            typedef struct shard_lane_unit
+            {
+                explicit shard_lane_unit(const size_t capacity) :
+                    target_hosts(capacity),
+                    source_exhausted(false),
+                    shard_idle(false),
+                    router_waiting(false),
+                    completed(false),
+                    succeeded(false) {}
+
+                spsc_queue<std::string> target_hosts;
+                mpsc_queue<shard_result> results;
+                std::atomic<bool> source_exhausted;
+                std::atomic<bool> shard_idle;
+                std::atomic<bool> router_waiting;
+                bool completed;
+                bool succeeded;
+            } shard_lane;
+
+            //wake up call of the calling thread of a streaming execution
+            //Shards only ring it for the first result after a drain, when they make room for a target host
+            //the calling thread is waiting to route, and once they complete
+            typedef struct router_signal_unit
+            {
+                router_signal_unit() :
+                    pending(false) {}
+
+                std::mutex signal_mutex;
+                std::condition_variable signal_condition;
+                bool pending;
+            } router_signal;
+
+            typedef std::vector<std::pair<uint32_t, size_t>> hash_ring;
+
+            //private helper methods
+            void split_target_hosts(const std::vector<std::string>& target_hosts, std::vector<size_t>& target_shards, std::vector<std::vector<std::string>>& shard_target_hosts) const;
+            bool route_target_hosts(const icmp_v4_ping_executor::target_host_source& next_target_host, std::vector<std::unique_ptr<shard_lane>>& lanes, const std::vector<bool>& completed_shards, std::string& target_host, bool& has_target_host, size_t& target_shard);
+            void close_lanes(std::vector<std::unique_ptr<shard_lane>>& lanes);
+            static void drain_lanes(std::vector<std::unique_ptr<shard_lane>>& lanes, const icmp_v4_ping_executor::result_handler& on_result);
+            static bool poll_shard_completions(std::vector<std::unique_ptr<shard_lane>>& lanes, router_signal& signal, std::vector<bool>& completed_shards, bool& succeeded);
+            static bool get_next_target_host(shard_lane& lane, router_signal& signal, std::string& target_host);
+            static void hand_result_over(shard_lane& lane, router_signal& signal, const ping_result_record& result, const std::string& target_hostname);
+            static void complete_lane(shard_lane& lane, router_signal& signal, const bool succeeded);
+            static void notify_router(router_signal& signal);
+            static void wait_for_router_signal(router_signal& signal);
+            template <typename T>
+            static void merge_shard_data(const std::vector<std::string>& target_hosts, const std::vector<size_t>& target_shards, std::vector<std::vector<T>>& shard_data, std::vector<T>& merged_data);
+            static void merge_shard_pools(const std::vector<std::string>& target_hosts, const std::vector<size_t>& target_shards, const std::vector<ping_result_pool>& shard_pools, ping_result_pool& merged_pool);
+            static uint32_t get_hash(const std::string& key);
+
+            //member vars
+            send_pacer* m_send_pacer;
+            latency_tracker* m_latency_tracker;
+            transport_factory m_get_transport;
+            std::vector<std::unique_ptr<icmp_v4_ping_executor>> m_shards;
+            hash_ring m_hash_ring;
+        };
+    }
+}
@@ -0,0 +1,421 @@
+#include <algorithm>
+#include "icmp_packet.h"
+#include "internet_checksum.h"
+#include "simulated_network.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It adds a virtual host answering on the given address, or changes how an existing one behaves
+		void simulated_network::add_host(const boost::asio::ip::address& address, const simulated_host& behavior)
+		{
+			m_hosts[address] = behavior;
+		}
+
+		//It makes the given hostname resolve into the given address too, along with the ones it already had
+		void simulated_network::add_hostname(const std::string& hostname, const boost::asio::ip::address& address)
+		{
+			std::vector<boost::asio::ip::address>& addresses = m_hostnames[hostname];
+			if (std::find(addresses.begin(), addresses.end(), address) == addresses.end())
+			{
+				addresses.push_back(address);
+			}
+		}
+
+		//It forgets about every virtual host and hostname, and resets the counters
+		void simulated_network::clear()
+		{
+			m_hosts.clear();
+			m_hostnames.clear();
+			reset_counters();
+		}
+
+		//It resets the counters, the virtual hosts are kept
+		void simulated_network::reset_counters()
+		{
+			m_nr_of_requests = 0;
+			m_nr_of_replies = 0;
+			m_max_nr_of_replies_on_the_wire = 0;
+			m_first_request_time = chrono::steady_clock::time_point();
+			m_last_reply_time = chrono::steady_clock::time_point();
+		}
+
+		//It returns the number of ICMP echo requests sent through the network
+		size_t simulated_network::get_nr_of_requests() const
+		{
+			return m_nr_of_requests;
+		}
+
+		//It returns the number of ICMP echo replies delivered back, duplicates included
+		size_t simulated_network::get_nr_of_replies() const
+		{
+			return m_nr_of_replies;
+		}
+
+		//It returns the largest number of replies that were on their way back at the same time, so tests can tell
+		//whether requests overlapped without relying on wall-clock bounds
+		size_t simulated_network::get_max_nr_of_replies_on_the_wire() const
+		{
+			return m_max_nr_of_replies_on_the_wire;
+		}
+
+		//It returns when the first ICMP echo request went through the network since the counters were reset
+		chrono::steady_clock::time_point simulated_network::get_first_request_time() const
+		{
+			return m_first_request_time;
+		}
+
+		//It returns when the last ICMP echo reply was delivered back since the counters were reset
+		chrono::steady_clock::time_point simulated_network::get_last_reply_time() const
+		{
+			return m_last_reply_time;
+		}
+
+		//It attaches the network to the given async engine, replies still on their way are lost
+		bool simulated_network::open(boost::asio::io_context& async_engine)
+		{
+			close();
+
+			m_async_engine = &async_engine;
+			m_delivery_timer_ptr.reset(new steady_timer(async_engine));
+
+			return true;
+		}
+
+		//It detaches the network from its async engine, pending waits are just dropped along with it
+		void simulated_network::close()
+		{
+			if (m_delivery_timer_ptr)
+			{
+				m_delivery_timer_ptr->cancel();
+			}
+
+			m_delivery_timer_ptr.reset();
+			m_async_engine = nullptr;
+			m_waiting_for_readable = false;
+			m_on_readable = nullptr;
+			m_nr_of_queued_requests = 0;
+			m_replies_on_the_wire.clear();
+			m_received_replies.clear();
+		}
+
+		//Check if the network is attached to an async engine
+		bool simulated_network::is_open() const
+		{
+			return (m_async_engine != nullptr);
+		}
+
+		//It drops every queued request
+		void simulated_network::reset(const size_t /*max_request_size*/)
+		{
+			m_nr_of_queued_requests = 0;
+		}
+
+		//It stops waiting, replies still on their way get delivered on the next wait
+		void simulated_network::cancel()
+		{
+			if (m_delivery_timer_ptr)
+			{
+				m_delivery_timer_ptr->cancel();
+			}
+
+			notify_readable(boost::asio::error::operation_aborted);
+		}
+
+		//It returns the ICMP identifier of the requests, the network takes any
+		unsigned short simulated_network::get_packet_identifier() const
+		{
+			return PACKET_IDENTIFIER;
+		}
+
+		//Replies look like the ones of datagram sockets, with no IPV4 header
+		bool simulated_network::has_ipv4_header() const
+		{
+			return false;
+		}
+
+		//It resolves the given hostname through the added ones, the outcome comes back asynchronously
+		//Only the addresses of the given family are returned, a hostname with none of them is not found
+		void simulated_network::async_resolve(const std::string& target_host, const ADDRESS_FAMILY address_family, const resolve_callback& on_resolved)
+		{
+			boost::system::error_code error_code = boost::asio::error::host_not_found;
+			icmp::resolver::results_type results;
+
+			auto hostname_it = m_hostnames.find(target_host);
+			if (hostname_it != m_hostnames.end())
+			{
+				std::vector<icmp::endpoint> endpoints;
+				for (const auto& address : hostname_it->second)
+				{
+					if ((address_family == DUAL_STACK_FAMILY) ||
+						((address_family == IPV6_FAMILY) == address.is_v6()))
+					{
+						endpoints.emplace_back(address, 0);
+					}
+				}
+
+				if (!endpoints.empty())
+				{
+					error_code = boost::system::error_code();
+					results = icmp::resolver::results_type::create(endpoints.begin(), endpoints.end(), target_host, "");
+				}
+			}
+
+			boost::asio::post(*m_async_engine, [on_resolved, error_code, results]()
+			{
+				on_resolved(error_code, results);
+			});
+		}
+
+		//It queues a request, the queued request buffers only grow
+		unsigned char* simulated_network::queue_request(const icmp::endpoint& destination, const size_t packet_size, const uint64_t request_tag)
+		{
+			if (m_nr_of_queued_requests == m_queued_requests.size())
+			{
+				m_queued_requests.emplace_back();
+			}
+
+			queued_request& request = m_queued_requests[m_nr_of_queued_requests];
+			if (request.packet_bytes.size() < packet_size)
+			{
+				request.packet_bytes.resize(packet_size);
+			}
+
+			request.destination = destination;
+			request.request_tag = request_tag;
+			request.packet_size = packet_size;
+			++m_nr_of_queued_requests;
+
+			return request.packet_bytes.data();
+		}
+
+		//It returns the number of requests waiting to be flushed
+		size_t simulated_network::nr_of_queued_requests() const
+		{
+			return m_nr_of_queued_requests;
+		}
+
+		//It puts every queued request on the wire, the network is never full
+		//Requests queued by the callback go out on the same flush, like the ones of socket transports do
+		int simulated_network::flush_requests(const request_done_callback& on_request_done)
+		{
+			while (m_nr_of_queued_requests > 0)
+			{
+				//requests are taken out of the queue first, the callback might queue new ones
+				size_t nr_of_requests = m_nr_of_queued_requests;
+				m_queued_requests.swap(m_sending_requests);
+				m_nr_of_queued_requests = 0;
+
+				for (size_t it = 0; it < nr_of_requests; ++it)
+				{
+					int send_error = send_request(m_sending_requests[it]);
+					on_request_done(m_sending_requests[it].request_tag, send_error);
+				}
+			}
+
+			arm_delivery_timer();
+
+			return 0;
+		}
+
+		//The network is always writable
+		void simulated_network::async_wait_writable(const wait_callback& on_writable)
+		{
+			boost::asio::post(*m_async_engine, [on_writable]()
+			{
+				on_writable(boost::system::error_code());
+			});
+		}
+
+		//It calls back once there are received replies to drain
+		void simulated_network::async_wait_readable(const wait_callback& on_readable)
+		{
+			m_waiting_for_readable = true;
+			m_on_readable = on_readable;
+
+			if (!m_received_replies.empty())
+			{
+				notify_readable(boost::system::error_code());
+			}
+			else
+			{
+				arm_delivery_timer();
+			}
+		}
+
+		//It hands every received reply over, there are no transmit timestamps on this network
+		int simulated_network::drain_replies(const reply_callback& on_reply, const reply_callback& /*on_transmitted_request*/)
+		{
+			while (!m_received_replies.empty())
+			{
+				simulated_reply reply = std::move(m_received_replies.front());
+				m_received_replies.pop_front();
+
+				icmp_socket_batch::reply_metadata metadata;
+				metadata.source_endpoint = reply.source_endpoint;
+				metadata.time_to_live = TIME_TO_LIVE;
+				if (reply.source_endpoint.address().is_v6())
+				{
+					metadata.destination_address = m_local_ipv6_address;
+				}
+				on_reply(reply.packet_bytes.data(), reply.packet_bytes.size(), metadata);
+			}
+
+			return 0;
+		}
+
+		//It works out what happens to the given request, and puts its replies (if any) on their way back
+		//It returns the send error of the request, requests that fail to be sent never reach the wire
+		int simulated_network::send_request(const queued_request& request)
+		{
+			auto host_it = m_hosts.find(request.destination.address());
+			if ((host_it != m_hosts.end()) &&
+				(get_outcome(host_it->second.send_failure_probability)))
+			{
+				return host_it->second.send_failure_error;
+			}
+
+			if (m_nr_of_requests++ == 0)
+			{
+				m_first_request_time = steady_timer::clock_type::now();
+			}
+
+			if ((host_it != m_hosts.end()) &&
+				(!get_outcome(host_it->second.loss_probability)))
+			{
+				simulated_reply reply;
+				reply.source_endpoint = icmp::endpoint(request.destination.address(), 0);
+				reply.packet_bytes.assign(request.packet_bytes.begin(), request.packet_bytes.begin() + request.packet_size);
+
+				//the reply is the request echoed back, just with its own type
+				bool is_ipv6 = request.destination.address().is_v6();
+				unsigned char request_type = icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REQUEST;
+				unsigned char reply_type = icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY;
+				if (is_ipv6)
+				{
+					request_type = icmp_header::ICMPV6_HEADER_CODE_TYPE::ICMPV6_ECHO_REQUEST;
+					reply_type = icmp_header::ICMPV6_HEADER_CODE_TYPE::ICMPV6_ECHO_REPLY;
+				}
+
+				icmp_header icmp_hdr(reply.packet_bytes.data(), reply.packet_bytes.size());
+				if ((icmp_hdr.is_ready()) &&
+					(icmp_hdr.type() == request_type))
+				{
+					uint64_t pseudo_header_sum = 0;
+					if (is_ipv6)
+					{
+						pseudo_header_sum = internet_checksum_add_ipv6_pseudo_header(request.destination.address().to_v6().to_bytes().data(),
+							m_local_ipv6_address.to_bytes().data(),
+							static_cast<uint32_t>(reply.packet_bytes.size()),
+							IPPROTO_ICMPV6,
+							0);
+					}
+
+					icmp_hdr.type(reply_type);
+					icmp_hdr.update_checksum(pseudo_header_sum);
+
+					chrono::steady_clock::time_point now = steady_timer::clock_type::now();
+					if (get_outcome(host_it->second.duplicate_probability))
+					{
+						m_replies_on_the_wire.emplace(now + get_round_trip_time(host_it->second), reply);
+					}
+
+					m_replies_on_the_wire.emplace(now + get_round_trip_time(host_it->second), std::move(reply));
+					m_max_nr_of_replies_on_the_wire = std::max(m_max_nr_of_replies_on_the_wire, m_replies_on_the_wire.size());
+				}
+			}
+
+			return 0;
+		}
+
+		//It returns a round trip time out of the distribution of the given virtual host
+		chrono::microseconds simulated_network::get_round_trip_time(const simulated_host& behavior)
+		{
+			chrono::microseconds ret = behavior.latency;
+
+			if (behavior.jitter > chrono::microseconds::zero())
+			{
+				std::uniform_int_distribution<chrono::microseconds::rep> jitter_range(0, behavior.jitter.count());
+				ret += chrono::microseconds(jitter_range(m_rng));
+			}
+
+			return ret;
+		}
+
+		//It returns true with the given probability, no random numbers are drawn for impossible outcomes
+		bool simulated_network::get_outcome(const double probability)
+		{
+			bool ret = false;
+
+			if (probability > 0.0)
+			{
+				std::uniform_real_distribution<double> outcome_range(0.0, 1.0);
+				ret = (outcome_range(m_rng) < probability);
+			}
+
+			return ret;
+		}
+
+		//It makes the delivery timer fire when the earliest reply on the wire arrives
+		void simulated_network::arm_delivery_timer()
+		{
+			if ((m_delivery_timer_ptr) &&
+				(!m_replies_on_the_wire.empty()))
+			{
+				m_delivery_timer_ptr->expires_at(m_replies_on_the_wire.begin()->first);
+				m_delivery_timer_ptr->async_wait(
+
+					//inline callback
+					[this](const boost::system::error_code& error_code)
+					{
+						handle_delivery(error_code);
+					});
+			}
+		}
+
+		//It receives every reply that already arrived and wakes up whoever is waiting for them
+		void simulated_network::handle_delivery(const boost::system::error_code& error_code)
+		{
+			//timer was re-armed or cancelled
+			if (error_code != boost::system::errc::success)
+			{
+				return;
+			}
+
+			chrono::steady_clock::time_point now = steady_timer::clock_type::now();
+			while ((!m_replies_on_the_wire.empty()) &&
+				(m_replies_on_the_wire.begin()->first <= now))
+			{
+				m_received_replies.push_back(std::move(m_replies_on_the_wire.begin()->second));
+				m_replies_on_the_wire.erase(m_replies_on_the_wire.begin());
+				++m_nr_of_replies;
+				m_last_reply_time = now;
+			}
+
+			arm_delivery_timer();
+
+			if (!m_received_replies.empty())
+			{
+				notify_readable(boost::system::error_code());
+			}
+		}
+
+		//It completes the pending readable wait, if any, from the async engine like sockets do
+		void simulated_network::notify_readable(const boost::system::error_code& error_code)
+		{
+			if ((m_waiting_for_readable) &&
+				(m_async_engine))
+			{
+				wait_callback on_readable = std::move(m_on_readable);
+				m_waiting_for_readable = false;
+				m_on_readable = nullptr;
+
+				boost::asio::post(*m_async_engine, [on_readable, error_code]()
+				{
+					on_readable(error_code);
+				});
+			}
+		}
+	}
+}
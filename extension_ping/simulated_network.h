@@ -0,0 +1,147 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/shared_ptr.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "icmp_transport.h"
+
+using boost::asio::ip::icmp;
+using boost::asio::steady_timer;
+namespace chrono = boost::asio::chrono;
+
+namespace utils
+{
+    namespace ping
+    {
+        //In-process ICMP transport that answers for a set of virtual hosts, so executors can be tested
+        //with no network, no privileges and as many target hosts as needed
+        //Each virtual host has its own round trip time distribution, loss and duplication odds, replies
+        //overtake each other whenever the jitter of a host is wider than the gap between its requests
+        //Hostnames only resolve when they were added, anything else is not found, and a hostname given both
+        //IPV4 and IPV6 addresses is a dual-stack one
+        //IPV6 requests get ICMPv6 replies whose checksum covers the pseudo header towards a fixed local address
+        //Requests to addresses with no virtual host just never get a reply, and requests to virtual hosts with
+        //send failure odds can fail right away, like an unreachable network does
+        //Outcomes come from a seeded generator, so the same requests always get the same replies
+        class simulated_network : public icmp_transport
+        {
+        public:
+            //Some magic data
+            static constexpr uint32_t DEFAULT_SEED = 5489;
+            static constexpr unsigned short PACKET_IDENTIFIER = 0x0051;
+            static constexpr int TIME_TO_LIVE = 64;
+            static constexpr const char* LOCAL_IPV6_ADDRESS = "fd00::1";
+            static constexpr int SEND_FAILURE_ERROR = EHOSTUNREACH;
+
+            //behavior of a virtual host, round trip times are uniformly spread over [latency, latency + jitter]
+            typedef struct simulated_host_unit
+            {
+                simulated_host_unit() :
+                    latency(chrono::microseconds(1000)),
+                    jitter(chrono::microseconds::zero()),
+                    loss_probability(0.0),
+                    duplicate_probability(0.0),
+                    send_failure_probability(0.0),
+                    send_failure_error(SEND_FAILURE_ERROR) {}
+
+                chrono::microseconds latency;
+                chrono::microseconds jitter;
+                double loss_probability;
+                double duplicate_probability;
+                double send_failure_probability;
+                int send_failure_error;  //errno failed sends report
+            } simulated_host;
+
+            explicit simulated_network(const uint32_t seed = DEFAULT_SEED) :
+                m_async_engine(nullptr),
+                m_delivery_timer_ptr(nullptr),
+                m_rng(seed),
+                m_local_ipv6_address(boost::asio::ip::make_address_v6(LOCAL_IPV6_ADDRESS)),
+                m_nr_of_queued_requests(0),
+                m_waiting_for_readable(false),
+                m_nr_of_requests(0),
+                m_nr_of_replies(0),
+                m_max_nr_of_replies_on_the_wire(0) {}
+
+            //virtual hosts setup, it can be changed between executions
+            void add_host(const boost::asio::ip::address& address, const simulated_host& behavior);
+            void add_hostname(const std::string& hostname, const boost::asio::ip::address& address);
+            void clear();
+            size_t get_nr_of_requests() const;
+            size_t get_nr_of_replies() const;
+            size_t get_max_nr_of_replies_on_the_wire() const;
+            chrono::steady_clock::time_point get_first_request_time() const;
+            chrono::steady_clock::time_point get_last_reply_time() const;
+            void reset_counters();
+
+            bool open(boost::asio::io_context& async_engine) override;
+            void close() override;
+            bool is_open() const override;
+            void reset(const size_t max_request_size) override;
+            void cancel() override;
+            unsigned short get_packet_identifier() const override;
+            bool has_ipv4_header() const override;
+            void async_resolve(const std::string& target_host, const ADDRESS_FAMILY address_family, const resolve_callback& on_resolved) override;
+            unsigned char* queue_request(const icmp::endpoint& destination, const size_t packet_size, const uint64_t request_tag) override;
+            size_t nr_of_queued_requests() const override;
+            int flush_requests(const request_done_callback& on_request_done) override;
+            void async_wait_writable(const wait_callback& on_writable) override;
+            void async_wait_readable(const wait_callback& on_readable) override;
+            int drain_replies(const reply_callback& on_reply, const reply_callback& on_transmitted_request) override;
+
+        private:
+            //request waiting to be flushed
+            typedef struct queued_request_unit
+            {
+                icmp::endpoint destination;
+                uint64_t request_tag;
+                size_t packet_size;
+                std::vector<unsigned char> packet_bytes;
+            } queued_request;
+
+            //reply on its way back, or already received and waiting to be drained
+            typedef struct simulated_reply_unit
+            {
+                icmp::endpoint source_endpoint;
+                std::vector<unsigned char> packet_bytes;
+            } simulated_reply;
+
+            typedef std::multimap<chrono::steady_clock::time_point, simulated_reply> simulated_reply_collection;
+
+            //private helper methods
+            int send_request(const queued_request& request);
+            chrono::microseconds get_round_trip_time(const simulated_host& behavior);
+            bool get_outcome(const double probability);
+            void arm_delivery_timer();
+            void handle_delivery(const boost::system::error_code& error_code);
+            void notify_readable(const boost::system::error_code& error_code);
+
+            //member vars
+            boost::asio::io_context* m_async_engine;
+            boost::shared_ptr<steady_timer> m_delivery_timer_ptr;
+            std::mt19937 m_rng;
+            boost::asio::ip::address_v6 m_local_ipv6_address;
+            std::map<boost::asio::ip::address, simulated_host> m_hosts;
+            std::unordered_map<std::string, std::vector<boost::asio::ip::address>> m_hostnames;
+            size_t m_nr_of_queued_requests;
+            std::vector<queued_request> m_queued_requests;
+            std::vector<queued_request> m_sending_requests;
+            simulated_reply_collection m_replies_on_the_wire;
+            std::deque<simulated_reply> m_received_replies;
+            bool m_waiting_for_readable;
+            wait_callback m_on_readable;
+            size_t m_nr_of_requests;
+            size_t m_nr_of_replies;
+            size_t m_max_nr_of_replies_on_the_wire;
+            chrono::steady_clock::time_point m_first_request_time;
+            chrono::steady_clock::time_point m_last_reply_time;
+        };
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace utils
+{
+    namespace ping
+    {
+        //Bounded lock-free single producer, single consumer queue
+        //Items live on a ring of slots allocated once, the producer only moves the tail and the consumer only
+        //moves the head, so neither of them ever blocks nor waits on the other
+        //Pushing onto a full queue fails and leaves the item untouched, so the producer can keep it for later
+        template <typename T>
+        class spsc_queue
+        {
+        public:
+            explicit spsc_queue(const size_t capacity) :
+                m_slots((capacity > 0) ? capacity : 1),
+                m_head(0),
+                m_tail(0) {}
+
+            spsc_queue(const spsc_queue&) = delete;
+            spsc_queue& operator=(const spsc_queue&) = delete;
+
+            //It adds the given item, it can only be called from the producer thread
+            //It returns false if the queue is full, the item is not moved then
+            bool push(T&& value)
+            {
+                bool ret = false;
+
+                size_t tail = m_tail.load(std::memory_order_relaxed);
+                if (tail - m_head.load(std::memory_order_acquire) < m_slots.size())
+                {
+                    m_slots[tail % m_slots.size()] = std::move(value);
+                    m_tail.store(tail + 1, std::memory_order_release);
+                    ret = true;
+                }
+
+                return ret;
+            }
+
+            //It takes the oldest item out, it can only be called from the consumer thread
+            //It returns false if the queue is empty
+            bool pop(T& value)
+            {
+                bool ret = false;
+
+                size_t head = m_head.load(std::memory_order_relaxed);
+                if (head != m_tail.load(std::memory_order_acquire))
+                {
+                    value = std::move(m_slots[head % m_slots.size()]);
+                    m_head.store(head + 1, std::memory_order_release);
+                    ret = true;
+                }
+
+                return ret;
+            }
+
+            //It returns the number of items the queue can hold
+            size_t capacity() const
+            {
+                return m_slots.size();
+            }
+
+            //Check if there is nothing queued, it is only a hint when called from the producer thread
+            bool empty() const
+            {
+                return (m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire));
+            }
+
+        private:
+            //member vars
+            std::vector<T> m_slots;
+            std::atomic<size_t> m_head;
+            std::atomic<size_t> m_tail;
+        };
+    }
+}
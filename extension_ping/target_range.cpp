@@ -0,0 +1,246 @@
+#include <cctype>
+#include "target_range.h"
+
+namespace utils
+{
+	namespace ping
+	{
+		//It parses the given CIDR block or address range, it returns false if it is neither of them
+		//or if it holds more addresses than the allowed ones
+		bool target_range::parse(const std::string& target_range)
+		{
+			bool ret = false;
+
+			size_t prefix_offset = target_range.find(PREFIX_SEPARATOR);
+			size_t range_offset = target_range.find(RANGE_SEPARATOR);
+
+			if (prefix_offset != std::string::npos)
+			{
+				ret = parse_prefix(target_range, prefix_offset);
+			}
+			else if (range_offset != std::string::npos)
+			{
+				ret = parse_range(target_range, range_offset);
+			}
+
+			if (ret)
+			{
+				m_nr_of_addresses = m_last_address - m_first_address + 1;
+				reset();
+			}
+			else
+			{
+				m_first_address = 0;
+				m_last_address = 0;
+				m_nr_of_addresses = 0;
+				reset();
+			}
+
+			return ret;
+		}
+
+		//It returns the next address of the range in dotted notation, or false once the range is exhausted
+		bool target_range::next(std::string& target_host)
+		{
+			bool ret = false;
+
+			boost::asio::ip::address_v4 target_address;
+			if (next(target_address))
+			{
+				target_host.assign(target_address.to_string());
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It returns the next address of the range, or false once the range is exhausted
+		//The walk goes over every subnet of the range for each last octet, addresses out of the range are skipped
+		bool target_range::next(boost::asio::ip::address_v4& target_address)
+		{
+			bool ret = false;
+
+			while ((!ret) &&
+				(!m_exhausted))
+			{
+				unsigned long address = (m_next_subnet << 8) | m_next_octet;
+
+				//moving on to the next subnet, or to the next last octet once every subnet got this one
+				if (m_next_subnet == (m_last_address >> 8))
+				{
+					m_next_subnet = (m_first_address >> 8);
+					++m_next_octet;
+				}
+				else
+				{
+					++m_next_subnet;
+				}
+
+				if ((address >= m_first_address) &&
+					(address <= m_last_address))
+				{
+					target_address = boost::asio::ip::address_v4(static_cast<boost::asio::ip::address_v4::uint_type>(address));
+					++m_nr_of_walked_addresses;
+					ret = true;
+				}
+
+				if ((m_nr_of_walked_addresses == m_nr_of_addresses) ||
+					(m_next_octet > 0xFF))
+				{
+					m_exhausted = true;
+				}
+			}
+
+			return ret;
+		}
+
+		//It checks if the given address is one of the range ones
+		bool target_range::contains(const boost::asio::ip::address_v4& target_address) const
+		{
+			bool ret = false;
+
+			unsigned long address = target_address.to_ulong();
+			if ((m_nr_of_addresses > 0) &&
+				(address >= m_first_address) &&
+				(address <= m_last_address))
+			{
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It returns the number of addresses of the range
+		unsigned long target_range::size() const
+		{
+			return m_nr_of_addresses;
+		}
+
+		//It starts walking the range from its first address again
+		void target_range::reset()
+		{
+			m_next_subnet = (m_first_address >> 8);
+			m_nr_of_walked_addresses = 0;
+			m_exhausted = (m_nr_of_addresses == 0);
+
+			//single subnet ranges do not need to walk the last octets before their first one
+			m_next_octet = ((m_first_address >> 8) == (m_last_address >> 8)) ? (m_first_address & 0xFF) : 0;
+		}
+
+		//It checks if the given target host is a CIDR block or an address range rather than a single host
+		bool target_range::is_target_range(const std::string& target_range)
+		{
+			utils::ping::target_range new_range;
+
+			return new_range.parse(target_range);
+		}
+
+		//It parses a CIDR block, host bits of the given address are ignored
+		bool target_range::parse_prefix(const std::string& target_range, const size_t separator_offset)
+		{
+			bool ret = false;
+
+			boost::system::error_code address_error_code;
+			boost::asio::ip::address_v4 network_address = boost::asio::ip::make_address_v4(target_range.substr(0, separator_offset), address_error_code);
+			unsigned long prefix_length = 0;
+
+			if ((!address_error_code) &&
+				(parse_number(target_range.substr(separator_offset + 1), MAX_PREFIX_LENGTH, prefix_length)) &&
+				(prefix_length >= MIN_PREFIX_LENGTH))
+			{
+				unsigned long network_mask = (0xFFFFFFFFUL << (MAX_PREFIX_LENGTH - prefix_length)) & 0xFFFFFFFFUL;
+				unsigned long first_address = network_address.to_ulong() & network_mask;
+				unsigned long last_address = first_address | (~network_mask & 0xFFFFFFFFUL);
+
+				//point to point (/31) and single host (/32) blocks have no network and broadcast addresses
+				if (prefix_length < (MAX_PREFIX_LENGTH - 1))
+				{
+					++first_address;
+					--last_address;
+				}
+
+				m_first_address = first_address;
+				m_last_address = last_address;
+				ret = true;
+			}
+
+			return ret;
+		}
+
+		//It parses an address range, the last address can also be given as just its last octet
+		bool target_range::parse_range(const std::string& target_range, const size_t separator_offset)
+		{
+			bool ret = false;
+
+			boost::system::error_code address_error_code;
+			boost::asio::ip::address_v4 first_address = boost::asio::ip::make_address_v4(target_range.substr(0, separator_offset), address_error_code);
+
+			if (!address_error_code)
+			{
+				std::string last_host = target_range.substr(separator_offset + 1);
+				boost::asio::ip::address_v4 last_address = boost::asio::ip::make_address_v4(last_host, address_error_code);
+				unsigned long last_octet = 0;
+
+				if (!address_error_code)
+				{
+					m_last_address = last_address.to_ulong();
+					ret = true;
+				}
+				else if (parse_number(last_host, 0xFF, last_octet))
+				{
+					m_last_address = (first_address.to_ulong() & 0xFFFFFF00UL) | last_octet;
+					ret = true;
+				}
+
+				m_first_address = first_address.to_ulong();
+
+				//empty or too large ranges are not ranges at all
+				if ((ret) &&
+					((m_last_address < m_first_address) ||
+					((m_last_address - m_first_address) >= MAX_NR_OF_ADDRESSES)))
+				{
+					ret = false;
+				}
+			}
+
+			return ret;
+		}
+
+		//It parses a decimal number that cannot go over the given value
+		bool target_range::parse_number(const std::string& number, const unsigned long max_value, unsigned long& value)
+		{
+			bool ret = false;
+
+			//no signs, spaces or overflows allowed
+			if ((!number.empty()) &&
+				(number.size() <= 10))
+			{
+				unsigned long long parsed_value = 0;
+				ret = true;
+
+				for (const char digit : number)
+				{
+					if (!std::isdigit(static_cast<unsigned char>(digit)))
+					{
+						ret = false;
+						break;
+					}
+
+					parsed_value = (parsed_value * 10) + static_cast<unsigned long long>(digit - '0');
+				}
+
+				if ((ret) &&
+					(parsed_value <= max_value))
+				{
+					value = static_cast<unsigned long>(parsed_value);
+				}
+				else
+				{
+					ret = false;
+				}
+			}
+
+			return ret;
+		}
+	}
+}
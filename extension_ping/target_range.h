@@ -0,0 +1,59 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <string>
+
+namespace utils
+{
+    namespace ping
+    {
+        //IPV4 target host range helper class
+        //It parses CIDR blocks (10.0.0.0/24) and address ranges (10.0.0.1-10.0.0.50 or 10.0.0.1-50)
+        //and walks them one address at a time, so sweeping a whole network never materializes it
+        //Like fping -g does, CIDR blocks skip their network and broadcast addresses
+        //Ranges spanning several /24 subnets are walked across them, one address of each subnet at a time,
+        //so consecutive probes spread over every subnet instead of queueing on the pacing limit of a single one
+        class target_range
+        {
+        public:
+            //Some magic data
+            static constexpr char PREFIX_SEPARATOR = '/';
+            static constexpr char RANGE_SEPARATOR = '-';
+            static constexpr unsigned int MIN_PREFIX_LENGTH = 16;
+            static constexpr unsigned int MAX_PREFIX_LENGTH = 32;
+            static constexpr unsigned long MAX_NR_OF_ADDRESSES = 65536;
+
+            target_range() :
+                m_first_address(0),
+                m_last_address(0),
+                m_next_subnet(0),
+                m_next_octet(0),
+                m_nr_of_addresses(0),
+                m_nr_of_walked_addresses(0),
+                m_exhausted(true) {}
+
+            bool parse(const std::string& target_range);
+            bool next(std::string& target_host);
+            bool next(boost::asio::ip::address_v4& target_address);
+            bool contains(const boost::asio::ip::address_v4& target_address) const;
+            unsigned long size() const;
+            void reset();
+            static bool is_target_range(const std::string& target_range);
+
+        private:
+            //private helper methods
+            bool parse_prefix(const std::string& target_range, const size_t separator_offset);
+            bool parse_range(const std::string& target_range, const size_t separator_offset);
+            static bool parse_number(const std::string& number, const unsigned long max_value, unsigned long& value);
+
+            //member vars
+            unsigned long m_first_address;
+            unsigned long m_last_address;
+            unsigned long m_next_subnet;
+            unsigned long m_next_octet;
+            unsigned long m_nr_of_addresses;
+            unsigned long m_nr_of_walked_addresses;
+            bool m_exhausted;
+        };
+    }
+}
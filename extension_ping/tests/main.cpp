@@ -2,7 +2,25 @@
 #include <thread>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
 #include <gtest/gtest.h>
+#include "../icmp_packet.h"
+#include "../icmp_socket_batch.h"
+#include "../icmp_socket_filter.h"
+#include "../internet_checksum.h"
+#include "../ipv4_packet.h"
+#include "../mpsc_queue.h"
+#include "../sharded_ping_executor.h"
+#include "../simulated_network.h"
+#include "../spsc_queue.h"
 #include "../utils.h"
 
 namespace osquery {
@@ -55,6 +73,1480 @@ TEST_F(PingTableTests, multiple_request_ping_test) {
   EXPECT_EQ(4U, result_data.size());
 }
 
+TEST_F(PingTableTests, multiple_hosts_ping_test) {
+  utils::ping::ping_response_data_collection result_data;
+  std::vector<std::string> target_hosts = {"google.com", "2.2.2.2", "gaglee.com"};
+
+  auto start_time = std::chrono::steady_clock::now();
+  EXPECT_TRUE(utils::send_icmp_ping_to_targets(target_hosts, 1, result_data));
+  auto elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+  //hosts are probed concurrently, so one timeout should not add up to the others
+  EXPECT_LT(elapsed_time, std::chrono::seconds(8));
+  ASSERT_EQ(3U, result_data.size());
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA,
+            result_data[0].type);
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::TIMEOUT,
+            result_data[1].type);
+  EXPECT_EQ(
+      utils::ping::ping_response_data::RESPONSE_TYPE::TARGET_HOST_NOT_FOUND,
+      result_data[2].type);
+}
+
+TEST_F(PingTableTests, pipelined_ping_test) {
+  utils::ping::ping_response_data_collection result_data;
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 4;
+  options.request_interval = std::chrono::milliseconds(100);
+
+  auto start_time = std::chrono::steady_clock::now();
+  EXPECT_TRUE(utils::send_icmp_ping_to_targets({"2.2.2.2"}, options, result_data));
+  auto elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+  //echoes do not wait for each other, so all timeouts overlap
+  EXPECT_LT(elapsed_time, std::chrono::seconds(8));
+  ASSERT_EQ(4U, result_data.size());
+  for (const auto& ping_data : result_data) {
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::TIMEOUT,
+              ping_data.type);
+  }
+}
+
+TEST_F(PingTableTests, target_range_test) {
+  utils::ping::target_range range;
+  std::string target_host;
+
+  //CIDR blocks skip their network and broadcast addresses, host bits are ignored
+  EXPECT_TRUE(range.parse("10.0.0.77/24"));
+  EXPECT_EQ(254U, range.size());
+  EXPECT_TRUE(range.next(target_host));
+  EXPECT_EQ("10.0.0.1", target_host);
+  EXPECT_TRUE(range.contains(boost::asio::ip::make_address_v4("10.0.0.254")));
+  EXPECT_FALSE(range.contains(boost::asio::ip::make_address_v4("10.0.0.255")));
+
+  EXPECT_TRUE(range.parse("10.0.0.1/32"));
+  EXPECT_EQ(1U, range.size());
+  EXPECT_TRUE(range.next(target_host));
+  EXPECT_EQ("10.0.0.1", target_host);
+  EXPECT_FALSE(range.next(target_host));
+  EXPECT_TRUE(range.parse("255.255.255.254/31"));
+  EXPECT_TRUE(range.next(target_host));
+  EXPECT_TRUE(range.next(target_host));
+  EXPECT_EQ("255.255.255.255", target_host);
+  EXPECT_FALSE(range.next(target_host));
+
+  //ranges can end on a full address or on just its last octet
+  EXPECT_TRUE(range.parse("10.0.0.250-10.0.1.4"));
+  EXPECT_EQ(11U, range.size());
+
+  //ranges spanning several subnets are walked across them
+  EXPECT_TRUE(range.parse("10.0.0.0/22"));
+  std::vector<std::string> walked_hosts;
+  while (range.next(target_host)) {
+    walked_hosts.push_back(target_host);
+  }
+  ASSERT_EQ(1022U, walked_hosts.size());
+  EXPECT_EQ("10.0.1.0", walked_hosts[0]);
+  EXPECT_EQ("10.0.2.0", walked_hosts[1]);
+  EXPECT_EQ("10.0.0.1", walked_hosts[3]);
+  EXPECT_EQ("10.0.2.255", walked_hosts.back());
+  std::sort(walked_hosts.begin(), walked_hosts.end());
+  EXPECT_EQ(walked_hosts.end(), std::unique(walked_hosts.begin(), walked_hosts.end()));
+  EXPECT_TRUE(range.parse("10.0.0.10-20"));
+  EXPECT_EQ(11U, range.size());
+  range.reset();
+  EXPECT_TRUE(range.next(target_host));
+  EXPECT_EQ("10.0.0.10", target_host);
+
+  //hostnames, reversed, oversized or malformed ranges are not ranges
+  EXPECT_FALSE(utils::ping::target_range::is_target_range("my-host.example.com"));
+  EXPECT_FALSE(utils::ping::target_range::is_target_range("127.0.0.1"));
+  EXPECT_FALSE(utils::ping::target_range::is_target_range("10.0.0.20-10"));
+  EXPECT_FALSE(utils::ping::target_range::is_target_range("10.0.0.0/8"));
+  EXPECT_FALSE(utils::ping::target_range::is_target_range("10.0.0.0/33"));
+  EXPECT_FALSE(utils::ping::target_range::is_target_range("10.0.0.0/-1"));
+  EXPECT_FALSE(utils::ping::target_range::is_target_range("10.0.0.1-"));
+  EXPECT_FALSE(range.parse("10.0.0.0/8"));
+  EXPECT_EQ(0U, range.size());
+  EXPECT_FALSE(range.next(target_host));
+}
+
+TEST_F(PingTableTests, streaming_sweep_test) {
+  utils::ping::target_range range;
+  ASSERT_TRUE(range.parse("127.0.0.0/28"));
+
+  //target hosts are pulled lazily and never more than the window are in flight at once
+  const size_t window_size = 4;
+  size_t nr_of_pulled_hosts = 0;
+  size_t nr_of_responses = 0;
+  size_t max_nr_of_hosts_in_flight = 0;
+  std::vector<std::string> responding_hosts;
+
+  EXPECT_TRUE(pinger.execute(
+      [&](std::string& target_host) {
+        bool ret = range.next(target_host);
+        if (ret) {
+          ++nr_of_pulled_hosts;
+          max_nr_of_hosts_in_flight = std::max(max_nr_of_hosts_in_flight, nr_of_pulled_hosts - nr_of_responses);
+        }
+        return ret;
+      },
+      utils::ping::ping_request_options(),
+      [&](utils::ping::ping_response_data& response_data) {
+        ++nr_of_responses;
+        EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, response_data.type);
+        responding_hosts.push_back(response_data.target_hostname);
+      },
+      window_size));
+
+  EXPECT_EQ(14U, nr_of_pulled_hosts);
+  EXPECT_EQ(14U, nr_of_responses);
+  EXPECT_LE(max_nr_of_hosts_in_flight, window_size);
+  std::sort(responding_hosts.begin(), responding_hosts.end());
+  EXPECT_EQ(responding_hosts.end(), std::unique(responding_hosts.begin(), responding_hosts.end()));
+
+  //not found hosts and pipelined echoes are streamed too, and the engine is still good for regular executions
+  pinger.get_resolver_cache().store_not_found("gaglee.com");
+  std::vector<std::string> target_hosts = {"gaglee.com", "127.0.0.1"};
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 3;
+  options.request_interval = std::chrono::milliseconds(10);
+  nr_of_responses = 0;
+  EXPECT_TRUE(pinger.execute(
+      [&](std::string& target_host) {
+        bool ret = !target_hosts.empty();
+        if (ret) {
+          target_host = target_hosts.back();
+          target_hosts.pop_back();
+        }
+        return ret;
+      },
+      options,
+      [&](utils::ping::ping_response_data&) { ++nr_of_responses; },
+      1));
+  EXPECT_EQ(4U, nr_of_responses);
+
+  EXPECT_TRUE(pinger.execute("127.0.0.1", 1, result_data));
+  EXPECT_EQ(1U, result_data.size());
+}
+
+TEST_F(PingTableTests, simulated_network_test) {
+  utils::ping::simulated_network network;
+  utils::ping::simulated_network::simulated_host steady_host;
+  steady_host.latency = std::chrono::microseconds(2000);
+  utils::ping::simulated_network::simulated_host lossy_host;
+  lossy_host.loss_probability = 1.0;
+  utils::ping::simulated_network::simulated_host duplicating_host;
+  duplicating_host.duplicate_probability = 1.0;
+  utils::ping::simulated_network::simulated_host jittery_host;
+  jittery_host.jitter = std::chrono::microseconds(40000);
+
+  network.add_host(boost::asio::ip::make_address_v4("10.0.0.1"), steady_host);
+  network.add_host(boost::asio::ip::make_address_v4("10.0.0.2"), lossy_host);
+  network.add_host(boost::asio::ip::make_address_v4("10.0.0.3"), duplicating_host);
+  network.add_host(boost::asio::ip::make_address_v4("10.0.0.4"), jittery_host);
+  network.add_hostname("gateway.test", boost::asio::ip::make_address_v4("10.0.0.1"));
+
+  //10.0.0.5 is not on the network, and unknown.test does not resolve
+  utils::ping::icmp_v4_ping_executor simulated_pinger(nullptr, nullptr, &network);
+  std::vector<std::string> target_hosts = {"gateway.test", "10.0.0.2", "10.0.0.3", "10.0.0.4", "10.0.0.5", "unknown.test"};
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 5;
+  options.request_interval = std::chrono::milliseconds(5);
+  options.timeout = std::chrono::milliseconds(200);
+  EXPECT_TRUE(simulated_pinger.execute(target_hosts, options, result_data));
+
+  ASSERT_EQ(26U, result_data.size());
+  std::map<std::string, std::vector<utils::ping::ping_response_data>> results_per_host;
+  for (const auto& ping_data : result_data) {
+    results_per_host[ping_data.target_hostname].push_back(ping_data);
+  }
+
+  for (const auto& ping_data : results_per_host["gateway.test"]) {
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, ping_data.type);
+    EXPECT_EQ("10.0.0.1", ping_data.response_address);
+    EXPECT_GE(ping_data.round_trip_time_us, 2000U);
+    EXPECT_TRUE(ping_data.valid_checksum);
+  }
+
+  for (const auto& target_host : {"10.0.0.2", "10.0.0.5"}) {
+    ASSERT_EQ(5U, results_per_host[target_host].size());
+    for (const auto& ping_data : results_per_host[target_host]) {
+      EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::TIMEOUT, ping_data.type);
+    }
+  }
+
+  //duplicates and reordered replies still get one result per echo, in the order echoes were sent
+  for (const auto& target_host : {"10.0.0.3", "10.0.0.4"}) {
+    ASSERT_EQ(5U, results_per_host[target_host].size());
+    for (size_t it = 0; it < 5; ++it) {
+      EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, results_per_host[target_host][it].type);
+      if (it > 0) {
+        EXPECT_GT(results_per_host[target_host][it].sequence_number, results_per_host[target_host][it - 1].sequence_number);
+      }
+    }
+  }
+
+  ASSERT_EQ(1U, results_per_host["unknown.test"].size());
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::TARGET_HOST_NOT_FOUND, results_per_host["unknown.test"][0].type);
+  EXPECT_EQ(25U, network.get_nr_of_requests());
+  EXPECT_EQ(20U, network.get_nr_of_replies());
+
+  //the same seed always loses the same echoes
+  std::vector<utils::ping::ping_response_data::RESPONSE_TYPE> outcomes[2];
+  for (auto& outcome : outcomes) {
+    utils::ping::simulated_network seeded_network(1071);
+    utils::ping::simulated_network::simulated_host flaky_host;
+    flaky_host.loss_probability = 0.5;
+    seeded_network.add_host(boost::asio::ip::make_address_v4("10.0.0.6"), flaky_host);
+
+    utils::ping::icmp_v4_ping_executor seeded_pinger(nullptr, nullptr, &seeded_network);
+    utils::ping::ping_response_data_collection seeded_results;
+    options.nr_of_ping_requests = 20;
+    options.timeout = std::chrono::milliseconds(50);
+    EXPECT_TRUE(seeded_pinger.execute(std::vector<std::string>{"10.0.0.6"}, options, seeded_results));
+    for (const auto& ping_data : seeded_results) {
+      outcome.push_back(ping_data.type);
+    }
+  }
+
+  EXPECT_EQ(20U, outcomes[0].size());
+  EXPECT_EQ(outcomes[0], outcomes[1]);
+  EXPECT_NE(outcomes[0].end(), std::find(outcomes[0].begin(), outcomes[0].end(), utils::ping::ping_response_data::RESPONSE_TYPE::TIMEOUT));
+  EXPECT_NE(outcomes[0].end(), std::find(outcomes[0].begin(), outcomes[0].end(), utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA));
+}
+
+TEST_F(PingTableTests, simulated_send_failure_test) {
+  utils::ping::simulated_network network;
+  utils::ping::simulated_network::simulated_host steady_host;
+  utils::ping::simulated_network::simulated_host unreachable_host;
+  unreachable_host.send_failure_probability = 1.0;
+  network.add_host(boost::asio::ip::make_address_v4("10.0.5.1"), steady_host);
+  network.add_host(boost::asio::ip::make_address_v4("10.0.5.2"), unreachable_host);
+
+  //on the classic mode every failed send moves on to the next echo, and the execution still completes
+  //once the last one fails, with no reply nor timeout left to wait for
+  utils::ping::icmp_v4_ping_executor simulated_pinger(nullptr, nullptr, &network);
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 3;
+  options.timeout = std::chrono::milliseconds(100);
+  auto completion = simulated_pinger.submit({"10.0.5.2"}, options, result_data);
+  ASSERT_EQ(std::future_status::ready, completion.wait_for(std::chrono::seconds(5)));
+  EXPECT_FALSE(completion.get());
+  EXPECT_TRUE(result_data.empty());
+  EXPECT_EQ(0U, network.get_nr_of_requests());
+
+  //other target hosts are not held back by it
+  completion = simulated_pinger.submit({"10.0.5.2", "10.0.5.1"}, options, result_data);
+  ASSERT_EQ(std::future_status::ready, completion.wait_for(std::chrono::seconds(5)));
+  EXPECT_TRUE(completion.get());
+  ASSERT_EQ(3U, result_data.size());
+  for (const auto& ping_data : result_data) {
+    EXPECT_EQ("10.0.5.1", ping_data.target_hostname);
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, ping_data.type);
+  }
+
+  utils::ping::engine_metrics::metrics_data metrics;
+  simulated_pinger.get_engine_metrics().get_metrics(metrics);
+  EXPECT_EQ(6U, metrics.counters[utils::ping::engine_metrics::LOST_REQUESTS]);
+  EXPECT_EQ(3U, metrics.counters[utils::ping::engine_metrics::REQUESTS_SENT]);
+
+  //the engine is built once and reused across queries, a full send queue does not break it
+  utils::ping::simulated_network::simulated_host congested_host = unreachable_host;
+  congested_host.send_failure_error = ENOBUFS;
+  utils::ping::simulated_network::simulated_host broken_socket_host = unreachable_host;
+  broken_socket_host.send_failure_error = EBADF;
+  network.add_host(boost::asio::ip::make_address_v4("10.0.5.3"), congested_host);
+  network.add_host(boost::asio::ip::make_address_v4("10.0.5.4"), broken_socket_host);
+  options.nr_of_ping_requests = 1;
+  for (int it = 0; it < 3; ++it) {
+    EXPECT_TRUE(simulated_pinger.execute({"10.0.5.1"}, options, result_data));
+  }
+  result_data.clear();
+  EXPECT_FALSE(simulated_pinger.execute({"10.0.5.3"}, options, result_data));
+  EXPECT_TRUE(simulated_pinger.execute({"10.0.5.1"}, options, result_data));
+  simulated_pinger.get_engine_metrics().get_metrics(metrics);
+  EXPECT_EQ(1U, metrics.counters[utils::ping::engine_metrics::ENGINE_REBUILDS]);
+
+  //a send failing because the socket is broken gets it rebuilt once, by the next query
+  result_data.clear();
+  EXPECT_FALSE(simulated_pinger.execute({"10.0.5.4"}, options, result_data));
+  for (int it = 0; it < 3; ++it) {
+    EXPECT_TRUE(simulated_pinger.execute({"10.0.5.1"}, options, result_data));
+  }
+  simulated_pinger.get_engine_metrics().get_metrics(metrics);
+  EXPECT_EQ(2U, metrics.counters[utils::ping::engine_metrics::ENGINE_REBUILDS]);
+}
+
+TEST_F(PingTableTests, simulated_sweep_test) {
+  //10k virtual hosts with a bit of loss, swept with no network at all
+  utils::ping::simulated_network network;
+  utils::ping::simulated_network::simulated_host virtual_host;
+  virtual_host.latency = std::chrono::microseconds(1000);
+  virtual_host.jitter = std::chrono::microseconds(4000);
+  virtual_host.loss_probability = 0.01;
+
+  const uint32_t first_address = boost::asio::ip::make_address_v4("10.1.0.0").to_uint();
+  for (uint32_t it = 0; it < 10000; ++it) {
+    network.add_host(boost::asio::ip::address_v4(first_address + it), virtual_host);
+  }
+
+  utils::ping::target_range range;
+  ASSERT_TRUE(range.parse("10.1.0.0-10.1.39.15"));
+  ASSERT_EQ(10000U, range.size());
+
+  utils::ping::icmp_v4_ping_executor simulated_pinger(nullptr, nullptr, &network);
+  utils::ping::ping_request_options options;
+  options.timeout = std::chrono::milliseconds(100);
+  size_t nr_of_replies = 0;
+  size_t nr_of_timeouts = 0;
+  std::set<std::string> responding_hosts;
+
+  EXPECT_TRUE(simulated_pinger.execute(
+      [&](std::string& target_host) { return range.next(target_host); },
+      options,
+      [&](utils::ping::ping_response_data& response_data) {
+        if (response_data.type == utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA) {
+          ++nr_of_replies;
+          EXPECT_EQ(response_data.target_hostname, response_data.response_address);
+        } else if (response_data.type == utils::ping::ping_response_data::RESPONSE_TYPE::TIMEOUT) {
+          ++nr_of_timeouts;
+        }
+        responding_hosts.insert(response_data.target_hostname);
+      }));
+
+  EXPECT_EQ(10000U, responding_hosts.size());
+  EXPECT_EQ(10000U, nr_of_replies + nr_of_timeouts);
+  EXPECT_EQ(10000U, network.get_nr_of_requests());
+  EXPECT_EQ(network.get_nr_of_replies(), nr_of_replies);
+  EXPECT_GT(nr_of_replies, 9800U);
+}
+
+TEST_F(PingTableTests, simulated_dual_stack_test) {
+  utils::ping::simulated_network network;
+  utils::ping::simulated_network::simulated_host slow_host;
+  slow_host.latency = std::chrono::microseconds(100000);
+
+  network.add_host(boost::asio::ip::make_address("10.0.0.1"), slow_host);
+  network.add_host(boost::asio::ip::make_address("fd00::10"), slow_host);
+  network.add_host(boost::asio::ip::make_address("fd00::11"), slow_host);
+  network.add_hostname("dual.test", boost::asio::ip::make_address("10.0.0.1"));
+  network.add_hostname("dual.test", boost::asio::ip::make_address("fd00::10"));
+  network.add_hostname("ipv6.test", boost::asio::ip::make_address("fd00::11"));
+
+  //hostnames get an echo on each of their families at once, so dual-stack ones do not take twice as long,
+  //all four echoes are on the wire together
+  utils::ping::icmp_v4_ping_executor simulated_pinger(nullptr, nullptr, &network);
+  std::vector<std::string> target_hosts = {"dual.test", "ipv6.test", "fd00::11", "unknown.test"};
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 1;
+  options.timeout = std::chrono::milliseconds(500);
+  options.address_family = utils::ping::icmp_transport::DUAL_STACK_FAMILY;
+  EXPECT_TRUE(simulated_pinger.execute(target_hosts, options, result_data));
+  EXPECT_EQ(4U, network.get_max_nr_of_replies_on_the_wire());
+
+  //rows of both families come one after the other, in the order hosts were requested
+  ASSERT_EQ(5U, result_data.size());
+  const std::vector<std::pair<std::string, std::string>> expected_rows = {
+      {"dual.test", "10.0.0.1"}, {"dual.test", "fd00::10"}, {"ipv6.test", "fd00::11"}, {"fd00::11", "fd00::11"}};
+  for (size_t it = 0; it < expected_rows.size(); ++it) {
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, result_data[it].type);
+    EXPECT_EQ(expected_rows[it].first, result_data[it].target_hostname);
+    EXPECT_EQ(expected_rows[it].second, result_data[it].response_address);
+    EXPECT_EQ((it == 0) ? 4U : 6U, result_data[it].address_family);
+    EXPECT_TRUE(result_data[it].valid_checksum);
+  }
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::TARGET_HOST_NOT_FOUND, result_data[4].type);
+
+  //IPV4 only queries do not see the IPV6 addresses, and the cached ones are kept apart
+  result_data.clear();
+  options.address_family = utils::ping::icmp_transport::IPV4_FAMILY;
+  EXPECT_TRUE(simulated_pinger.execute(std::vector<std::string>{"dual.test", "ipv6.test"}, options, result_data));
+  ASSERT_EQ(2U, result_data.size());
+  EXPECT_EQ("10.0.0.1", result_data[0].response_address);
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::TARGET_HOST_NOT_FOUND, result_data[1].type);
+
+  //summaries get a row per family too
+  utils::ping::ping_statistics_data_collection statistics_data;
+  options.address_family = utils::ping::icmp_transport::DUAL_STACK_FAMILY;
+  EXPECT_TRUE(simulated_pinger.execute(std::vector<std::string>{"dual.test"}, options, statistics_data));
+  ASSERT_EQ(2U, statistics_data.size());
+  EXPECT_EQ(4U, statistics_data[0].address_family);
+  EXPECT_EQ(6U, statistics_data[1].address_family);
+  EXPECT_EQ("fd00::10", statistics_data[1].response_address);
+  EXPECT_EQ(1U, statistics_data[1].statistics.get_nr_of_received());
+}
+
+TEST_F(PingTableTests, simulated_concurrent_test) {
+  utils::ping::simulated_network network;
+  utils::ping::simulated_network::simulated_host slow_host;
+  slow_host.latency = std::chrono::microseconds(100000);
+
+  for (int it = 1; it <= 8; ++it) {
+    network.add_host(boost::asio::ip::make_address_v4("10.0.1." + std::to_string(it)), slow_host);
+  }
+
+  //queries from different threads share the wire, so their echoes are on their way at the same time
+  utils::ping::icmp_v4_ping_executor simulated_pinger(nullptr, nullptr, &network);
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 1;
+  options.timeout = std::chrono::milliseconds(500);
+  std::vector<std::thread> threads;
+  std::vector<utils::ping::ping_response_data_collection> thread_results(8);
+  for (size_t it = 0; it < thread_results.size(); ++it) {
+    threads.push_back(std::thread([&simulated_pinger, &options, &thread_results, it]() {
+      std::string target_host = "10.0.1." + std::to_string(it + 1);
+      EXPECT_TRUE(simulated_pinger.execute(std::vector<std::string>{target_host}, options, thread_results[it]));
+    }));
+  }
+
+  for (auto& th : threads) {
+    th.join();
+  }
+  EXPECT_GE(network.get_max_nr_of_replies_on_the_wire(), 2U);
+
+  //each query only gets the results of its own target hosts
+  for (size_t it = 0; it < thread_results.size(); ++it) {
+    ASSERT_EQ(1U, thread_results[it].size());
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, thread_results[it][0].type);
+    EXPECT_EQ("10.0.1." + std::to_string(it + 1), thread_results[it][0].response_address);
+  }
+
+  //futures and callbacks complete on their own, queries with different options overlap as well,
+  //none of them puts more than three echoes on the wire on its own
+  utils::ping::ping_request_options pipelined_options = options;
+  pipelined_options.nr_of_ping_requests = 3;
+  pipelined_options.request_interval = std::chrono::milliseconds(10);
+  pipelined_options.payload_size = 100;
+  utils::ping::ping_statistics_data_collection statistics_data;
+  std::promise<size_t> callback_results;
+  network.reset_counters();
+  std::future<bool> results_future = simulated_pinger.submit({"10.0.1.1", "10.0.1.2"}, options, result_data);
+  std::future<bool> statistics_future = simulated_pinger.submit({"10.0.1.3"}, pipelined_options, statistics_data);
+  EXPECT_TRUE(simulated_pinger.submit({"10.0.1.4", "10.0.1.9"}, options,
+      [&callback_results](const bool succeeded, utils::ping::ping_response_data_collection& response_data) {
+        callback_results.set_value((succeeded) ? response_data.size() : 0);
+      }));
+
+  EXPECT_TRUE(results_future.get());
+  EXPECT_TRUE(statistics_future.get());
+  EXPECT_EQ(2U, callback_results.get_future().get());
+  EXPECT_GE(network.get_max_nr_of_replies_on_the_wire(), 4U);
+  ASSERT_EQ(2U, result_data.size());
+  EXPECT_EQ("10.0.1.1", result_data[0].response_address);
+  EXPECT_EQ("10.0.1.2", result_data[1].response_address);
+  ASSERT_EQ(1U, statistics_data.size());
+  EXPECT_EQ(3U, statistics_data[0].statistics.get_nr_of_received());
+
+  //queries that are not valid never reach the reactor
+  EXPECT_FALSE(simulated_pinger.submit({}, options, result_data).get());
+  EXPECT_FALSE(simulated_pinger.submit({"10.0.1.1"}, options, utils::ping::icmp_v4_ping_executor::completion_handler()));
+
+  //a settings change made while a query runs waits for it, the query still gets every reply on its engine
+  utils::ping::engine_metrics::metrics_data rebuild_metrics;
+  simulated_pinger.get_engine_metrics().get_metrics(rebuild_metrics);
+  uint64_t nr_of_rebuilds = rebuild_metrics.counters[utils::ping::engine_metrics::ENGINE_REBUILDS];
+  utils::ping::ping_request_options long_options = options;
+  long_options.nr_of_ping_requests = 3;
+  result_data.clear();
+  std::future<bool> long_future = simulated_pinger.submit({"10.0.1.5", "10.0.1.6"}, long_options, result_data);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::thread settings_thread([&simulated_pinger]() {
+    simulated_pinger.set_identifier_range(100, 200);
+  });
+  settings_thread.join();
+  utils::ping::ping_response_data_collection next_result_data;
+  EXPECT_TRUE(simulated_pinger.execute({"10.0.1.7"}, options, next_result_data));
+  EXPECT_TRUE(long_future.get());
+  ASSERT_EQ(6U, result_data.size());
+  for (const auto& response_data : result_data) {
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, response_data.type);
+  }
+  ASSERT_EQ(1U, next_result_data.size());
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, next_result_data[0].type);
+  simulated_pinger.get_engine_metrics().get_metrics(rebuild_metrics);
+  EXPECT_EQ(nr_of_rebuilds + 1, rebuild_metrics.counters[utils::ping::engine_metrics::ENGINE_REBUILDS]);
+
+  //handlers that throw only fail their own execution, a query running next to them completes in full
+  //and the engine is not rebuilt
+  simulated_pinger.get_engine_metrics().get_metrics(rebuild_metrics);
+  nr_of_rebuilds = rebuild_metrics.counters[utils::ping::engine_metrics::ENGINE_REBUILDS];
+  utils::ping::ping_response_data_collection good_result_data;
+  std::future<bool> good_future = simulated_pinger.submit({"10.0.1.8"}, long_options, good_result_data);
+  size_t nr_of_pulled_hosts = 0;
+  EXPECT_FALSE(simulated_pinger.execute(
+      [&nr_of_pulled_hosts](std::string& target_host) {
+        target_host = "10.0.1.1";
+        return (nr_of_pulled_hosts++ == 0);
+      },
+      options,
+      [](utils::ping::ping_response_data&) {
+        throw std::runtime_error("response handler failure");
+      }));
+  EXPECT_FALSE(simulated_pinger.execute(
+      [](std::string&) -> bool {
+        throw 42;
+      },
+      options,
+      [](utils::ping::ping_response_data&) {}));
+  EXPECT_TRUE(good_future.get());
+  ASSERT_EQ(3U, good_result_data.size());
+  for (const auto& response_data : good_result_data) {
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, response_data.type);
+  }
+  simulated_pinger.get_engine_metrics().get_metrics(rebuild_metrics);
+  EXPECT_EQ(nr_of_rebuilds, rebuild_metrics.counters[utils::ping::engine_metrics::ENGINE_REBUILDS]);
+
+  result_data.clear();
+  EXPECT_TRUE(simulated_pinger.execute({"10.0.1.1"}, options, result_data));
+  EXPECT_EQ(1U, result_data.size());
+
+  utils::ping::engine_metrics::metrics_data metrics;
+  simulated_pinger.get_engine_metrics().get_metrics(metrics);
+  uint64_t nr_of_exceptions = 0;
+  for (const auto& error : metrics.errors) {
+    if (error.source == utils::ping::engine_metrics::EXCEPTION_ERROR) {
+      nr_of_exceptions += error.count;
+    }
+  }
+  EXPECT_EQ(2U, nr_of_exceptions);
+}
+
+TEST_F(PingTableTests, sharded_executor_test) {
+  std::vector<utils::ping::simulated_network> networks(5);
+  utils::ping::simulated_network::simulated_host slow_host;
+  slow_host.latency = std::chrono::microseconds(50000);
+  std::vector<std::string> target_hosts;
+  for (int it = 1; it <= 32; ++it) {
+    target_hosts.push_back("10.0.2." + std::to_string(it));
+    for (auto& network : networks) {
+      network.add_host(boost::asio::ip::make_address_v4(target_hosts.back()), slow_host);
+    }
+  }
+
+  utils::ping::sharded_ping_executor sharded_pinger(nullptr, nullptr, [&networks](const size_t shard_index) {
+    return &networks[shard_index];
+  });
+  ASSERT_FALSE(sharded_pinger.set_nr_of_shards(0, false));
+  ASSERT_TRUE(sharded_pinger.set_nr_of_shards(4, false));
+  EXPECT_EQ(4U, sharded_pinger.get_nr_of_shards());
+
+  //target hosts always land on the same shard, and every shard gets some of them
+  std::vector<size_t> nr_of_shard_target_hosts(4, 0);
+  for (const auto& target_host : target_hosts) {
+    EXPECT_EQ(sharded_pinger.get_shard_index(target_host), sharded_pinger.get_shard_index(target_host));
+    ++nr_of_shard_target_hosts[sharded_pinger.get_shard_index(target_host)];
+  }
+  for (size_t shard_index = 0; shard_index < 4; ++shard_index) {
+    EXPECT_GT(nr_of_shard_target_hosts[shard_index], 0U);
+  }
+
+  //shards probe their target hosts at the same time, every one of them sends its first request before any other
+  //one gets its last reply back, and results come back in the requested order
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 1;
+  options.timeout = std::chrono::milliseconds(500);
+  EXPECT_TRUE(sharded_pinger.execute(target_hosts, options, result_data));
+  auto last_first_request_time = networks[0].get_first_request_time();
+  auto first_last_reply_time = networks[0].get_last_reply_time();
+  for (size_t shard_index = 1; shard_index < 4; ++shard_index) {
+    last_first_request_time = std::max(last_first_request_time, networks[shard_index].get_first_request_time());
+    first_last_reply_time = std::min(first_last_reply_time, networks[shard_index].get_last_reply_time());
+  }
+  EXPECT_LT(last_first_request_time, first_last_reply_time);
+  ASSERT_EQ(target_hosts.size(), result_data.size());
+  for (size_t it = 0; it < target_hosts.size(); ++it) {
+    EXPECT_EQ(target_hosts[it], result_data[it].target_hostname);
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, result_data[it].type);
+  }
+  for (size_t shard_index = 0; shard_index < 4; ++shard_index) {
+    EXPECT_EQ(nr_of_shard_target_hosts[shard_index], networks[shard_index].get_nr_of_requests());
+  }
+
+  utils::ping::ping_statistics_data_collection statistics_data;
+  options.nr_of_ping_requests = 2;
+  EXPECT_TRUE(sharded_pinger.execute({"10.0.2.3", "10.0.2.1", "10.0.2.2"}, options, statistics_data));
+  ASSERT_EQ(3U, statistics_data.size());
+  EXPECT_EQ("10.0.2.3", statistics_data[0].target_hostname);
+  EXPECT_EQ("10.0.2.1", statistics_data[1].target_hostname);
+  EXPECT_EQ("10.0.2.2", statistics_data[2].target_hostname);
+  EXPECT_EQ(2U, statistics_data[0].statistics.get_nr_of_received());
+
+  //sweeps are routed to the shards too, and the handler gets every result
+  size_t target_position = 0;
+  std::set<std::string> responding_hosts;
+  options.nr_of_ping_requests = 1;
+  EXPECT_TRUE(sharded_pinger.execute(
+      [&target_hosts, &target_position](std::string& target_host) {
+        bool ret = (target_position < target_hosts.size());
+        if (ret) {
+          target_host = target_hosts[target_position++];
+        }
+        return ret;
+      },
+      options,
+      [&responding_hosts](utils::ping::ping_response_data& ping_data) {
+        if (ping_data.type == utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA) {
+          responding_hosts.insert(ping_data.target_hostname);
+        }
+      },
+      8));
+  EXPECT_EQ(target_hosts.size(), responding_hosts.size());
+
+  //metrics of every shard add up
+  utils::ping::engine_metrics::metrics_data metrics;
+  sharded_pinger.get_engine_metrics(metrics);
+  EXPECT_GE(metrics.counters[utils::ping::engine_metrics::EXECUTIONS], 8U);
+  EXPECT_EQ(target_hosts.size() * 2 + 6, metrics.counters[utils::ping::engine_metrics::REPLIES_MATCHED]);
+
+  //a busy shard holds the source back, its target hosts are either in flight, waiting on its lane or waiting
+  //for their result to be handed over, and both the source and the handler are only called from the calling thread
+  std::vector<std::string> busy_shard_hosts;
+  std::string idle_shard_host;
+  for (const auto& target_host : target_hosts) {
+    if (sharded_pinger.get_shard_index(target_host) == 0) {
+      busy_shard_hosts.push_back(target_host);
+    } else if (idle_shard_host.empty()) {
+      idle_shard_host = target_host;
+    }
+  }
+  ASSERT_FALSE(busy_shard_hosts.empty());
+  ASSERT_FALSE(idle_shard_host.empty());
+  size_t nr_of_pulled_hosts = 0;
+  size_t nr_of_results = 0;
+  size_t max_nr_of_unanswered_hosts = 0;
+  bool is_calling_thread = true;
+  std::thread::id calling_thread_id = std::this_thread::get_id();
+  EXPECT_TRUE(sharded_pinger.execute(
+      [&](std::string& target_host) {
+        is_calling_thread = ((is_calling_thread) && (std::this_thread::get_id() == calling_thread_id));
+        bool ret = (nr_of_pulled_hosts <= 20);
+        if (ret) {
+          target_host = (nr_of_pulled_hosts < 20) ? busy_shard_hosts[nr_of_pulled_hosts % busy_shard_hosts.size()] : idle_shard_host;
+          ++nr_of_pulled_hosts;
+          max_nr_of_unanswered_hosts = std::max(max_nr_of_unanswered_hosts, nr_of_pulled_hosts - nr_of_results);
+        }
+        return ret;
+      },
+      options,
+      [&](const utils::ping::ping_result_record&, const std::string&) {
+        is_calling_thread = ((is_calling_thread) && (std::this_thread::get_id() == calling_thread_id));
+        ++nr_of_results;
+      },
+      8));
+  EXPECT_EQ(21U, nr_of_results);
+  EXPECT_LE(max_nr_of_unanswered_hosts, 7U);
+  EXPECT_TRUE(is_calling_thread);
+
+  //one more shard only moves the target hosts it takes over, the rest stay where they were
+  std::vector<size_t> previous_shards;
+  for (int it = 0; it < 1000; ++it) {
+    previous_shards.push_back(sharded_pinger.get_shard_index("host" + std::to_string(it) + ".test"));
+  }
+  ASSERT_TRUE(sharded_pinger.set_nr_of_shards(5, false));
+  size_t nr_of_moved_hosts = 0;
+  for (int it = 0; it < 1000; ++it) {
+    size_t shard_index = sharded_pinger.get_shard_index("host" + std::to_string(it) + ".test");
+    if (shard_index != previous_shards[it]) {
+      EXPECT_EQ(4U, shard_index);
+      ++nr_of_moved_hosts;
+    }
+  }
+  EXPECT_GT(nr_of_moved_hosts, 100U);
+  EXPECT_LT(nr_of_moved_hosts, 300U);
+}
+
+TEST_F(PingTableTests, engine_metrics_test) {
+  using utils::ping::engine_metrics;
+
+  utils::ping::simulated_network network;
+  utils::ping::simulated_network::simulated_host steady_host;
+  utils::ping::simulated_network::simulated_host lossy_host;
+  lossy_host.loss_probability = 1.0;
+  utils::ping::simulated_network::simulated_host duplicating_host;
+  duplicating_host.duplicate_probability = 1.0;
+
+  network.add_host(boost::asio::ip::make_address_v4("10.0.0.1"), steady_host);
+  network.add_host(boost::asio::ip::make_address_v4("10.0.0.2"), lossy_host);
+  network.add_host(boost::asio::ip::make_address_v4("10.0.0.3"), duplicating_host);
+  network.add_hostname("gateway.test", boost::asio::ip::make_address_v4("10.0.0.1"));
+
+  utils::ping::icmp_v4_ping_executor simulated_pinger(nullptr, nullptr, &network);
+  std::vector<std::string> target_hosts = {"gateway.test", "10.0.0.2", "10.0.0.3", "unknown.test"};
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 2;
+  options.request_interval = std::chrono::milliseconds(5);
+  options.timeout = std::chrono::milliseconds(100);
+  EXPECT_TRUE(simulated_pinger.execute(target_hosts, options, result_data));
+
+  engine_metrics::metrics_data metrics;
+  simulated_pinger.get_engine_metrics().get_metrics(metrics);
+  EXPECT_EQ(1U, metrics.counters[engine_metrics::EXECUTIONS]);
+  EXPECT_EQ(1U, metrics.counters[engine_metrics::ENGINE_REBUILDS]);
+  EXPECT_EQ(2U, metrics.counters[engine_metrics::RESOLUTIONS]);
+  EXPECT_EQ(1U, metrics.counters[engine_metrics::RESOLUTION_FAILURES]);
+  EXPECT_EQ(6U, metrics.counters[engine_metrics::REQUESTS_SENT]);
+  EXPECT_EQ(0U, metrics.counters[engine_metrics::LOST_REQUESTS]);
+  EXPECT_EQ(4U, metrics.counters[engine_metrics::REPLIES_MATCHED]);
+  EXPECT_EQ(2U, metrics.counters[engine_metrics::UNMATCHED_REPLIES]);
+  EXPECT_EQ(0U, metrics.counters[engine_metrics::DROPPED_PACKETS]);
+  EXPECT_EQ(2U, metrics.counters[engine_metrics::TIMEOUTS]);
+  EXPECT_EQ(1U, metrics.stage_histograms[engine_metrics::QUEUE_WAIT_STAGE].get_nr_of_samples());
+  EXPECT_EQ(1U, metrics.stage_histograms[engine_metrics::SETUP_STAGE].get_nr_of_samples());
+  EXPECT_EQ(2U, metrics.stage_histograms[engine_metrics::RESOLVE_STAGE].get_nr_of_samples());
+  EXPECT_EQ(1U, metrics.stage_histograms[engine_metrics::WAIT_STAGE].get_nr_of_samples());
+  EXPECT_GT(metrics.stage_histograms[engine_metrics::SEND_STAGE].get_nr_of_samples(), 0U);
+  EXPECT_GT(metrics.stage_histograms[engine_metrics::DECODE_STAGE].get_nr_of_samples(), 0U);
+
+  //the engine waits on the lossy host for the whole timeout
+  EXPECT_GE(metrics.stage_histograms[engine_metrics::WAIT_STAGE].get_quantile(1.0), std::chrono::milliseconds(90));
+  EXPECT_TRUE(metrics.errors.empty());
+
+  //metrics add up across executions, and hostnames are now cached
+  result_data.clear();
+  EXPECT_TRUE(simulated_pinger.execute(target_hosts, options, result_data));
+  simulated_pinger.get_engine_metrics().get_metrics(metrics);
+  EXPECT_EQ(2U, metrics.counters[engine_metrics::EXECUTIONS]);
+  EXPECT_EQ(1U, metrics.counters[engine_metrics::ENGINE_REBUILDS]);
+  EXPECT_EQ(2U, metrics.counters[engine_metrics::RESOLUTIONS]);
+  EXPECT_EQ(12U, metrics.counters[engine_metrics::REQUESTS_SENT]);
+  EXPECT_EQ(2U, metrics.stage_histograms[engine_metrics::SETUP_STAGE].get_nr_of_samples());
+
+  //errors are counted by where they happened and by error code
+  engine_metrics::metrics_data execution_metrics;
+  execution_metrics.add_error(engine_metrics::SEND_ERROR, boost::asio::error::no_buffer_space);
+  execution_metrics.add_error(engine_metrics::SEND_ERROR, boost::asio::error::no_buffer_space);
+  execution_metrics.add_error(engine_metrics::RECEIVE_ERROR, boost::asio::error::no_buffer_space);
+  execution_metrics.add_error(engine_metrics::SEND_ERROR, boost::asio::error::host_unreachable);
+  ASSERT_EQ(3U, execution_metrics.errors.size());
+  EXPECT_EQ(2U, execution_metrics.errors[0].count);
+  EXPECT_STREQ("send", engine_metrics::get_error_source_name(execution_metrics.errors[0].source));
+
+  engine_metrics shared_metrics;
+  shared_metrics.store_execution(execution_metrics);
+  shared_metrics.store_execution(execution_metrics);
+  shared_metrics.get_metrics(metrics);
+  ASSERT_EQ(3U, metrics.errors.size());
+  EXPECT_EQ(4U, metrics.errors[0].count);
+  EXPECT_EQ(2U, metrics.errors[2].count);
+
+  shared_metrics.clear();
+  shared_metrics.get_metrics(metrics);
+  EXPECT_TRUE(metrics.errors.empty());
+  EXPECT_EQ(0U, metrics.counters[engine_metrics::EXECUTIONS]);
+}
+
+TEST_F(PingTableTests, request_options_test) {
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 2;
+  options.timeout = std::chrono::milliseconds(200);
+  options.payload_size = 1400;
+
+  //fixed timeouts apply to every target host, no matter its history
+  auto start_time = std::chrono::steady_clock::now();
+  EXPECT_TRUE(pinger.execute({"127.0.0.1", "2.2.2.2"}, options, result_data));
+  auto elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+  EXPECT_LT(elapsed_time, std::chrono::seconds(1));
+  ASSERT_EQ(4U, result_data.size());
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, result_data[0].type);
+  EXPECT_TRUE(result_data[0].valid_checksum);
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::TIMEOUT, result_data[3].type);
+
+  result_data.clear();
+  options.payload_size = 0;
+  EXPECT_TRUE(pinger.execute({"127.0.0.1"}, options, result_data));
+  EXPECT_EQ(2U, result_data.size());
+
+  result_data.clear();
+  options.payload_size = utils::ping::ping_request_options::MAX_PAYLOAD_SIZE_IN_BYTES + 1;
+  EXPECT_FALSE(options.is_valid());
+  EXPECT_FALSE(pinger.execute({"127.0.0.1"}, options, result_data));
+  options.payload_size = utils::ping::ping_request_options::DEFAULT_PAYLOAD_SIZE_IN_BYTES;
+  options.nr_of_ping_requests = 0;
+  EXPECT_FALSE(pinger.execute({"127.0.0.1"}, options, result_data));
+}
+
+TEST_F(PingTableTests, send_pacer_test) {
+  utils::ping::send_pacer pacer;
+  auto now = std::chrono::steady_clock::now();
+  unsigned long first_host = boost::asio::ip::make_address_v4("10.0.0.1").to_ulong();
+  unsigned long same_subnet_host = boost::asio::ip::make_address_v4("10.0.0.2").to_ulong();
+  unsigned long other_subnet_host = boost::asio::ip::make_address_v4("10.0.1.1").to_ulong();
+
+  //bursts go out right away, the rest get a send slot on the configured rate
+  ASSERT_TRUE(pacer.set_send_rate(1000, 4));
+  ASSERT_TRUE(pacer.set_subnet_send_rate(0, 0));
+  for (size_t it = 0; it < 4; ++it) {
+    EXPECT_EQ(now, pacer.reserve(first_host, now));
+  }
+  EXPECT_EQ(now + std::chrono::milliseconds(1), pacer.reserve(first_host, now));
+  EXPECT_EQ(now + std::chrono::milliseconds(2), pacer.reserve(other_subnet_host, now));
+  EXPECT_EQ(2U, pacer.get_queue_depth(now));
+  EXPECT_EQ(1U, pacer.get_queue_depth(now + std::chrono::milliseconds(1)));
+  EXPECT_EQ(0U, pacer.get_queue_depth(now + std::chrono::milliseconds(2)));
+
+  //subnets have their own buckets
+  pacer.clear();
+  ASSERT_TRUE(pacer.set_send_rate(0, 0));
+  ASSERT_TRUE(pacer.set_subnet_send_rate(100, 1));
+  EXPECT_EQ(now, pacer.reserve(first_host, now));
+  EXPECT_EQ(now + std::chrono::milliseconds(10), pacer.reserve(same_subnet_host, now));
+  EXPECT_EQ(now, pacer.reserve(other_subnet_host, now));
+  EXPECT_EQ(2U, pacer.get_nr_of_subnets());
+  EXPECT_EQ(now + std::chrono::milliseconds(20), pacer.reserve(first_host, now + std::chrono::milliseconds(5)));
+
+  //limited buckets need room for at least one request
+  EXPECT_FALSE(pacer.set_send_rate(10, 0));
+
+  //paced engines keep sending at the configured rate, without losing any request
+  ASSERT_TRUE(pacer.set_subnet_send_rate(100, 1));
+  utils::ping::icmp_v4_ping_executor paced_pinger(&pacer);
+  auto start_time = std::chrono::steady_clock::now();
+  EXPECT_TRUE(paced_pinger.execute({"127.0.0.1", "127.0.0.2", "127.0.0.3", "127.0.0.4", "127.0.0.5"}, 1, result_data));
+  auto elapsed_time = std::chrono::steady_clock::now() - start_time;
+  EXPECT_EQ(5U, result_data.size());
+  EXPECT_GE(elapsed_time, std::chrono::milliseconds(40));
+  EXPECT_EQ(paced_pinger.get_send_pacer(), &pacer);
+  EXPECT_EQ(nullptr, pinger.get_send_pacer());
+}
+
+TEST_F(PingTableTests, rtt_statistics_test) {
+  utils::ping::rtt_statistics statistics;
+
+  EXPECT_EQ(0U, statistics.get_nr_of_transmitted());
+  EXPECT_EQ(0.0, statistics.get_packet_loss());
+  EXPECT_EQ(std::chrono::microseconds::zero(), statistics.get_stddev());
+
+  statistics.add_reply(std::chrono::microseconds(1000));
+  statistics.add_reply(std::chrono::microseconds(3000));
+  statistics.add_loss();
+  statistics.add_reply(std::chrono::microseconds(2000));
+
+  EXPECT_EQ(4U, statistics.get_nr_of_transmitted());
+  EXPECT_EQ(3U, statistics.get_nr_of_received());
+  EXPECT_DOUBLE_EQ(25.0, statistics.get_packet_loss());
+  EXPECT_EQ(std::chrono::microseconds(1000), statistics.get_min());
+  EXPECT_EQ(std::chrono::microseconds(3000), statistics.get_max());
+  EXPECT_EQ(std::chrono::microseconds(2000), statistics.get_avg());
+  EXPECT_EQ(std::chrono::microseconds(816), statistics.get_stddev());
+  EXPECT_EQ(std::chrono::microseconds(1500), statistics.get_jitter());
+
+  //aggregated executions return a single summary per target host
+  utils::ping::ping_statistics_data_collection statistics_data;
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 3;
+  options.request_interval = std::chrono::milliseconds(10);
+  options.timeout = std::chrono::milliseconds(100);
+  pinger.get_resolver_cache().store_not_found("gaglee.com");
+
+  EXPECT_TRUE(pinger.execute({"127.0.0.1", "2.2.2.2", "gaglee.com"}, options, statistics_data));
+  ASSERT_EQ(3U, statistics_data.size());
+  EXPECT_EQ("127.0.0.1", statistics_data[0].target_hostname);
+  EXPECT_EQ("127.0.0.1", statistics_data[0].response_address);
+  EXPECT_EQ(3U, statistics_data[0].statistics.get_nr_of_received());
+  EXPECT_EQ(0.0, statistics_data[0].statistics.get_packet_loss());
+  EXPECT_LE(statistics_data[0].statistics.get_min(), statistics_data[0].statistics.get_avg());
+  EXPECT_LE(statistics_data[0].statistics.get_avg(), statistics_data[0].statistics.get_max());
+  EXPECT_TRUE(statistics_data[1].target_found);
+  EXPECT_EQ(3U, statistics_data[1].statistics.get_nr_of_transmitted());
+  EXPECT_EQ(100.0, statistics_data[1].statistics.get_packet_loss());
+  EXPECT_FALSE(statistics_data[2].target_found);
+
+  //and the engine is still good for regular executions
+  EXPECT_TRUE(pinger.execute({"127.0.0.1"}, options, result_data));
+  EXPECT_EQ(3U, result_data.size());
+}
+
+TEST_F(PingTableTests, latency_histogram_test) {
+  utils::ping::latency_histogram histogram;
+  utils::ping::latency_histogram lower_half;
+  utils::ping::latency_histogram upper_half;
+
+  EXPECT_EQ(std::chrono::microseconds::zero(), histogram.get_quantile(0.5));
+  EXPECT_LT(utils::ping::latency_histogram::get_relative_accuracy(), 0.02);
+
+  //quantiles come back within the relative accuracy, and merged halves match the whole
+  for (int latency = 1; latency <= 10000; ++latency) {
+    histogram.add(std::chrono::microseconds(latency));
+    ((latency <= 5000) ? lower_half : upper_half).add(std::chrono::microseconds(latency));
+  }
+  lower_half.merge(upper_half);
+
+  double relative_accuracy = utils::ping::latency_histogram::get_relative_accuracy();
+  for (const auto quantile : {0.5, 0.9, 0.99, 0.999}) {
+    double expected_latency = quantile * 10000.0;
+    EXPECT_NEAR(expected_latency, static_cast<double>(histogram.get_quantile(quantile).count()), (expected_latency * relative_accuracy) + 1.0);
+    EXPECT_EQ(histogram.get_quantile(quantile), lower_half.get_quantile(quantile));
+  }
+  EXPECT_EQ(10000U, lower_half.get_nr_of_samples());
+  EXPECT_EQ(std::chrono::microseconds(1), histogram.get_quantile(0.0));
+
+  //rolling windows only merge the slots they cover
+  utils::ping::latency_tracker tracker;
+  utils::ping::latency_histogram window_histogram;
+  ASSERT_TRUE(tracker.set_slots(std::chrono::seconds(10), 3));
+  EXPECT_EQ(std::chrono::seconds(30), tracker.get_max_window());
+  auto now = std::chrono::steady_clock::now();
+  tracker.store_sample("10.0.0.1", std::chrono::microseconds(100), now - std::chrono::seconds(20));
+  tracker.store_sample("10.0.0.1", std::chrono::microseconds(200), now - std::chrono::seconds(10));
+  tracker.store_sample("10.0.0.1", std::chrono::microseconds(300), now);
+
+  EXPECT_TRUE(tracker.get_histogram("10.0.0.1", std::chrono::seconds(10), now, window_histogram));
+  EXPECT_EQ(1U, window_histogram.get_nr_of_samples());
+  EXPECT_TRUE(tracker.get_histogram("10.0.0.1", std::chrono::seconds(30), now, window_histogram));
+  EXPECT_EQ(3U, window_histogram.get_nr_of_samples());
+  EXPECT_TRUE(tracker.get_histogram("10.0.0.1", std::chrono::seconds(30), now + std::chrono::seconds(20), window_histogram));
+  EXPECT_EQ(1U, window_histogram.get_nr_of_samples());
+  EXPECT_FALSE(tracker.get_histogram("10.0.0.2", std::chrono::seconds(30), now, window_histogram));
+
+  //slots get recycled once the ring wraps around
+  tracker.store_sample("10.0.0.1", std::chrono::microseconds(400), now + std::chrono::seconds(10));
+  EXPECT_TRUE(tracker.get_histogram("10.0.0.1", std::chrono::seconds(30), now + std::chrono::seconds(10), window_histogram));
+  EXPECT_EQ(3U, window_histogram.get_nr_of_samples());
+  EXPECT_FALSE(tracker.set_slots(std::chrono::seconds(0), 3));
+
+  //engines feed every reply of their executions, but not their sweeps
+  utils::ping::icmp_v4_ping_executor tracked_pinger(nullptr, &tracker);
+  EXPECT_TRUE(tracked_pinger.execute("127.0.0.1", 3, result_data));
+  EXPECT_TRUE(tracker.get_histogram("127.0.0.1", std::chrono::seconds(30), window_histogram));
+  EXPECT_EQ(3U, window_histogram.get_nr_of_samples());
+
+  utils::ping::target_range range;
+  ASSERT_TRUE(range.parse("127.0.0.2-3"));
+  EXPECT_TRUE(tracked_pinger.execute([&](std::string& target_host) { return range.next(target_host); },
+                                     utils::ping::ping_request_options(),
+                                     [](utils::ping::ping_response_data&) {}));
+  EXPECT_FALSE(tracker.get_histogram("127.0.0.2", std::chrono::seconds(30), window_histogram));
+}
+
+TEST_F(PingTableTests, resolver_cache_test) {
+  utils::ping::resolver_cache cache;
+  utils::ping::resolver_cache::cache_entry entry;
+  icmp::endpoint endpoint(boost::asio::ip::make_address_v4("127.0.0.1"), 0);
+
+  cache.store_resolved("localhost", endpoint);
+  cache.store_not_found("gaglee.com");
+
+  EXPECT_TRUE(cache.lookup("localhost", entry));
+  EXPECT_TRUE(entry.found);
+  EXPECT_EQ(endpoint, entry.resolved_endpoint);
+  EXPECT_TRUE(cache.lookup("gaglee.com", entry));
+  EXPECT_FALSE(entry.found);
+  EXPECT_FALSE(cache.lookup("bing.com", entry));
+
+  //expired entries are never handed out
+  cache.set_time_to_live(std::chrono::seconds(0), std::chrono::seconds(0));
+  cache.store_resolved("localhost", endpoint);
+  EXPECT_FALSE(cache.lookup("localhost", entry));
+}
+
+TEST_F(PingTableTests, rtt_estimator_test) {
+  utils::ping::rtt_estimator estimator;
+  utils::ping::rtt_estimator::estimation_entry entry;
+  unsigned long lan_host = boost::asio::ip::make_address_v4("10.0.0.1").to_ulong();
+  unsigned long wan_host = boost::asio::ip::make_address_v4("10.0.0.2").to_ulong();
+
+  //hosts with no history get the initial timeout
+  EXPECT_EQ(std::chrono::milliseconds(utils::ping::rtt_estimator::DEFAULT_INITIAL_TIMEOUT_IN_MS), estimator.get_timeout(lan_host));
+  EXPECT_FALSE(estimator.lookup(lan_host, entry));
+
+  //fast hosts get the minimum timeout, not seconds
+  for (int it = 0; it < 10; ++it) {
+    estimator.store_sample(lan_host, std::chrono::microseconds(200));
+  }
+  ASSERT_TRUE(estimator.lookup(lan_host, entry));
+  EXPECT_EQ(10U, entry.nr_of_samples);
+  EXPECT_EQ(std::chrono::microseconds(200), entry.smoothed_rtt);
+  EXPECT_EQ(std::chrono::milliseconds(utils::ping::rtt_estimator::DEFAULT_MIN_TIMEOUT_IN_MS), estimator.get_timeout(lan_host));
+
+  //slow and jittery hosts get SRTT + 4 RTTVAR
+  estimator.store_sample(wan_host, std::chrono::milliseconds(300));
+  EXPECT_EQ(std::chrono::milliseconds(900), estimator.get_timeout(wan_host));
+  estimator.store_sample(wan_host, std::chrono::milliseconds(500));
+  ASSERT_TRUE(estimator.lookup(wan_host, entry));
+  EXPECT_EQ(std::chrono::milliseconds(325), entry.smoothed_rtt);
+  EXPECT_EQ(std::chrono::microseconds(162500), entry.rtt_variance);
+
+  //missed replies back the timeout off up to its maximum
+  chrono::microseconds timeout_before_miss = estimator.get_timeout(wan_host);
+  estimator.store_timeout(wan_host);
+  EXPECT_EQ(timeout_before_miss * 2, estimator.get_timeout(wan_host));
+  for (int it = 0; it < 10; ++it) {
+    estimator.store_timeout(wan_host);
+  }
+  EXPECT_EQ(std::chrono::milliseconds(utils::ping::rtt_estimator::DEFAULT_MAX_TIMEOUT_IN_MS), estimator.get_timeout(wan_host));
+
+  EXPECT_FALSE(estimator.set_timeout_limits(std::chrono::milliseconds(100), std::chrono::milliseconds(10), std::chrono::milliseconds(50)));
+  EXPECT_TRUE(estimator.set_timeout_limits(std::chrono::milliseconds(1), std::chrono::milliseconds(2000), std::chrono::milliseconds(50)));
+  EXPECT_EQ(std::chrono::microseconds(1000), estimator.get_timeout(lan_host));
+  EXPECT_EQ(std::chrono::milliseconds(2000), estimator.get_timeout(wan_host));
+  EXPECT_EQ(std::chrono::milliseconds(50), estimator.get_timeout(boost::asio::ip::make_address_v4("10.0.0.3").to_ulong()));
+}
+
+TEST_F(PingTableTests, mpsc_queue_test) {
+  utils::ping::mpsc_queue<std::pair<size_t, size_t>> queue;
+  const size_t nr_of_producers = 4;
+  const size_t nr_of_items = 10000;
+
+  EXPECT_TRUE(queue.empty());
+  EXPECT_TRUE(queue.push(std::make_pair(nr_of_producers, 0)));
+  EXPECT_FALSE(queue.push(std::make_pair(nr_of_producers, 1)));
+
+  //items of the same producer come out in the order they went in, none of them is lost
+  std::atomic<size_t> nr_of_wakeups(0);
+  std::vector<std::thread> producers;
+  for (size_t producer = 0; producer < nr_of_producers; ++producer) {
+    producers.push_back(std::thread([&queue, &nr_of_wakeups, producer, nr_of_items]() {
+      for (size_t it = 0; it < nr_of_items; ++it) {
+        if (queue.push(std::make_pair(producer, it))) {
+          ++nr_of_wakeups;
+        }
+      }
+    }));
+  }
+
+  std::vector<size_t> next_items(nr_of_producers + 1, 0);
+  size_t nr_of_consumed_items = 0;
+  bool in_order = true;
+  auto on_item = [&next_items, &in_order](std::pair<size_t, size_t>& item) {
+    in_order = ((in_order) && (item.second == next_items[item.first]));
+    next_items[item.first] = item.second + 1;
+  };
+
+  while (nr_of_consumed_items < (nr_of_producers * nr_of_items) + 2) {
+    nr_of_consumed_items += queue.consume_all(on_item);
+  }
+
+  for (auto& th : producers) {
+    th.join();
+  }
+
+  EXPECT_TRUE(in_order);
+  EXPECT_EQ(0U, queue.consume_all(on_item));
+  EXPECT_TRUE(queue.empty());
+  for (size_t producer = 0; producer < nr_of_producers; ++producer) {
+    EXPECT_EQ(nr_of_items, next_items[producer]);
+  }
+  EXPECT_GE(nr_of_wakeups.load(), 1U);
+}
+
+TEST_F(PingTableTests, spsc_queue_test) {
+  utils::ping::spsc_queue<std::string> queue(2);
+  std::string item;
+
+  //a full queue leaves the item with the producer
+  EXPECT_EQ(2U, queue.capacity());
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.pop(item));
+  EXPECT_TRUE(queue.push(std::string("first")));
+  EXPECT_TRUE(queue.push(std::string("second")));
+  std::string third_item = "third";
+  EXPECT_FALSE(queue.push(std::move(third_item)));
+  EXPECT_EQ("third", third_item);
+  ASSERT_TRUE(queue.pop(item));
+  EXPECT_EQ("first", item);
+  EXPECT_TRUE(queue.push(std::move(third_item)));
+  ASSERT_TRUE(queue.pop(item));
+  EXPECT_EQ("second", item);
+  ASSERT_TRUE(queue.pop(item));
+  EXPECT_EQ("third", item);
+  EXPECT_TRUE(queue.empty());
+
+  //items go through in order and none of them is lost, however often the ring wraps around
+  const size_t nr_of_items = 10000;
+  utils::ping::spsc_queue<size_t> ring(8);
+  std::thread producer([&ring, nr_of_items]() {
+    for (size_t it = 0; it < nr_of_items; ++it) {
+      size_t value = it;
+      while (!ring.push(std::move(value))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  size_t next_item = 0;
+  bool in_order = true;
+  while (next_item < nr_of_items) {
+    size_t value = 0;
+    if (ring.pop(value)) {
+      in_order = ((in_order) && (value == next_item));
+      ++next_item;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  EXPECT_TRUE(in_order);
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST_F(PingTableTests, result_pool_test) {
+  //hostnames are stored once, and addresses go back to text as they came in
+  utils::ping::ping_result_pool pool;
+  EXPECT_EQ(0U, pool.intern_hostname("gateway.test"));
+  EXPECT_EQ(1U, pool.intern_hostname("10.0.3.2"));
+  EXPECT_EQ(0U, pool.intern_hostname("gateway.test"));
+  EXPECT_EQ(2U, pool.get_nr_of_hostnames());
+  EXPECT_EQ("10.0.3.2", pool.get_hostname(1));
+  EXPECT_EQ("", pool.get_hostname(2));
+
+  utils::ping::ping_result_record record;
+  EXPECT_FALSE(record.has_response_address());
+  EXPECT_EQ("", utils::ping::ping_result_pool::get_response_address_text(record));
+  utils::ping::ping_result_pool::set_response_address(boost::asio::ip::make_address("10.0.3.1"), record);
+  EXPECT_EQ("10.0.3.1", utils::ping::ping_result_pool::get_response_address_text(record));
+  utils::ping::ping_result_pool::set_response_address(boost::asio::ip::make_address("fe80::1%3"), record);
+  EXPECT_EQ(boost::asio::ip::make_address("fe80::1%3"), utils::ping::ping_result_pool::get_response_address(record));
+
+  //executions fill the pool with compact records, in the order target hosts were requested in
+  utils::ping::simulated_network network;
+  utils::ping::simulated_network::simulated_host steady_host;
+  network.add_host(boost::asio::ip::make_address_v4("10.0.3.1"), steady_host);
+  network.add_host(boost::asio::ip::make_address_v4("10.0.3.2"), steady_host);
+  network.add_hostname("gateway.test", boost::asio::ip::make_address_v4("10.0.3.1"));
+
+  utils::ping::icmp_v4_ping_executor simulated_pinger(nullptr, nullptr, &network);
+  utils::ping::ping_request_options options;
+  options.nr_of_ping_requests = 2;
+  options.timeout = std::chrono::milliseconds(100);
+  EXPECT_TRUE(simulated_pinger.execute({"10.0.3.2", "gateway.test", "10.0.3.9", "unknown.test"}, options, pool));
+
+  ASSERT_EQ(7U, pool.size());
+  EXPECT_EQ(4U, pool.get_nr_of_hostnames());
+  const auto& records = pool.get_records();
+  EXPECT_EQ("10.0.3.2", pool.get_hostname(records[0].host_id));
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, records[0].type);
+  EXPECT_EQ("10.0.3.2", utils::ping::ping_result_pool::get_response_address_text(records[0]));
+  EXPECT_EQ("gateway.test", pool.get_hostname(records[2].host_id));
+  EXPECT_EQ("10.0.3.1", utils::ping::ping_result_pool::get_response_address_text(records[3]));
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::TIMEOUT, records[4].type);
+  EXPECT_FALSE(records[4].has_response_address());
+  EXPECT_EQ("unknown.test", pool.get_hostname(records[6].host_id));
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::TARGET_HOST_NOT_FOUND, records[6].type);
+
+  //compact records turn into the same response data the collections get
+  utils::ping::ping_response_data response_data;
+  utils::ping::icmp_v4_ping_executor::get_response_data(records[3], pool.get_hostname(records[3].host_id), response_data);
+  EXPECT_TRUE(response_data.is_ready());
+  EXPECT_EQ("gateway.test", response_data.target_hostname);
+  EXPECT_EQ("10.0.3.1", response_data.response_address);
+  EXPECT_EQ(records[3].sequence_number, response_data.sequence_number);
+  EXPECT_EQ(records[3].round_trip_time_us, response_data.round_trip_time_us);
+
+  //sweeps can hand compact records over too
+  std::vector<std::string> sweep_hosts = {"10.0.3.1", "10.0.3.2"};
+  size_t sweep_position = 0;
+  std::set<std::string> responding_hosts;
+  EXPECT_TRUE(simulated_pinger.execute(
+      [&](std::string& target_host) {
+        bool ret = (sweep_position < sweep_hosts.size());
+        if (ret) {
+          target_host = sweep_hosts[sweep_position++];
+        }
+        return ret;
+      },
+      options,
+      [&](const utils::ping::ping_result_record& result, const std::string& target_hostname) {
+        EXPECT_EQ(target_hostname, utils::ping::ping_result_pool::get_response_address_text(result));
+        responding_hosts.insert(target_hostname);
+      }));
+  EXPECT_EQ(2U, responding_hosts.size());
+
+  //sharded pools are merged back in the requested order, with their hostnames interned again
+  std::vector<utils::ping::simulated_network> networks(3);
+  for (auto& shard_network : networks) {
+    for (int it = 1; it <= 16; ++it) {
+      shard_network.add_host(boost::asio::ip::make_address_v4("10.0.4." + std::to_string(it)), steady_host);
+    }
+  }
+  utils::ping::sharded_ping_executor sharded_pinger(nullptr, nullptr, [&networks](const size_t shard_index) {
+    return &networks[shard_index];
+  });
+  ASSERT_TRUE(sharded_pinger.set_nr_of_shards(3, false));
+  std::vector<std::string> target_hosts;
+  for (int it = 16; it >= 1; --it) {
+    target_hosts.push_back("10.0.4." + std::to_string(it));
+  }
+  utils::ping::ping_result_pool sharded_pool;
+  options.nr_of_ping_requests = 1;
+  EXPECT_TRUE(sharded_pinger.execute(target_hosts, options, sharded_pool));
+  ASSERT_EQ(target_hosts.size(), sharded_pool.size());
+  for (size_t it = 0; it < target_hosts.size(); ++it) {
+    EXPECT_EQ(target_hosts[it], sharded_pool.get_hostname(sharded_pool.get_records()[it].host_id));
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, sharded_pool.get_records()[it].type);
+  }
+}
+
+TEST_F(PingTableTests, ping_scheduler_test) {
+  utils::ping::ping_scheduler scheduler;
+  utils::ping::ping_sample_collection samples;
+
+  EXPECT_FALSE(scheduler.add_targets("127.0.0.1@50,127.0.0.2@abc,127.0.0.3@0", std::chrono::milliseconds(50)));
+  EXPECT_TRUE(scheduler.remove_target("127.0.0.1"));
+  EXPECT_TRUE(scheduler.add_targets("127.0.0.1@50,,127.0.0.2", std::chrono::milliseconds(100)));
+  scheduler.set_history_size(3);
+
+  EXPECT_TRUE(scheduler.start());
+  EXPECT_FALSE(scheduler.start());
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  scheduler.stop();
+  EXPECT_FALSE(scheduler.is_running());
+
+  //rings keep the latest samples only, from the oldest to the latest one
+  scheduler.get_samples({"127.0.0.1"}, false, samples);
+  ASSERT_EQ(3U, samples.size());
+  for (const auto& sample : samples) {
+    EXPECT_EQ("127.0.0.1", sample.data.target_hostname);
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, sample.data.type);
+  }
+  EXPECT_LT(samples[0].probe_time, samples[1].probe_time);
+  EXPECT_LT(samples[1].probe_time, samples[2].probe_time);
+
+  samples.clear();
+  scheduler.get_samples({}, true, samples);
+  ASSERT_EQ(2U, samples.size());
+  EXPECT_EQ("127.0.0.1", samples[0].data.target_hostname);
+  EXPECT_EQ("127.0.0.2", samples[1].data.target_hostname);
+
+  samples.clear();
+  scheduler.get_samples({"127.0.0.9"}, true, samples);
+  EXPECT_TRUE(samples.empty());
+}
+
+TEST_F(PingTableTests, host_state_tracker_test) {
+  utils::ping::host_state_tracker tracker;
+  utils::ping::host_state_tracker::state_change change;
+  utils::ping::ping_response_data data;
+  data.target_hostname = "10.0.0.1";
+  data.type = utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA;
+  data.response_address = "10.0.0.1";
+  data.round_trip_time_us = 1000;
+
+  //first response is always a change, the same state over and over is not
+  ASSERT_TRUE(tracker.update(data, change));
+  EXPECT_EQ(utils::ping::host_state_tracker::REACHABILITY_CHANGE, change.changes);
+  EXPECT_EQ(utils::ping::host_state_tracker::UNKNOWN, change.previous_state.state);
+  EXPECT_EQ(utils::ping::host_state_tracker::REACHABLE, change.current_state.state);
+  EXPECT_EQ(512U, change.rtt_band_low_us);
+  EXPECT_EQ(1024U, change.rtt_band_high_us);
+  EXPECT_FALSE(tracker.update(data, change));
+
+  //small moves around a band border are not changes, leaving the band is
+  data.round_trip_time_us = 1100;
+  EXPECT_FALSE(tracker.update(data, change));
+  data.round_trip_time_us = 3000;
+  ASSERT_TRUE(tracker.update(data, change));
+  EXPECT_EQ(utils::ping::host_state_tracker::RTT_BAND_CHANGE, change.changes);
+
+  data.response_address = "10.0.0.2";
+  ASSERT_TRUE(tracker.update(data, change));
+  EXPECT_EQ(utils::ping::host_state_tracker::ADDRESS_CHANGE, change.changes);
+  EXPECT_EQ("10.0.0.1", change.previous_state.response_address);
+  EXPECT_EQ("address", utils::ping::host_state_tracker::get_changes_description(change.changes));
+
+  //going down and up again
+  utils::ping::ping_response_data timeout_data;
+  timeout_data.target_hostname = "10.0.0.1";
+  timeout_data.type = utils::ping::ping_response_data::RESPONSE_TYPE::TIMEOUT;
+  utils::ping::ping_response_data_collection response_data = {timeout_data, timeout_data, data};
+  utils::ping::host_state_tracker::state_change_collection changes;
+  tracker.update(response_data, changes);
+  ASSERT_EQ(2U, changes.size());
+  EXPECT_STREQ("down", utils::ping::host_state_tracker::get_state_name(changes[0].current_state.state));
+  EXPECT_STREQ("up", utils::ping::host_state_tracker::get_state_name(changes[1].current_state.state));
+  EXPECT_EQ(1U, tracker.size());
+}
+
+TEST_F(PingTableTests, packet_codec_test) {
+  //IPV4 header with no options followed by an ICMP echo reply with a 4 bytes payload
+  unsigned char packet_bytes[] = {
+      0x45, 0x00, 0x00, 0x20, 0x12, 0x34, 0x40, 0x00, 0x40, 0x01, 0x00, 0x00,
+      0x7f, 0x00, 0x00, 0x01, 0x7f, 0x00, 0x00, 0x02,
+      0x00, 0x00, 0x00, 0x00, 0xbe, 0xef, 0x00, 0x07, 'p', 'i', 'n', 'g'};
+
+  ipv4_header ipv4_hdr(packet_bytes, sizeof(packet_bytes));
+  ASSERT_TRUE(ipv4_hdr.is_ready());
+  EXPECT_EQ(64U, ipv4_hdr.time_to_live());
+  EXPECT_EQ("127.0.0.1", ipv4_hdr.source_address().to_string());
+  EXPECT_EQ(12U, ipv4_hdr.payload_size());
+
+  icmp_header icmp_hdr(packet_bytes + ipv4_hdr.payload_offset(), ipv4_hdr.payload_size());
+  ASSERT_TRUE(icmp_hdr.is_ready());
+  EXPECT_EQ(icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY, icmp_hdr.type());
+  EXPECT_EQ(0xbeefU, icmp_hdr.identifier());
+  EXPECT_EQ(7U, icmp_hdr.sequence_number());
+  EXPECT_EQ(4U, icmp_hdr.payload_size());
+
+  //building over the same bytes is visible through the views right away
+  icmp_hdr.type(icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REQUEST);
+  EXPECT_TRUE(icmp_hdr.update_checksum());
+  EXPECT_EQ(0x5a38U, icmp_hdr.checksum());
+  EXPECT_EQ(icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REQUEST, packet_bytes[20]);
+
+  //truncated headers are never considered ready
+  EXPECT_FALSE(ipv4_header(packet_bytes, 10).is_ready());
+  EXPECT_FALSE(icmp_header(packet_bytes + 20, 4).is_ready());
+}
+
+TEST_F(PingTableTests, internet_checksum_test) {
+  std::vector<unsigned char> packet_bytes(4099);
+  std::mt19937 rng(1071);
+  std::generate(packet_bytes.begin(), packet_bytes.end(), [&rng]() { return static_cast<unsigned char>(rng()); });
+
+  //every size and alignment goes through a different mix of wide, narrow and trailing byte paths
+  for (size_t offset = 0; offset < 4; ++offset) {
+    for (size_t size = 0; size + offset <= packet_bytes.size(); size += 37) {
+      const unsigned char* data = packet_bytes.data() + offset;
+      unsigned int expected_sum = 0;
+      for (size_t it = 0; it < size; it += 2) {
+        expected_sum += (data[it] << 8) + ((it + 1 < size) ? data[it + 1] : 0);
+      }
+      while ((expected_sum >> 16) != 0) {
+        expected_sum = (expected_sum & 0xFFFF) + (expected_sum >> 16);
+      }
+
+      EXPECT_EQ(static_cast<uint16_t>(~expected_sum), internet_checksum(data, size));
+    }
+  }
+
+  //a corrupted byte has to be caught on verification
+  icmp_header icmp_hdr(packet_bytes.data(), 1472);
+  icmp_hdr.type(icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY);
+  EXPECT_TRUE(icmp_hdr.update_checksum());
+  EXPECT_TRUE(icmp_hdr.is_checksum_valid());
+  packet_bytes[1000] ^= 0x10;
+  EXPECT_FALSE(icmp_hdr.is_checksum_valid());
+
+  //ICMPv6 checksums cover the pseudo header too, from ::1 to ::1 here
+  unsigned char icmpv6_bytes[] = {0x80, 0x00, 0x00, 0x00, 0x12, 0x34, 0x00, 0x01, 'p', 'i', 'n', 'g'};
+  auto loopback_bytes = boost::asio::ip::address_v6::loopback().to_bytes();
+  uint64_t pseudo_header_sum = internet_checksum_add_ipv6_pseudo_header(loopback_bytes.data(), loopback_bytes.data(), sizeof(icmpv6_bytes), IPPROTO_ICMPV6, 0);
+  icmp_header icmpv6_hdr(icmpv6_bytes, sizeof(icmpv6_bytes));
+  EXPECT_TRUE(icmpv6_hdr.update_checksum(pseudo_header_sum));
+  EXPECT_EQ(0x8eb1U, icmpv6_hdr.checksum());
+  EXPECT_TRUE(icmpv6_hdr.is_checksum_valid(pseudo_header_sum));
+  EXPECT_FALSE(icmpv6_hdr.is_checksum_valid());
+}
+
+#if defined(__linux__)
+TEST_F(PingTableTests, socket_batch_test) {
+  //batching does not care about the protocol, so plain UDP over loopback keeps this hermetic
+  boost::asio::io_context io_context;
+  boost::asio::ip::udp::socket receiver(io_context, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  boost::asio::ip::udp::socket sender(io_context, boost::asio::ip::udp::v4());
+  icmp::endpoint destination(boost::asio::ip::address_v4::loopback(), receiver.local_endpoint().port());
+
+  bool transmit_timestamps = false;
+  EXPECT_TRUE(utils::ping::icmp_socket_batch::enable_kernel_timestamps(receiver.native_handle(), transmit_timestamps));
+
+  utils::ping::icmp_socket_batch socket_batch;
+  socket_batch.configure(8, 64);
+
+  //more requests than the batch size, so several sendmmsg calls are needed
+  for (uint64_t request_tag = 0; request_tag < 20; ++request_tag) {
+    unsigned char* packet_bytes = socket_batch.queue_request(destination, 4, request_tag);
+    ASSERT_NE(nullptr, packet_bytes);
+    std::memcpy(packet_bytes, &request_tag, 4);
+  }
+
+  std::vector<uint64_t> sent_tags;
+  EXPECT_EQ(0, socket_batch.flush_requests(sender.native_handle(), [&sent_tags](const uint64_t request_tag, const int error) {
+    EXPECT_EQ(0, error);
+    sent_tags.push_back(request_tag);
+  }));
+  EXPECT_EQ(20U, sent_tags.size());
+  EXPECT_EQ(0U, socket_batch.nr_of_queued_requests());
+
+  std::vector<uint32_t> received_tags;
+  EXPECT_EQ(0, socket_batch.drain_replies(receiver.native_handle(), [&received_tags, &sender](unsigned char* reply_bytes, const size_t reply_size, const utils::ping::icmp_socket_batch::reply_metadata& metadata) {
+    EXPECT_GT(metadata.kernel_timestamp.count(), 0);
+    EXPECT_EQ(sender.local_endpoint().port(), metadata.source_endpoint.port());
+    uint32_t request_tag = 0;
+    ASSERT_EQ(4U, reply_size);
+    std::memcpy(&request_tag, reply_bytes, 4);
+    received_tags.push_back(request_tag);
+  }));
+  ASSERT_EQ(20U, received_tags.size());
+  EXPECT_EQ(19U, received_tags.back());
+}
+
+TEST_F(PingTableTests, socket_filter_test) {
+  boost::asio::io_context io_context;
+  icmp::socket receiver(io_context, icmp::v4());
+  icmp::socket sender(io_context, icmp::v4());
+  icmp::endpoint destination(boost::asio::ip::address_v4::loopback(), 0);
+
+  //looped back echo requests and replies to any other identifier never reach the receiver
+  ASSERT_TRUE(utils::ping::icmp_socket_filter::attach_echo_reply_filter(receiver.native_handle(), 0x1230, 0x1234));
+  receiver.non_blocking(true);
+
+  for (unsigned short identifier : {0x1234, 0x4321}) {
+    unsigned char packet_bytes[icmp_header::ICMP_PACKET_SIZE_IN_BYTES] = {};
+    icmp_header icmp_hdr(packet_bytes, sizeof(packet_bytes));
+    icmp_hdr.type(icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REQUEST);
+    icmp_hdr.identifier(identifier);
+    icmp_hdr.sequence_number(1);
+    icmp_hdr.update_checksum();
+    sender.send_to(boost::asio::buffer(packet_bytes), destination);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::vector<unsigned short> received_identifiers;
+  boost::system::error_code error_code;
+  unsigned char reply_bytes[ipv4_header::MAX_PACKET_SIZE];
+  size_t reply_size = 0;
+  while ((reply_size = receiver.receive(boost::asio::buffer(reply_bytes), 0, error_code)) > 0) {
+    ipv4_header ipv4_hdr(reply_bytes, reply_size);
+    ASSERT_TRUE(ipv4_hdr.is_ready());
+    icmp_header icmp_hdr(reply_bytes + ipv4_hdr.payload_offset(), ipv4_hdr.payload_size());
+    ASSERT_TRUE(icmp_hdr.is_ready());
+    EXPECT_EQ(icmp_header::ICMP_HEADER_CODE_TYPE::ECHO_REPLY, icmp_hdr.type());
+    received_identifiers.push_back(icmp_hdr.identifier());
+  }
+  ASSERT_EQ(1U, received_identifiers.size());
+  EXPECT_EQ(0x1234U, received_identifiers[0]);
+
+  //without the filter everything is back
+  EXPECT_TRUE(utils::ping::icmp_socket_filter::detach_filter(receiver.native_handle()));
+  EXPECT_FALSE(utils::ping::icmp_socket_filter::attach_echo_reply_filter(receiver.native_handle(), 2, 1));
+}
+#endif
+
+TEST_F(PingTableTests, socket_type_test) {
+  //automatic mode ends up on either a datagram or a raw socket, replies look the same on both
+  EXPECT_TRUE(pinger.execute("127.0.0.1", 2, result_data));
+  EXPECT_NE(utils::ping::icmp_v4_ping_executor::AUTOMATIC_SOCKET, pinger.get_socket_type());
+  ASSERT_EQ(2U, result_data.size());
+  for (const auto& ping_data : result_data) {
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, ping_data.type);
+    EXPECT_EQ("127.0.0.1", ping_data.response_address);
+    EXPECT_TRUE(ping_data.valid_checksum);
+  }
+
+  //raw sockets can always be forced
+  result_data.clear();
+  pinger.set_socket_type(utils::ping::icmp_v4_ping_executor::RAW_SOCKET);
+  EXPECT_TRUE(pinger.execute("127.0.0.1", 1, result_data));
+  EXPECT_EQ(utils::ping::icmp_v4_ping_executor::RAW_SOCKET, pinger.get_socket_type());
+  ASSERT_EQ(1U, result_data.size());
+  EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, result_data[0].type);
+  EXPECT_GT(result_data[0].time_to_live, 0U);
+}
+
+TEST_F(PingTableTests, ipv6_ping_test) {
+  //ICMPv6 echoes go through their own socket, next to the IPV4 one
+  EXPECT_TRUE(pinger.execute("::1", 2, result_data));
+  ASSERT_EQ(2U, result_data.size());
+  for (const auto& ping_data : result_data) {
+    EXPECT_EQ(utils::ping::ping_response_data::RESPONSE_TYPE::REPLY_DATA, ping_data.type);
+    EXPECT_EQ("::1", ping_data.response_address);
+    EXPECT_EQ(6U, ping_data.address_family);
+    EXPECT_TRUE(ping_data.valid_checksum);
+  }
+}
+
 TEST_F(PingTableTests, pinger_reuse_test) {
   utils::ping::ping_response_data_collection result_data1;
   utils::ping::ping_response_data_collection result_data2;
@@ -3,16 +3,85 @@
 
 namespace utils
 {
+	//It returns the ICMP ping engine owned by the extension process, made of one or more shards
+	//The engine keeps its sockets and async engines open across queries
+	ping::sharded_ping_executor& get_icmp_ping_engine()
+	{
+		static ping::sharded_ping_executor process_wide_pinger(&get_send_pacer(), &get_latency_tracker());
+
+		return process_wide_pinger;
+	}
+
+	//It returns the background probing scheduler owned by the extension process
+	ping::ping_scheduler& get_ping_scheduler()
+	{
+		static ping::ping_scheduler process_wide_scheduler(&get_send_pacer(), &get_latency_tracker());
+
+		return process_wide_scheduler;
+	}
+
+	//It returns the per target host state tracker owned by the extension process
+	ping::host_state_tracker& get_host_state_tracker()
+	{
+		static ping::host_state_tracker process_wide_tracker;
+
+		return process_wide_tracker;
+	}
+
+	//It returns the ICMP echo request pacer shared by every ICMP ping engine of the extension process
+	ping::send_pacer& get_send_pacer()
+	{
+		static ping::send_pacer process_wide_pacer;
+
+		return process_wide_pacer;
+	}
+
+	//It returns the rolling latency histograms fed by every ICMP ping engine of the extension process
+	ping::latency_tracker& get_latency_tracker()
+	{
+		static ping::latency_tracker process_wide_tracker;
+
+		return process_wide_tracker;
+	}
+
 	bool send_icmp_ping_to_target(const std::string& target_host, const size_t nr_of_ping_requests, ping::ping_response_data_collection& response_data)
+	{
+		ping::ping_request_options options;
+		options.nr_of_ping_requests = nr_of_ping_requests;
+
+		return send_icmp_ping_to_target(target_host, options, response_data);
+	}
+
+	bool send_icmp_ping_to_target(const std::string& target_host, const ping::ping_request_options& options, ping::ping_response_data_collection& response_data)
 	{
 		bool ret = false;
 
 		//defense programming sanity check
-		if ((!target_host.empty()) &&
-			(nr_of_ping_requests > 0))
+		if (!target_host.empty())
 		{
-			ping::icmp_v4_ping_executor pinger;
-			if ((pinger.execute(target_host, nr_of_ping_requests, response_data)) &&
+			ret = send_icmp_ping_to_targets(std::vector<std::string>{ target_host }, options, response_data);
+		}
+
+		return ret;
+	}
+
+	bool send_icmp_ping_to_targets(const std::vector<std::string>& target_hosts, const size_t nr_of_ping_requests, ping::ping_response_data_collection& response_data)
+	{
+		ping::ping_request_options options;
+		options.nr_of_ping_requests = nr_of_ping_requests;
+
+		return send_icmp_ping_to_targets(target_hosts, options, response_data);
+	}
+
+	bool send_icmp_ping_to_targets(const std::vector<std::string>& target_hosts, const ping::ping_request_options& options, ping::ping_response_data_collection& response_data)
+	{
+		bool ret = false;
+
+		//defense programming sanity check
+		if ((!target_hosts.empty()) &&
+			(options.is_valid()))
+		{
+			if ((get_icmp_ping_engine().execute(target_hosts, options, response_data)) &&
 				(!response_data.empty()))
 			{
 				ret = true;
@@ -21,4 +90,62 @@ namespace utils
 
 		return ret;
 	}
-}
+
+	bool send_icmp_ping_to_targets(const std::vector<std::string>& target_hosts, const ping::ping_request_options& options, ping::ping_statistics_data_collection& statistics_data)
+	{
+		bool ret = false;
+
+		//defense programming sanity check
+		if ((!target_hosts.empty()) &&
+			(options.is_valid()))
+		{
+			ret = get_icmp_ping_engine().execute(target_hosts, options, statistics_data);
+		}
+
+		return ret;
+	}
+
+	bool send_icmp_ping_to_targets(const std::vector<std::string>& target_hosts, const ping::ping_request_options& options, ping::ping_result_pool& result_pool)
+	{
+		bool ret = false;
+
+		//defense programming sanity check
+		if ((!target_hosts.empty()) &&
+			(options.is_valid()))
+		{
+			ret = get_icmp_ping_engine().execute(target_hosts, options, result_pool);
+		}
+
+		return ret;
+	}
+
+	bool send_icmp_ping_to_targets(const ping::icmp_v4_ping_executor::target_host_source& next_target_host, const ping::ping_request_options& options, const ping::icmp_v4_ping_executor::response_handler& on_response)
+	{
+		bool ret = false;
+
+		//defense programming sanity check
+		if ((next_target_host) &&
+			(on_response) &&
+			(options.is_valid()))
+		{
+			ret = get_icmp_ping_engine().execute(next_target_host, options, on_response);
+		}
+
+		return ret;
+	}
+
+	bool send_icmp_ping_to_targets(const ping::icmp_v4_ping_executor::target_host_source& next_target_host, const ping::ping_request_options& options, const ping::icmp_v4_ping_executor::result_handler& on_result)
+	{
+		bool ret = false;
+
+		//defense programming sanity check
+		if ((next_target_host) &&
+			(on_result) &&
+			(options.is_valid()))
+		{
+			ret = get_icmp_ping_engine().execute(next_target_host, options, on_result);
+		}
+
+		return ret;
+	}
+}
\ No newline at end of file
@@ -2,9 +2,26 @@
 
 #include <vector>
 #include <string>
+#include "host_state_tracker.h"
 #include "icmp_ping_executor.h"
+#include "ping_result_pool.h"
+#include "ping_scheduler.h"
+#include "sharded_ping_executor.h"
+#include "target_range.h"
 
 namespace utils
 {		 
+	ping::sharded_ping_executor& get_icmp_ping_engine();
+	ping::ping_scheduler& get_ping_scheduler();
+	ping::host_state_tracker& get_host_state_tracker();
+	ping::send_pacer& get_send_pacer();
+	ping::latency_tracker& get_latency_tracker();
 	bool send_icmp_ping_to_target(const std::string& target_host, const size_t nr_of_ping_requests, ping::ping_response_data_collection& response_data);
+	bool send_icmp_ping_to_target(const std::string& target_host, const ping::ping_request_options& options, ping::ping_response_data_collection& response_data);
+	bool send_icmp_ping_to_targets(const std::vector<std::string>& target_hosts, const size_t nr_of_ping_requests, ping::ping_response_data_collection& response_data);
+	bool send_icmp_ping_to_targets(const std::vector<std::string>& target_hosts, const ping::ping_request_options& options, ping::ping_response_data_collection& response_data);
+	bool send_icmp_ping_to_targets(const std::vector<std::string>& target_hosts, const ping::ping_request_options& options, ping::ping_statistics_data_collection& statistics_data);
+	bool send_icmp_ping_to_targets(const std::vector<std::string>& target_hosts, const ping::ping_request_options& options, ping::ping_result_pool& result_pool);
+	bool send_icmp_ping_to_targets(const ping::icmp_v4_ping_executor::target_host_source& next_target_host, const ping::ping_request_options& options, const ping::icmp_v4_ping_executor::response_handler& on_response);
+	bool send_icmp_ping_to_targets(const ping::icmp_v4_ping_executor::target_host_source& next_target_host, const ping::ping_request_options& options, const ping::icmp_v4_ping_executor::result_handler& on_result);
 }
\ No newline at end of file